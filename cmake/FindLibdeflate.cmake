@@ -0,0 +1,46 @@
+find_package(PkgConfig)
+pkg_check_modules(PC_Libdeflate QUIET libdeflate)
+
+find_path(Libdeflate_INCLUDE_DIR
+  NAMES libdeflate.h
+  PATHS ${PC_Libdeflate_INCLUDE_DIRS}
+)
+find_library(Libdeflate_LIBRARY
+  NAMES deflate
+  PATHS ${PC_Libdeflate_LIBRARY_DIRS}
+)
+
+set(Libdeflate_VERSION ${PC_Libdeflate_VERSION})
+set(Libdeflate_VERSION_STRING ${Libdeflate_VERSION})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Libdeflate
+    FOUND_VAR Libdeflate_FOUND
+    REQUIRED_VARS
+        Libdeflate_LIBRARY
+        Libdeflate_INCLUDE_DIR
+    VERSION_VAR Libdeflate_VERSION
+)
+
+if(Libdeflate_FOUND)
+  set(Libdeflate_LIBRARIES ${Libdeflate_LIBRARY})
+  set(Libdeflate_INCLUDE_DIRS ${Libdeflate_INCLUDE_DIR})
+  set(Libdeflate_DEFINITIONS ${PC_Libdeflate_CFLAGS_OTHER})
+endif()
+
+if(Libdeflate_FOUND AND NOT TARGET Libdeflate::Libdeflate)
+    add_library(Libdeflate::Libdeflate UNKNOWN IMPORTED)
+    set_target_properties(Libdeflate::Libdeflate PROPERTIES
+        IMPORTED_LOCATION "${Libdeflate_LIBRARY}"
+        INTERFACE_INCLUDE_DIRECTORIES "${Libdeflate_INCLUDE_DIR}"
+        INTERFACE_COMPILE_OPTIONS "${PC_Libdeflate_CFLAGS_OTHER}"
+        VERSION "${Libdeflate_VERSION}"
+    )
+endif()
+
+mark_as_advanced(
+    Libdeflate_INCLUDE_DIR
+    Libdeflate_LIBRARY
+    Libdeflate_VERSION
+    Libdeflate_VERSION_STRING
+)
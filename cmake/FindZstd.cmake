@@ -0,0 +1,46 @@
+find_package(PkgConfig)
+pkg_check_modules(PC_Zstd QUIET libzstd)
+
+find_path(Zstd_INCLUDE_DIR
+  NAMES zstd.h
+  PATHS ${PC_Zstd_INCLUDE_DIRS}
+)
+find_library(Zstd_LIBRARY
+  NAMES zstd
+  PATHS ${PC_Zstd_LIBRARY_DIRS}
+)
+
+set(Zstd_VERSION ${PC_Zstd_VERSION})
+set(Zstd_VERSION_STRING ${Zstd_VERSION})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd
+    FOUND_VAR Zstd_FOUND
+    REQUIRED_VARS
+        Zstd_LIBRARY
+        Zstd_INCLUDE_DIR
+    VERSION_VAR Zstd_VERSION
+)
+
+if(Zstd_FOUND)
+  set(Zstd_LIBRARIES ${Zstd_LIBRARY})
+  set(Zstd_INCLUDE_DIRS ${Zstd_INCLUDE_DIR})
+  set(Zstd_DEFINITIONS ${PC_Zstd_CFLAGS_OTHER})
+endif()
+
+if(Zstd_FOUND AND NOT TARGET Zstd::Zstd)
+    add_library(Zstd::Zstd UNKNOWN IMPORTED)
+    set_target_properties(Zstd::Zstd PROPERTIES
+        IMPORTED_LOCATION "${Zstd_LIBRARY}"
+        INTERFACE_INCLUDE_DIRECTORIES "${Zstd_INCLUDE_DIR}"
+        INTERFACE_COMPILE_OPTIONS "${PC_Zstd_CFLAGS_OTHER}"
+        VERSION "${Zstd_VERSION}"
+    )
+endif()
+
+mark_as_advanced(
+    Zstd_INCLUDE_DIR
+    Zstd_LIBRARY
+    Zstd_VERSION
+    Zstd_VERSION_STRING
+)
@@ -166,6 +166,85 @@ void SaxParser::parse_memory(const std::string& contents)
   parse_memory_raw((const unsigned char*)contents.c_str(), contents.size());
 }
 
+void SaxParser::parse_chunk_raw(const unsigned char* contents, size_type bytes_count)
+{
+  xmlResetLastError();
+
+  if(!context_)
+  {
+    context_ = xmlCreatePushParserCtxt(
+      sax_handler_.get(),
+      nullptr, // user_data
+      nullptr, // chunk
+      0, // size
+      nullptr); // no filename for fetching external entities
+
+    if(!context_)
+    {
+      throw internal_error("Could not create parser context\n" + format_xml_error());
+    }
+    initialize_context();
+  }
+  else
+    xmlCtxtResetLastError(context_);
+
+  int parseError = XML_ERR_OK;
+  if(!exception_)
+    parseError = xmlParseChunk(context_, (const char*)contents, bytes_count, 0 /* don't terminate */);
+
+  check_for_exception();
+
+  auto error_str = format_xml_parser_error(context_);
+  if (error_str.empty() && parseError != XML_ERR_OK)
+    error_str = fmt::format("Error code from xmlParseChunk(): {:d}", parseError);
+  if(!error_str.empty())
+  {
+    release_underlying(); // Free context_
+    throw parse_error(error_str);
+  }
+}
+
+void SaxParser::finish_chunk_parsing()
+{
+  xmlResetLastError();
+
+  if(!context_)
+  {
+    // nothing was parsed so far, the empty document is reported below
+    context_ = xmlCreatePushParserCtxt(
+      sax_handler_.get(),
+      nullptr, // user_data
+      nullptr, // chunk
+      0, // size
+      nullptr); // no filename for fetching external entities
+
+    if(!context_)
+    {
+      throw internal_error("Could not create parser context\n" + format_xml_error());
+    }
+    initialize_context();
+  }
+  else
+    xmlCtxtResetLastError(context_);
+
+  int parseError = XML_ERR_OK;
+  if(!exception_)
+    parseError = xmlParseChunk(context_, nullptr, 0, 1 /* terminate */);
+
+  auto error_str = format_xml_parser_error(context_);
+  if (error_str.empty() && parseError != XML_ERR_OK)
+    error_str = fmt::format("Error code from xmlParseChunk(): {:d}", parseError);
+
+  release_underlying(); // Free context_
+
+  check_for_exception();
+
+  if(!error_str.empty())
+  {
+    throw parse_error(error_str);
+  }
+}
+
 void SaxParser::release_underlying()
 {
   Parser::release_underlying();
@@ -50,6 +50,27 @@ public:
    */
   void parse_memory_raw(const unsigned char* contents, size_type bytes_count) override;
 
+  /** Parse a chunk of data.
+   *
+   * This lets you pass a document in small chunks, e.g. from a network
+   * connection. The on_* virtual functions are called during parsing.
+   *
+   * @param contents The next chunk of the XML document as an array of bytes.
+   * @param bytes_count The number of bytes in the @a contents array.
+   * @throws xmlpp::internal_error
+   * @throws xmlpp::parse_error
+   */
+  void parse_chunk_raw(const unsigned char* contents, size_type bytes_count);
+
+  /** Finish a chunk-wise parse.
+   *
+   * Call this after the last call to parse_chunk_raw(). Don't use this
+   * function with the other parsing methods.
+   * @throws xmlpp::internal_error
+   * @throws xmlpp::parse_error
+   */
+  void finish_chunk_parsing();
+
 protected:
   virtual void on_start_document();
   virtual void on_end_document();
@@ -33,6 +33,10 @@ public:
   changeset_update_sel_responder(mime::type,
                                  data_selection & sel,
                                  osm_changeset_id_t id_);
+
+  // responds with a changeset, which PBF can't represent
+  std::vector<mime::type> types_available() const override;
+
 private:
   data_selection& sel;
 };
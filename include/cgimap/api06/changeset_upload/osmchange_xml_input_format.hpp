@@ -54,6 +54,27 @@ public:
     }
   }
 
+  // parses the next piece of a message which arrives in chunks. objects
+  // are passed to the callback as soon as they are complete, call
+  // finish_message() after the last chunk.
+  void process_chunk(std::string_view data) {
+
+    try {
+      parse_chunk_raw(reinterpret_cast<const unsigned char *>(data.data()), data.size());
+    } catch (const xmlpp::exception& e) {
+      throw http::bad_request(e.what());
+    }
+  }
+
+  void finish_message() {
+
+    try {
+      finish_chunk_parsing();
+    } catch (const xmlpp::exception& e) {
+      throw http::bad_request(e.what());
+    }
+  }
+
 protected:
 
   void on_start_element(const char *elem, const char **attrs) override {
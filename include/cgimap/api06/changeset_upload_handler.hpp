@@ -11,6 +11,7 @@
 #define API06_CHANGESET_UPLOAD_HANDLER_HPP
 
 #include <string>
+#include <string_view>
 
 #include "cgimap/handler.hpp"
 #include "cgimap/osm_diffresult_responder.hpp"
@@ -23,7 +24,7 @@ namespace api06 {
 class changeset_upload_responder : public osm_diffresult_responder {
 public:
   changeset_upload_responder(mime::type, data_update &, osm_changeset_id_t,
-                             const std::string &,
+                             std::string_view raw_payload,
                              const RequestContext& req_ctx);
 };
 
@@ -38,6 +39,7 @@ public:
                             const std::string &payload,
                             const RequestContext& req_ctx) const override;
   bool requires_selection_after_update() const override;
+  bool streams_payload() const override;
 
 private:
   osm_changeset_id_t id;
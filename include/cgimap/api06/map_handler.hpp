@@ -22,6 +22,14 @@ namespace api06 {
 class map_responder : public osm_current_responder {
 public:
   map_responder(mime::type, bbox, data_selection &);
+
+  std::optional<std::size_t> expected_size() const override;
+
+  // the closure of a map call is too large to check on every request
+  std::optional<data_selection::selection_version> version() const override { return {}; }
+
+private:
+  uint32_t num_nodes = 0;
 };
 
 class map_handler : public handler {
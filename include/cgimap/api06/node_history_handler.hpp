@@ -19,6 +19,9 @@ namespace api06 {
 class node_history_responder : public osm_current_responder {
 public:
   node_history_responder(mime::type, osm_nwr_id_t, data_selection &);
+
+  // new versions and redactions change the entity tag, so the response can be cached
+  bool cacheable() const override;
 };
 
 class node_history_handler : public handler {
@@ -21,6 +21,9 @@ namespace api06 {
 class relation_version_responder : public osm_current_responder {
 public:
   relation_version_responder(mime::type, osm_nwr_id_t, osm_version_t v, data_selection &);
+
+  // historic versions never change, other than by being redacted
+  bool cacheable() const override;
 };
 
 class relation_version_handler : public handler {
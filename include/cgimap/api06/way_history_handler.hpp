@@ -21,6 +21,9 @@ namespace api06 {
 class way_history_responder : public osm_current_responder {
 public:
   way_history_responder(mime::type, osm_nwr_id_t, data_selection &);
+
+  // new versions and redactions change the entity tag, so the response can be cached
+  bool cacheable() const override;
 };
 
 class way_history_handler : public handler {
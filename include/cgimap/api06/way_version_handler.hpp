@@ -21,6 +21,9 @@ namespace api06 {
 class way_version_responder : public osm_current_responder {
 public:
   way_version_responder(mime::type, osm_nwr_id_t, osm_version_t, data_selection &);
+
+  // historic versions never change, other than by being redacted
+  bool cacheable() const override;
 };
 
 class way_version_handler : public handler {
@@ -26,6 +26,9 @@ namespace api07 {
 class map_responder : public osm_current_responder {
 public:
   map_responder(mime::type, bbox, data_selection &);
+
+  // the closure of a map call is too large to check on every request
+  std::optional<data_selection::selection_version> version() const override { return {}; }
 };
 
 class map_handler : public handler {
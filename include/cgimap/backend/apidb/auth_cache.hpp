@@ -0,0 +1,62 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef AUTH_CACHE_HPP
+#define AUTH_CACHE_HPP
+
+#include "cgimap/backend/apidb/ttl_cache.hpp"
+#include "cgimap/data_selection.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+
+/**
+ * Token details as they are cached. Whether a token has expired or was
+ * revoked depends on when it's used, so the times are kept instead, and
+ * checked on every lookup. They're taken from the time left as of the
+ * database's now() when the token was looked up, so that they don't
+ * depend on the local clock agreeing with the database's.
+ */
+struct cached_oauth2_token {
+  using time_point = std::chrono::steady_clock::time_point;
+
+  data_selection::oauth2_user_details details;
+  std::optional<time_point> expires_at;
+  std::optional<time_point> revoked_at;
+
+  // the details with expired and revoked set as of now
+  [[nodiscard]] data_selection::oauth2_user_details at(time_point now) const;
+};
+
+/**
+ * Short lived cache of authentication details, shared by all requests of
+ * a process, so that editors sending many requests with the same token
+ * don't need a query per request to authenticate.
+ *
+ * Each entry holds the token details together with the user's roles and
+ * status. Unknown tokens are cached as well, but separately and fewer of
+ * them, so that requests with made up tokens can't evict valid ones.
+ */
+struct auth_cache {
+  auth_cache(std::size_t capacity, std::size_t unknown_capacity,
+             std::chrono::seconds ttl);
+
+  ttl_cache<std::string, cached_oauth2_token> tokens;
+  ttl_cache<std::string, std::monostate> unknown_tokens;
+
+  // cache shared by all callers in this process, which is created with
+  // the given time to live on first use. returns nullptr if ttl is 0.
+  static std::shared_ptr<auth_cache> shared(std::chrono::seconds ttl);
+};
+
+#endif /* AUTH_CACHE_HPP */
@@ -0,0 +1,60 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef CHANGESET_CACHE_HPP
+#define CHANGESET_CACHE_HPP
+
+#include "cgimap/backend/apidb/changeset.hpp"
+#include "cgimap/backend/apidb/ttl_cache.hpp"
+#include "cgimap/types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * Bounded LRU cache of the user details of changesets, shared by all
+ * requests (and worker threads) of a process.
+ *
+ * The user of a changeset never changes, only the user's display name and
+ * public edits flag can, which is why entries expire after a fixed time to
+ * live rather than being kept until evicted.
+ */
+class changeset_cache {
+public:
+  using clock = ttl_cache<osm_changeset_id_t, changeset>::clock;
+
+  changeset_cache(std::size_t capacity, std::chrono::seconds ttl);
+
+  // copies all cached, unexpired entries for ids into cc and returns the
+  // ids which weren't found.
+  std::vector<osm_changeset_id_t>
+  lookup(const std::vector<osm_changeset_id_t> &ids,
+         std::map<osm_changeset_id_t, changeset> &cc,
+         clock::time_point now = clock::now());
+
+  void insert(osm_changeset_id_t id, const changeset &cs,
+              clock::time_point now = clock::now());
+
+  void clear();
+
+  [[nodiscard]] std::size_t size() const;
+
+  // cache shared by all callers in this process, which is created with
+  // the given parameters on first use. returns nullptr if capacity is 0.
+  static std::shared_ptr<changeset_cache> shared(std::size_t capacity,
+                                                 std::chrono::seconds ttl);
+
+private:
+  ttl_cache<osm_changeset_id_t, changeset> m_cache;
+};
+
+#endif /* CHANGESET_CACHE_HPP */
@@ -0,0 +1,121 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef BACKEND_APIDB_ID_SET_HPP
+#define BACKEND_APIDB_ID_SET_HPP
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+/*
+ * Ordered set of unique ids (or editions), stored in a sorted vector.
+ *
+ * Selections grow in batches (one database result at a time), so ids are
+ * added with insert_batch, which sorts the batch and merges it in one
+ * pass, instead of allocating a tree node per id like std::set. Iteration
+ * is over contiguous memory, which also makes passing the set as a
+ * Postgres array parameter cheap.
+ */
+template <typename T>
+class id_set {
+public:
+  using value_type = T;
+  using container_type = std::vector<T>;
+  using const_iterator = typename container_type::const_iterator;
+  using iterator = const_iterator;
+  using size_type = typename container_type::size_type;
+
+  id_set() = default;
+
+  id_set(std::initializer_list<T> values) {
+    insert_batch(container_type(values));
+  }
+
+  [[nodiscard]] const_iterator begin() const { return m_values.begin(); }
+  [[nodiscard]] const_iterator end() const { return m_values.end(); }
+  [[nodiscard]] size_type size() const { return m_values.size(); }
+  [[nodiscard]] bool empty() const { return m_values.empty(); }
+  [[nodiscard]] const container_type &values() const { return m_values; }
+
+  [[nodiscard]] bool contains(const T &value) const {
+    return std::binary_search(m_values.begin(), m_values.end(), value);
+  }
+
+  void clear() { m_values.clear(); }
+
+  void reserve(size_type n) { m_values.reserve(n); }
+
+  void swap(id_set &other) noexcept { m_values.swap(other.m_values); }
+
+  // inserts a single value, returns true if it wasn't in the set before.
+  // prefer insert_batch when adding more than a handful of values.
+  bool insert(const T &value) {
+    auto it = std::lower_bound(m_values.begin(), m_values.end(), value);
+    if (it != m_values.end() && !(value < *it))
+      return false;
+    m_values.insert(it, value);
+    return true;
+  }
+
+  // adds all values in batch (in any order, duplicates allowed) and
+  // returns the number of values which weren't in the set before.
+  size_type insert_batch(container_type batch) {
+    if (batch.empty())
+      return 0;
+
+    if (!std::is_sorted(batch.begin(), batch.end()))
+      std::sort(batch.begin(), batch.end());
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+    const auto old_size = m_values.size();
+
+    if (m_values.empty()) {
+      m_values = std::move(batch);
+    } else if (m_values.back() < batch.front()) {
+      // common case for ordered results: everything goes at the end
+      m_values.insert(m_values.end(), batch.begin(), batch.end());
+    } else {
+      container_type merged;
+      merged.reserve(m_values.size() + batch.size());
+      std::set_union(m_values.begin(), m_values.end(), batch.begin(),
+                     batch.end(), std::back_inserter(merged));
+      m_values = std::move(merged);
+    }
+
+    return m_values.size() - old_size;
+  }
+
+  // adds all values of other, returns the number of new values.
+  size_type merge(const id_set &other) {
+    return insert_batch(other.m_values);
+  }
+
+  // removes all values of other, returns the number of removed values.
+  size_type erase(const id_set &other) {
+    if (empty() || other.empty())
+      return 0;
+
+    const auto old_size = m_values.size();
+    auto other_it = other.m_values.begin();
+    std::erase_if(m_values, [&](const T &value) {
+      other_it = std::lower_bound(other_it, other.m_values.end(), value);
+      return other_it != other.m_values.end() && !(value < *other_it);
+    });
+    return old_size - m_values.size();
+  }
+
+  bool operator==(const id_set &) const = default;
+
+private:
+  container_type m_values;
+};
+
+#endif /* BACKEND_APIDB_ID_SET_HPP */
@@ -0,0 +1,89 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef MAP_TILE_CACHE_HPP
+#define MAP_TILE_CACHE_HPP
+
+#include "cgimap/backend/apidb/quad_tile.hpp"
+#include "cgimap/backend/apidb/ttl_cache.hpp"
+#include "cgimap/types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * The ids of the elements a /map call returns for the nodes in a block of
+ * tiles, except for the parent relations of relations.
+ */
+struct map_tile_closure {
+  // number of nodes in the tiles of the block
+  int num_nodes = 0;
+
+  // all nodes of the closure, including those in the block
+  std::vector<osm_nwr_id_t> nodes;
+  std::vector<osm_nwr_id_t> ways;
+  // relations with any of the nodes or ways as members
+  std::vector<osm_nwr_id_t> relations;
+
+  // area covering the block and all nodes of the closure, in the database's
+  // fixed point coordinates. any change to the closure is made in a
+  // changeset whose bounding box overlaps it.
+  int64_t minlat = 0, maxlat = 0, minlon = 0, maxlon = 0;
+
+  // database time (UTC) of the transaction the closure was selected in
+  std::string selected_at;
+};
+
+/**
+ * Bounded LRU cache of the /map closures of blocks of tiles, shared by all
+ * requests (and worker threads) of a process.
+ *
+ * The cache doesn't know about changes to the data: callers have to check
+ * the closures against the changesets edited since they were selected,
+ * less the edit margin, which allows for transactions which were still
+ * running, or not yet replicated, at the time. Entries expire after a
+ * fixed time to live, which bounds how far back that check has to look.
+ */
+class map_tile_cache {
+public:
+  using closure_ptr = std::shared_ptr<const map_tile_closure>;
+  using clock = ttl_cache<uint64_t, closure_ptr>::clock;
+
+  map_tile_cache(std::size_t capacity, std::chrono::seconds ttl,
+                 std::chrono::seconds edit_margin);
+
+  // returns nullptr if there's no unexpired closure for the block.
+  closure_ptr get(const tile_block &block, clock::time_point now = clock::now());
+
+  void insert(const tile_block &block, closure_ptr closure,
+              clock::time_point now = clock::now());
+
+  void invalidate(const tile_block &block);
+  void clear();
+
+  [[nodiscard]] std::size_t size() const;
+
+  [[nodiscard]] std::chrono::seconds edit_margin() const;
+
+  // cache shared by all callers in this process, which is created with
+  // the given parameters on first use. returns nullptr if capacity is 0.
+  static std::shared_ptr<map_tile_cache> shared(std::size_t capacity,
+                                                std::chrono::seconds ttl,
+                                                std::chrono::seconds edit_margin);
+
+private:
+  ttl_cache<uint64_t, closure_ptr> m_cache;
+  std::chrono::seconds m_edit_margin;
+};
+
+#endif /* MAP_TILE_CACHE_HPP */
@@ -21,6 +21,7 @@
 #include <pqxx/pqxx>
 
 #include "cgimap/types.hpp"
+#include "cgimap/backend/apidb/id_set.hpp"
 
 namespace pqxx {
 
@@ -123,9 +124,11 @@ public:
 
 PQXX_ARRAY_STRING_TRAITS(std::vector<osm_nwr_id_t>);
 PQXX_ARRAY_STRING_TRAITS(std::set<osm_nwr_id_t>);
+PQXX_ARRAY_STRING_TRAITS(id_set<osm_nwr_id_t>);
 PQXX_ARRAY_STRING_TRAITS(std::vector<tile_id_t>);
 PQXX_ARRAY_STRING_TRAITS(std::vector<osm_changeset_id_t>);
 PQXX_ARRAY_STRING_TRAITS(std::set<osm_changeset_id_t>);
+PQXX_ARRAY_STRING_TRAITS(id_set<osm_changeset_id_t>);
 PQXX_ARRAY_STRING_TRAITS(std::vector<std::string>);
 
 } // namespace pqxx
@@ -13,12 +13,45 @@
 #include "cgimap/types.hpp"
 
 #include <cmath>
+#include <utility>
 #include <vector>
 
+// inclusive range of tile ids, [first, last]
+using tile_range_t = std::pair<tile_id_t, tile_id_t>;
 
 std::vector<tile_id_t> tiles_for_area(double minlat, double minlon, double maxlat,
                                       double maxlon);
 
+// same tiles as tiles_for_area, but as sorted, non-adjacent ranges of
+// consecutive tile ids. tile ids follow a Z-order curve, so whole quadrants
+// of the area map onto a single range and the number of ranges only grows
+// with the perimeter of the area, not with its size.
+std::vector<tile_range_t> tile_ranges_for_area(double minlat, double minlon,
+                                               double maxlat, double maxlon);
+
+// an aligned square of 2^level by 2^level tiles, which is a single range
+// of consecutive tile ids.
+struct tile_block {
+  tile_range_t tiles;
+  unsigned int minx, maxx, miny, maxy;
+};
+
+// blocks of at least 4^min_level and at most 4^max_level tiles which cover
+// the part of the area that's at least margin tiles away from its edges,
+// as far as blocks of at least 4^min_level tiles can. they are in order of
+// their tile ids.
+std::vector<tile_block> tile_blocks_for_area(double minlat, double minlon,
+                                             double maxlat, double maxlon,
+                                             unsigned int min_level,
+                                             unsigned int max_level,
+                                             unsigned int margin);
+
+// the tiles of the ranges which aren't in any of the blocks. the blocks
+// must be ordered as returned by tile_blocks_for_area and lie within the
+// ranges.
+std::vector<tile_range_t> subtract_tile_blocks(const std::vector<tile_range_t> &ranges,
+                                               const std::vector<tile_block> &blocks);
+
 /* following functions liberally nicked from TomH's quad_tile
  * library.
  */
@@ -41,4 +74,13 @@ inline unsigned int lat2y(double lat) {
   return round((lat + 90.0) * 65535.0 / 180.0);
 }
 
+// inverse of lon2x and lat2y, for the edges of tiles
+inline double x2lon(double x) {
+  return x * 360.0 / 65535.0 - 180.0;
+}
+
+inline double y2lat(double y) {
+  return y * 180.0 / 65535.0 - 90.0;
+}
+
 #endif /* QUAD_TILE_HPP */
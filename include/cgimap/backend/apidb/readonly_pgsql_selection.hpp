@@ -11,7 +11,11 @@
 #define READONLY_PGSQL_SELECTION_HPP
 
 #include "cgimap/data_selection.hpp"
+#include "cgimap/backend/apidb/auth_cache.hpp"
 #include "cgimap/backend/apidb/changeset.hpp"
+#include "cgimap/backend/apidb/changeset_cache.hpp"
+#include "cgimap/backend/apidb/id_set.hpp"
+#include "cgimap/backend/apidb/map_tile_cache.hpp"
 #include "cgimap/backend/apidb/transaction_manager.hpp"
 
 #include <chrono>
@@ -32,7 +36,10 @@ class readonly_pgsql_selection : public data_selection {
 
 
 public:
-  readonly_pgsql_selection(Transaction_Owner_Base& to);
+  readonly_pgsql_selection(Transaction_Owner_Base& to,
+                           std::shared_ptr<changeset_cache> cache = {},
+                           std::shared_ptr<auth_cache> auth = {},
+                           std::shared_ptr<map_tile_cache> map_tiles = {});
   ~readonly_pgsql_selection() override = default;
 
   void write_nodes(output_formatter &formatter) override;
@@ -48,6 +55,7 @@ public:
   int select_ways(const std::vector<osm_nwr_id_t> &) override;
   int select_relations(const std::vector<osm_nwr_id_t> &) override;
   int select_nodes_from_bbox(const bbox &bounds, int max_nodes) override;
+  int select_map_closure(const bbox &bounds, int max_nodes) override;
   void select_nodes_from_relations() override;
   void select_ways_from_nodes() override;
   void select_ways_from_relations() override;
@@ -72,6 +80,7 @@ public:
   int select_relations_with_history(const std::vector<osm_nwr_id_t> &) override;
   void set_redactions_visible(bool) override;
   int select_historical_by_changesets(const std::vector<osm_changeset_id_t> &) override;
+  std::optional<selection_version> get_selection_version() override;
 
   bool supports_user_details() const override;
   bool is_user_blocked(const osm_user_id_t) override;
@@ -80,6 +89,7 @@ public:
       const std::string &token_id, bool &expired, bool &revoked,
       bool &allow_api_write) override;
   bool is_user_active(const osm_user_id_t id) override;
+  oauth2_user_details get_oauth2_user_details(const std::string &token_id) override;
 
 
   /**
@@ -96,11 +106,20 @@ public:
     pqxx::connection m_connection;
     pqxx::quiet_errorhandler m_errorhandler;
     std::set<std::string> m_prep_stmt;  // keeps track of already prepared statements
+    std::shared_ptr<changeset_cache> m_changeset_cache;
+    std::shared_ptr<auth_cache> m_auth_cache;
+    std::shared_ptr<map_tile_cache> m_map_tile_cache;
   };
 
 private:
-  std::set< osm_changeset_id_t > extract_changeset_ids(const pqxx::result& result) const;
-  void fetch_changesets(const std::set< osm_changeset_id_t >& ids, std::map<osm_changeset_id_t, changeset> & cc);
+  id_set< osm_changeset_id_t > extract_changeset_ids(const pqxx::result& result) const;
+  void fetch_changesets(const id_set< osm_changeset_id_t >& ids, std::map<osm_changeset_id_t, changeset> & cc);
+
+  // closures of the blocks, from the tile cache where they are still valid
+  // and from the database otherwise. stops early if the blocks have more
+  // than max_nodes nodes, in which case the closures are incomplete.
+  std::vector<map_tile_cache::closure_ptr>
+  select_map_tile_closures(const std::vector<tile_block> &blocks, int max_nodes);
 
   Transaction_Manager m;
 
@@ -113,10 +132,19 @@ private:
   bool m_redactions_visible { false };
 
   // the set of selected nodes, ways and relations
-  std::set<osm_changeset_id_t> sel_changesets;
-  std::set<osm_nwr_id_t> sel_nodes, sel_ways, sel_relations;
-  std::set<osm_edition_t> sel_historic_nodes, sel_historic_ways, sel_historic_relations;
+  id_set<osm_changeset_id_t> sel_changesets;
+  id_set<osm_nwr_id_t> sel_nodes, sel_ways, sel_relations;
+  id_set<osm_edition_t> sel_historic_nodes, sel_historic_ways, sel_historic_relations;
   std::map<osm_changeset_id_t, changeset> cc;
+
+  // user details of the last OAuth 2.0 token looked up
+  std::optional<oauth2_user_details> m_user_details;
+
+  // process wide caches of changeset user details, of authentication
+  // details and of /map closures, any may be nullptr
+  std::shared_ptr<changeset_cache> m_changeset_cache;
+  std::shared_ptr<auth_cache> m_auth_cache;
+  std::shared_ptr<map_tile_cache> m_map_tile_cache;
 };
 
 #endif /* READONLY_PGSQL_SELECTION_HPP */
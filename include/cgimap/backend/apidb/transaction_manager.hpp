@@ -13,12 +13,16 @@
 #include "cgimap/logger.hpp"
 
 #include <chrono>
+#include <functional>
+#include <map>
 #include <set>
 #include <string_view>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <pqxx/pqxx>
 
 
@@ -137,6 +141,16 @@ private:
 };
 
 
+/*
+ * Planner settings (name, value) which a statement needs, e.g. to work
+ * around bad statistics. They're declared when preparing the statement
+ * and applied with SET LOCAL in the same round trip as the statement.
+ * Settings still in effect from an earlier statement are reset to their
+ * defaults before any statement which doesn't declare them.
+ */
+using planner_settings = std::vector<std::pair<std::string, std::string>>;
+
+
 #define PQXX_LIBRARY_VERSION_COMPARE(major1, minor1, patch1, major2, minor2, patch2)   \
     ((major1) < (major2)) ||                                              \
     ((major1) == (major2) && (minor1) < (minor2)) ||                      \
@@ -148,12 +162,15 @@ class Transaction_Manager {
 public:
   explicit Transaction_Manager(Transaction_Owner_Base &to);
 
-  void prepare(const std::string &name, const std::string &);
+  void prepare(const std::string &name, const std::string &,
+               const planner_settings &settings = {});
 
   pqxx::result exec(const std::string &query,
                     const std::string &description = std::string());
 
   void commit() {
+    flush();
+
     pqxx_stats stats;
 
     m_txn.commit();
@@ -164,6 +181,13 @@ public:
   template<typename... Args>
   [[nodiscard]] pqxx::result exec_prepared(const std::string &statement, Args&&... args) {
 
+    // send any deferred statements and planner setting changes along
+    // with this one, so they don't cost an extra round trip.
+    if (!m_deferred.empty() || planner_settings_change(statement)) {
+      defer(statement, {}, std::forward<Args>(args)...);
+      return flush();
+    }
+
     pqxx_stats stats;
 
 #if PQXX_LIBRARY_VERSION_COMPARE(PQXX_VERSION_MAJOR, PQXX_VERSION_MINOR, PQXX_VERSION_PATCH, 7, 9, 3)
@@ -177,15 +201,65 @@ public:
     return res;
   }
 
+  // called with the result of a deferred statement, to validate it.
+  using result_check = std::function<void(const pqxx::result &)>;
+
+  /*
+   * Queues a prepared statement whose result isn't needed right away, such
+   * as copying rows to the history tables. Deferred statements are sent to
+   * the database in a single pipeline along with the next statement whose
+   * result is needed, or on commit, instead of waiting a round trip each.
+   * Any error (including one thrown by check) is raised at that point.
+   */
+  template<typename... Args>
+  void exec_prepared_deferred(const std::string &statement, result_check check,
+                              Args&&... args) {
+    defer(statement, std::move(check), std::forward<Args>(args)...);
+  }
+
+  // executes all deferred statements, returns the result of the last one.
+  pqxx::result flush();
+
 #if PQXX_VERSION_MAJOR >= 7
   Stream_Wrapper to_stream(std::string_view table, std::string_view columns) {
+    flush();
     return Stream_Wrapper(m_txn, table, columns);
   }
 #endif
 
 private:
+  struct deferred_statement {
+    std::string name;
+    std::vector<std::string> settings;
+    std::string query;
+    result_check check;
+  };
+
+  // pipelined statements can't use the extended query protocol, so
+  // prepared statements are run with EXECUTE and quoted arguments instead.
+  template<typename... Args>
+  void defer(const std::string &statement, result_check check, Args&&... args) {
+    std::string query = fmt::format("EXECUTE {}", m_txn.quote_name(statement));
+    if constexpr (sizeof...(Args) > 0) {
+      const std::vector<std::string> params{ m_txn.quote(std::forward<Args>(args))... };
+      query += fmt::format("({})", fmt::join(params, ","));
+    }
+
+    m_deferred.push_back({statement, pending_planner_settings(statement),
+                          std::move(query), std::move(check)});
+  }
+
+  const planner_settings &declared_planner_settings(std::string_view statement) const;
+  bool planner_settings_change(std::string_view statement) const;
+  std::vector<std::string> pending_planner_settings(std::string_view statement);
+
   pqxx::transaction_base & m_txn;
   std::set<std::string>& m_prep_stmt;
+  // planner settings declared per statement, and the ones currently set
+  // in this transaction.
+  std::map<std::string, planner_settings, std::less<>> m_planner_settings;
+  std::map<std::string, std::string, std::less<>> m_active_settings;
+  std::vector<deferred_statement> m_deferred;
 };
 
 #undef PQXX_LIBRARY_VERSION_COMPARE
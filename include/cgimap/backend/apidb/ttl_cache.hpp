@@ -0,0 +1,117 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef TTL_CACHE_HPP
+#define TTL_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Thread safe, bounded LRU cache whose entries expire a fixed time after
+ * they were inserted. Used for data which is shared by requests, but may
+ * change in the database, so it must be fetched again eventually.
+ */
+template <typename Key, typename Value>
+class ttl_cache {
+public:
+  using clock = std::chrono::steady_clock;
+
+  ttl_cache(std::size_t capacity, std::chrono::seconds ttl)
+      : m_capacity(capacity), m_ttl(ttl) {}
+
+  // returns the cached value for key, unless it's missing or expired.
+  std::optional<Value> get(const Key &key, clock::time_point now = clock::now()) {
+    std::scoped_lock lock(m_mutex);
+
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+      return std::nullopt;
+
+    if (it->second->expires <= now) {
+      erase(it->second);
+      return std::nullopt;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->value;
+  }
+
+  // inserts or replaces the value for key, evicting the least recently
+  // used entry if the cache is full.
+  void put(const Key &key, Value value, clock::time_point now = clock::now()) {
+    std::scoped_lock lock(m_mutex);
+
+    if (auto it = m_index.find(key); it != m_index.end()) {
+      it->second->value = std::move(value);
+      it->second->expires = now + m_ttl;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return;
+    }
+
+    if (m_capacity == 0)
+      return;
+
+    if (m_entries.size() >= m_capacity)
+      erase(std::prev(m_entries.end()));
+
+    m_entries.push_front(entry{key, std::move(value), now + m_ttl});
+    m_index.emplace(key, m_entries.begin());
+  }
+
+  void invalidate(const Key &key) {
+    std::scoped_lock lock(m_mutex);
+
+    if (auto it = m_index.find(key); it != m_index.end())
+      erase(it->second);
+  }
+
+  void clear() {
+    std::scoped_lock lock(m_mutex);
+
+    m_index.clear();
+    m_entries.clear();
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::scoped_lock lock(m_mutex);
+
+    return m_entries.size();
+  }
+
+private:
+  struct entry {
+    Key key;
+    Value value;
+    clock::time_point expires;
+  };
+
+  using entry_list = std::list<entry>;
+
+  void erase(typename entry_list::iterator it) {
+    m_index.erase(it->key);
+    m_entries.erase(it);
+  }
+
+  const std::size_t m_capacity;
+  const std::chrono::seconds m_ttl;
+
+  mutable std::mutex m_mutex;
+  // most recently used entries first
+  entry_list m_entries;
+  std::unordered_map<Key, typename entry_list::iterator> m_index;
+};
+
+#endif /* TTL_CACHE_HPP */
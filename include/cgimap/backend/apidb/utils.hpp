@@ -11,6 +11,7 @@
 #define CGIMAP_BACKEND_APIDB_UTILS_HPP
 
 #include <algorithm>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <ranges>
@@ -198,6 +199,13 @@ void check_postgres_version(const pqxx::connection_base &conn);
 std::vector<std::string> psql_array_to_vector(std::string_view str, int size_hint = 0);
 std::vector<std::string> psql_array_to_vector(const pqxx::field& field, int size_hint = 0);
 
+// same as psql_array_to_vector, but returns views into str instead of
+// copies. only elements containing escape sequences are unescaped into
+// the (cleared) buffer `unescaped`. both str and unescaped must outlive
+// the returned views, and unescaped must not be modified meanwhile.
+std::vector<std::string_view> psql_array_to_views(std::string_view str, std::string &unescaped, int size_hint = 0);
+std::vector<std::string_view> psql_array_to_views(const pqxx::field& field, std::string &unescaped, int size_hint = 0);
+
 template <typename T>
 std::vector<T> psql_array_ids_to_vector(const pqxx::field& field);
 
@@ -206,6 +214,13 @@ std::vector<T> psql_array_ids_to_vector(std::string_view str);
 
 void extract_bbox_from_row(const pqxx::row &row, bbox_t &result);
 
+// converts a timestamp in PostgreSQL's ISO output format (DateStyle ISO),
+// e.g. "2013-11-14 02:10:00.123", to the format used in the API, e.g.
+// "2013-11-14T02:10:00Z". fractional seconds are truncated, same as with
+// to_char(ts, 'YYYY-MM-DD"T"HH24:MI:SS"Z"').
+std::string format_pg_timestamp(std::string_view ts);
+std::string format_pg_timestamp(const pqxx::field& field);
+
 std::string escape_pg_value(const std::string &value);
 
 #endif /* CGIMAP_BACKEND_APIDB_UTILS_HPP */
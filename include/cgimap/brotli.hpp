@@ -19,6 +19,7 @@
 #include <brotli/decode.h>
 #include <brotli/encode.h>
 
+#include "cgimap/decompressor.hpp"
 #include "cgimap/output_buffer.hpp"
 
 
@@ -27,7 +28,7 @@
  */
 class brotli_output_buffer : public output_buffer {
 public:
-  explicit brotli_output_buffer(output_buffer& o);
+  explicit brotli_output_buffer(output_buffer& o, int quality = 5);
 
   brotli_output_buffer(const brotli_output_buffer &old) = delete;
   brotli_output_buffer& operator=(const brotli_output_buffer&) = delete;
@@ -45,7 +46,7 @@ private:
   int compress(const char *data, int data_length, bool last);
 
   BrotliEncoderState *state_ = nullptr;
-  std::array<uint8_t, 16384> buff;
+  std::array<uint8_t, OUTPUT_CHUNK_SIZE> buff;
 
   output_buffer& out;
   // keep track of bytes written
@@ -53,6 +54,21 @@ private:
   bool flushed{false};
 };
 
+/**
+ * Decompresses a brotli ("br") encoded payload.
+ */
+class BrotliDecompressor : public Decompressor {
+public:
+  BrotliDecompressor();
+  ~BrotliDecompressor() override;
+
+  void decompress(std::string_view input, const sink_t &sink) override;
+
+private:
+  BrotliDecoderState *state_ = nullptr;
+  std::array<uint8_t, 16384> buff;
+};
+
 #endif
 
 #endif
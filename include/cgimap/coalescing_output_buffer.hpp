@@ -0,0 +1,72 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef COALESCING_OUTPUT_BUFFER_HPP
+#define COALESCING_OUTPUT_BUFFER_HPP
+
+#include "cgimap/output_buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Collects many small writes into large chunks before handing them on to
+ * the underlying output buffer.
+ *
+ * Writes of at least a quarter of the capacity, or writes which don't fit
+ * into the remaining space, aren't copied: they're handed on together with
+ * the data collected so far in a single call to write_chunks(), which the
+ * underlying buffer may turn into a single scatter-gather write.
+ */
+class coalescing_output_buffer : public output_buffer {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 4 * OUTPUT_CHUNK_SIZE;
+
+  explicit coalescing_output_buffer(output_buffer &o,
+                                    std::size_t capacity = DEFAULT_CAPACITY);
+
+  coalescing_output_buffer(const coalescing_output_buffer &) = delete;
+  coalescing_output_buffer& operator=(const coalescing_output_buffer &) = delete;
+  coalescing_output_buffer(coalescing_output_buffer &&) = delete;
+  coalescing_output_buffer& operator=(coalescing_output_buffer &&) = delete;
+
+  ~coalescing_output_buffer() override = default;
+
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override;
+  int written() const override;
+  int close() noexcept override;
+  int flush() noexcept override;
+
+  // hands on any collected data, without flushing the underlying buffer
+  int drain() noexcept;
+
+  // forgets any collected data and resets the counters, for re-use with the
+  // next request.
+  void reset() noexcept;
+
+  // number of writes to this buffer, and the number of chunks they were
+  // handed on in.
+  [[nodiscard]] uint64_t writes() const { return m_writes; }
+  [[nodiscard]] uint64_t chunks() const { return m_chunks; }
+
+private:
+  int hand_on(std::string_view data) noexcept;
+
+  output_buffer &out;
+  std::vector<char> m_buffer;
+  std::size_t m_used = 0;
+  std::size_t m_direct;
+  int m_written = 0;
+  uint64_t m_writes = 0;
+  uint64_t m_chunks = 0;
+};
+
+#endif /* COALESCING_OUTPUT_BUFFER_HPP */
@@ -0,0 +1,72 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef COMPRESSION_POLICY_HPP
+#define COMPRESSION_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * How much CPU time to spend on compressing a response. Each encoding maps
+ * this to a level of its own library.
+ */
+enum class compression_effort : uint8_t {
+  fast,
+  medium,
+  high
+};
+
+/**
+ * Picks the effort for a response from its expected size, if known, and
+ * the share of CPU time currently idle, between 0 and 1. Large responses,
+ * such as multi-megabyte /map calls, are compressed with the fast levels,
+ * as are all responses when the CPUs are nearly fully loaded.
+ */
+compression_effort choose_compression_effort(std::optional<std::size_t> expected_size,
+                                             double cpu_headroom);
+
+// how to compress a response
+struct compression_settings {
+  compression_effort effort = compression_effort::high;
+  // compress blocks of the response in parallel on the compression
+  // thread pool, if there is one
+  bool parallel = false;
+};
+
+/**
+ * Picks the effort as above. Responses expected to be large are also
+ * compressed in parallel, provided that at least half of the CPUs are
+ * idle.
+ */
+compression_settings choose_compression(std::optional<std::size_t> expected_size,
+                                        double cpu_headroom);
+
+/**
+ * Estimates the share of CPU time currently idle from the 1-minute load
+ * average and the number of CPUs. The value is refreshed at most once a
+ * second.
+ */
+double cpu_headroom();
+
+// the level to use for an effort, given the levels for each of them
+constexpr int compression_level(compression_effort effort, int fast,
+                                int medium, int high) {
+  switch (effort) {
+  case compression_effort::fast:
+    return fast;
+  case compression_effort::medium:
+    return medium;
+  default:
+    return high;
+  }
+}
+
+#endif /* COMPRESSION_POLICY_HPP */
@@ -15,6 +15,7 @@
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <set>
 #include <vector>
 #include <string>
@@ -30,6 +31,28 @@ class data_selection {
 public:
   enum visibility_t { exists, deleted, non_exist };
 
+  // an OAuth 2.0 access token together with the roles and status of the
+  // user it belongs to, i.e. everything needed to authenticate a request.
+  struct oauth2_user_details {
+    std::optional<osm_user_id_t> user_id; // empty for unknown tokens
+    bool expired{true};
+    bool revoked{true};
+    bool allow_api_write{false};
+    std::set<osm_user_role_t> roles;
+    bool blocked{false};
+    bool active{false};
+  };
+
+  // identifies the state of the selected nodes, ways and relations, for
+  // answering conditional requests.
+  struct selection_version {
+    // changes whenever anything that is written out for the selected
+    // elements changes, e.g. their versions or the names of their users
+    std::string digest;
+    // the time the most recently changed element was changed
+    std::chrono::system_clock::time_point last_modified;
+  };
+
   virtual ~data_selection() = default;
 
   data_selection() = default;
@@ -84,6 +107,28 @@ public:
   /// max_nodes
   virtual int select_nodes_from_bbox(const bbox &bounds, int max_nodes) = 0;
 
+  /// select everything needed for a map call: nodes within the bounding
+  /// box (up to a limit of max_nodes) and, if the limit isn't exceeded,
+  /// all ways using those nodes, all nodes of those ways, relations using
+  /// any of the selected nodes or ways and their parent relations. returns
+  /// the number of nodes found within the bounding box.
+  ///
+  /// backends which can compute the whole closure at once should override
+  /// this, the default implementation uses the individual selections.
+  virtual int select_map_closure(const bbox &bounds, int max_nodes) {
+    const int num_nodes = select_nodes_from_bbox(bounds, max_nodes);
+
+    // Short-circuit empty areas and requests which will be rejected
+    if (num_nodes > 0 && num_nodes <= max_nodes) {
+      select_ways_from_nodes();
+      select_nodes_from_way_nodes();
+      select_relations_from_ways();
+      select_relations_from_nodes();
+      select_relations_from_relations();
+    }
+    return num_nodes;
+  }
+
   /// selects the node members of any already selected relations
   virtual void select_nodes_from_relations() = 0;
 
@@ -153,6 +198,11 @@ public:
   virtual int select_historical_by_changesets(
     const std::vector<osm_changeset_id_t> &) = 0;
 
+  /// returns the version of the selected nodes, ways and relations, both
+  /// current and historic, without extracting them. backends which can't
+  /// find it cheaply return nothing, which disables conditional requests.
+  virtual std::optional<selection_version> get_selection_version() { return {}; }
+
   /****************** changeset functions **********************/
 
   /// select specified changesets, returning the number of
@@ -181,6 +231,26 @@ public:
   // is user status confirmed or active?
   virtual bool is_user_active(const osm_user_id_t) = 0;
 
+  /// looks up an OAuth 2.0 token and the roles and status of its user.
+  /// backends may override this to fetch everything at once, the default
+  /// implementation is based on the individual functions above.
+  virtual oauth2_user_details get_oauth2_user_details(const std::string &token_id) {
+    oauth2_user_details details;
+
+    details.user_id = get_user_id_for_oauth2_token(
+        token_id, details.expired, details.revoked, details.allow_api_write);
+
+    if (details.user_id) {
+      details.roles = get_roles_for_user(*details.user_id);
+
+      if (supports_user_details()) {
+        details.blocked = is_user_blocked(*details.user_id);
+        details.active = is_user_active(*details.user_id);
+      }
+    }
+    return details;
+  }
+
   /**
    * factory for the creation of data selections. this abstracts away
    * the creation process of transactions, and allows some up-front
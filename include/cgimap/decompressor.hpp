@@ -0,0 +1,61 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef DECOMPRESSOR_HPP
+#define DECOMPRESSOR_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * Thrown if a payload can't be decompressed, e.g. because it's corrupt
+ * or was compressed with a different Content-Encoding.
+ */
+class decompression_error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Decompresses a request payload according to its Content-Encoding.
+ */
+class Decompressor {
+public:
+  // receives decompressed data, which is only valid during the call.
+  using sink_t = std::function<void(std::string_view)>;
+
+  Decompressor() = default;
+  virtual ~Decompressor() = default;
+
+  Decompressor(const Decompressor &) = delete;
+  Decompressor& operator=(const Decompressor &) = delete;
+  Decompressor(Decompressor &&) = delete;
+  Decompressor& operator=(Decompressor &&) = delete;
+
+  /**
+   * Decompresses the next piece of the payload, which may have any size,
+   * and passes all output available so far to sink. Output is handed over
+   * straight from the decompressor's own buffer, so nothing is copied or
+   * allocated per call.
+   *
+   * @throws decompression_error if the input isn't valid.
+   */
+  virtual void decompress(std::string_view input, const sink_t &sink) = 0;
+};
+
+class IdentityDecompressor : public Decompressor {
+public:
+  void decompress(std::string_view input, const sink_t &sink) override {
+    if (!input.empty())
+      sink(input);
+  }
+};
+
+#endif /* DECOMPRESSOR_HPP */
@@ -19,7 +19,6 @@ struct fcgi_request : public request {
   fcgi_request(int socket, const std::chrono::system_clock::time_point &now);
   ~fcgi_request() override;
   const char *get_param(const char *key) const override;
-  std::string get_payload() override;
 
   // getting and setting the current time
   [[nodiscard]] std::chrono::system_clock::time_point get_current_time() const override;
@@ -31,9 +30,11 @@ struct fcgi_request : public request {
   int accept_r();
   static int open_socket(const std::string &, int);
   void dispose() override;
+  [[nodiscard]] output_stats get_output_stats() const override;
 
 protected:
   void write_header_info(int status, const http::headers_t &headers) override;
+  std::string_view read_body() override;
   output_buffer& get_buffer_internal() override;
   void finish_internal() override;
 
@@ -42,7 +43,6 @@ private:
   constexpr static unsigned int BUFFER_LEN = 512000;
   std::array<char, BUFFER_LEN> content_buffer{};
   std::unique_ptr<pimpl> m_impl;
-  std::unique_ptr<output_buffer> m_buffer;
 };
 
 #endif /* FCGI_REQUEST_HPP */
@@ -0,0 +1,35 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// large enough for any double with 7 decimal places
+using fixed_point_buffer = std::array<char, 384>;
+
+/**
+ * Formats a number with exactly 7 decimal places, the precision of the
+ * coordinates in the database, giving the same result as fmt's "{:.7f}".
+ * The returned string points into buf.
+ */
+std::string_view format_fixed_point(fixed_point_buffer &buf, double value);
+
+/**
+ * Formats value / scale with exactly 7 decimal places, for coordinates in
+ * the fixed-point format of the database. If scale is a power of ten up to
+ * 10^7 this is done on the integer directly, without rounding through a
+ * double, otherwise it's the same as formatting the double.
+ */
+std::string_view format_fixed_point(fixed_point_buffer &buf, int64_t value, int64_t scale);
+
+#endif /* FIXED_POINT_HPP */
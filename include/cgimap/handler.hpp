@@ -17,9 +17,11 @@
 #include "cgimap/http.hpp"
 
 #include <chrono>
+#include <cstddef>
 #include <vector>
 #include <string>
 #include <memory>
+#include <optional>
 
 
 /**
@@ -37,6 +39,20 @@ public:
 
   virtual std::vector<mime::type> types_available() const = 0; // TODO: don't reconstruct on every call
 
+  // rough size of the response in bytes, if it's known before writing it.
+  // this is used to pick how hard to compress the response.
+  virtual std::optional<std::size_t> expected_size() const { return {}; }
+
+  // the version of the data the response is made from, if it's known
+  // before writing the response. this is used to answer conditional
+  // requests without extracting or writing any data.
+  virtual std::optional<data_selection::selection_version> version() const { return {}; }
+
+  // whether the response only ever changes along with its version, so it
+  // can be kept in the response cache under its entity tag. this is asked
+  // again after writing, as a response with errors mustn't be kept.
+  virtual bool cacheable() const { return false; }
+
   bool is_available(mime::type) const;
 
 private:
@@ -96,6 +112,11 @@ public:
   // Indicates that this payload_enabled_handler requires the optional data_selection based handler to be called
   // after the database update
   virtual bool requires_selection_after_update() const = 0;
+
+  // Indicates that the responder receives the raw, possibly compressed payload and
+  // decompresses it itself with request::decode_payload while parsing it, instead of
+  // receiving the complete decompressed payload
+  virtual bool streams_payload() const { return false; }
 private:
   using handler::responder;
 };
@@ -10,6 +10,7 @@
 #ifndef HTTP_HPP
 #define HTTP_HPP
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -19,11 +20,20 @@
 #ifdef HAVE_LIBZ
 #include "cgimap/zlib.hpp"
 #endif
+#if HAVE_LIBDEFLATE
+#include "cgimap/libdeflate.hpp"
+#endif
 #if HAVE_BROTLI
 #include "cgimap/brotli.hpp"
 #endif
+#if HAVE_ZSTD
+#include "cgimap/zstd.hpp"
+#endif
 
+#include "cgimap/compression_policy.hpp"
+#include "cgimap/decompressor.hpp"
 #include "cgimap/output_buffer.hpp"
+#include "cgimap/parallel_compression.hpp"
 
 /**
  * Contains the generic HTTP methods and classes involved in the
@@ -268,7 +278,11 @@ public:
 
   const std::string &name() const { return name_; };
 
-  virtual std::unique_ptr<output_buffer>  buffer(output_buffer& out) {
+  // creates the output buffer encoding the response, compressing with the
+  // given effort, and in parallel if the settings ask for it and the
+  // encoding supports it.
+  virtual std::unique_ptr<output_buffer> buffer(output_buffer& out,
+                                                const compression_settings&) {
     return std::make_unique<identity_output_buffer>(out);
   }
 };
@@ -283,16 +297,44 @@ class deflate : public encoding {
 public:
   deflate() : encoding("deflate"){}
 
-  std::unique_ptr<output_buffer> buffer(output_buffer& out) override {
-    return std::make_unique<zlib_output_buffer>(out, zlib_output_buffer::mode::zlib);
+  std::unique_ptr<output_buffer> buffer(output_buffer& out,
+                                        const compression_settings& settings) override {
+    const auto effort = settings.effort;
+    const int zlib_level = compression_level(effort, 1, 4, Z_DEFAULT_COMPRESSION);
+    if (auto *pool = compression_thread_pool(); pool && settings.parallel) {
+      return std::make_unique<parallel_output_buffer>(
+          out, *pool, parallel_output_buffer::format::zlib, zlib_level);
+    }
+#if HAVE_LIBDEFLATE
+    return std::make_unique<libdeflate_output_buffer>(
+        out, zlib_output_buffer::mode::zlib, compression_level(effort, 1, 4, 6),
+        zlib_level);
+#else
+    return std::make_unique<zlib_output_buffer>(out, zlib_output_buffer::mode::zlib,
+                                                zlib_level);
+#endif
   }
 };
 
 class gzip : public encoding {
 public:
   gzip() : encoding("gzip"){}
-  std::unique_ptr<output_buffer> buffer(output_buffer& out) override {
-    return std::make_unique<zlib_output_buffer>(out, zlib_output_buffer::mode::gzip);
+  std::unique_ptr<output_buffer> buffer(output_buffer& out,
+                                        const compression_settings& settings) override {
+    const auto effort = settings.effort;
+    const int zlib_level = compression_level(effort, 1, 4, Z_DEFAULT_COMPRESSION);
+    if (auto *pool = compression_thread_pool(); pool && settings.parallel) {
+      return std::make_unique<parallel_output_buffer>(
+          out, *pool, parallel_output_buffer::format::gzip, zlib_level);
+    }
+#if HAVE_LIBDEFLATE
+    return std::make_unique<libdeflate_output_buffer>(
+        out, zlib_output_buffer::mode::gzip, compression_level(effort, 1, 4, 6),
+        zlib_level);
+#else
+    return std::make_unique<zlib_output_buffer>(out, zlib_output_buffer::mode::gzip,
+                                                zlib_level);
+#endif
   }
 };
 #endif /* HAVE_LIBZ */
@@ -302,8 +344,29 @@ public:
 class brotli : public encoding {
 public:
   brotli() : encoding("br"){}
-  std::unique_ptr<output_buffer> buffer(output_buffer& out) override {
-    return std::make_unique<brotli_output_buffer>(out);
+  // brotli streams can't be concatenated, so these are always compressed
+  // on a single thread
+  std::unique_ptr<output_buffer> buffer(output_buffer& out,
+                                        const compression_settings& settings) override {
+    return std::make_unique<brotli_output_buffer>(
+        out, compression_level(settings.effort, 1, 3, 5));
+  }
+};
+#endif
+
+#if HAVE_ZSTD
+
+class zstd : public encoding {
+public:
+  zstd() : encoding("zstd"){}
+  std::unique_ptr<output_buffer> buffer(output_buffer& out,
+                                        const compression_settings& settings) override {
+    const int level = compression_level(settings.effort, 1, 2, 3);
+    if (auto *pool = compression_thread_pool(); pool && settings.parallel) {
+      return std::make_unique<parallel_output_buffer>(
+          out, *pool, parallel_output_buffer::format::zstd, level);
+    }
+    return std::make_unique<zstd_output_buffer>(out, level);
   }
 };
 #endif
@@ -314,7 +377,7 @@ public:
  */
 std::unique_ptr<http::encoding> choose_encoding(const std::string &accept_encoding);
 
-std::unique_ptr<ZLibBaseDecompressor> get_content_encoding_handler(std::string_view content_encoding);
+std::unique_ptr<Decompressor> get_content_encoding_handler(std::string_view content_encoding);
 
 
 
@@ -342,6 +405,18 @@ std::optional<method> parse_method(std::string_view s);
 // parse CONTENT_LENGTH HTTP header
 unsigned long parse_content_length(const std::string &);
 
+// returns true if an If-None-Match header matches the entity tag, using
+// the weak comparison of RFC 9110, section 13.1.2.
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+// formats a time as an HTTP date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+std::string format_http_date(std::chrono::system_clock::time_point t);
+
+// parses an HTTP date in any of the three formats of RFC 9110, section
+// 5.6.7, with English names whatever the locale, or returns none if it
+// isn't a valid date.
+std::optional<std::chrono::system_clock::time_point> parse_http_date(const std::string &s);
+
 } // namespace http
 
 #endif /* HTTP_HPP */
@@ -14,6 +14,7 @@
 #include "cgimap/json_writer.hpp"
 
 #include <chrono>
+#include <memory>
 
 /**
  * Outputs a JSON-formatted document, which might be useful for javascript
@@ -48,6 +49,8 @@ public:
 
   void write_node(const element_info &elem, double lon, double lat,
                   const tags_t &tags) override;
+  void write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                  const tags_t &tags) override;
   void write_way(const element_info &elem, const nodes_t &nodes,
                  const tags_t &tags) override;
   void write_relation(const element_info &elem, const members_t &members,
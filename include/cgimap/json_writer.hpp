@@ -11,18 +11,21 @@
 #define JSON_WRITER_HPP
 
 #include <array>
+#include <charconv>
+#include <cstdint>
 #include <string>
 #include <string_view>
-
-#include <fmt/core.h>
-#include <fmt/compile.h>
-#include <yajl/yajl_gen.h>
+#include <vector>
 
 #include "cgimap/output_buffer.hpp"
 #include "cgimap/output_writer.hpp"
 
 /**
  * nice(ish) interface to writing a JSON file.
+ *
+ * The output is assembled in a large buffer and handed to the output
+ * buffer in big pieces. It's byte for byte the same as what yajl's
+ * generator produced with the same settings, which this replaces.
  */
 class json_writer : public output_writer {
 public:
@@ -46,37 +49,28 @@ public:
   void entry(bool b);
   void entry(double d);
 
+  // writes value / scale, for coordinates in the fixed-point format of the
+  // database
+  void entry(int64_t value, int64_t scale);
+
   template<typename TInteger>
   requires std::is_integral_v<TInteger>
   void entry(TInteger i) {
+    static_assert(sizeof(i) <= 8);
+    std::array<char, 32> buf;
 
-    const char* str = nullptr;
-    size_t len = 0;
-
-  #if FMT_VERSION >= 90000
-    std::array<char, 64> buf;
-    constexpr size_t max_chars = buf.size() - 1;
-    auto [end, n_written] = fmt::format_to_n(buf.begin(), max_chars, FMT_COMPILE("{:d}"), i);
-    if (n_written > max_chars)
+    auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), i);
+    if (ec != std::errc())
       throw write_error("cannot convert int attribute to string.");
-    *end = '\0'; // Null terminate string
-    str = buf.data();
-    len = n_written;
-  #else
-    auto s = fmt::format("{:d}", i);
-    str = s.c_str();
-    len = s.length();
-  #endif
-
-    yajl_gen_number(gen, str, len);
+
+    write_number(std::string_view(buf.data(), ptr - buf.data()));
   }
 
   template <typename T>
   requires std::is_convertible_v<T, std::string_view>
   void entry(T&& s)
   {
-    auto sv = std::string_view(s);
-    yajl_gen_string(gen, (const unsigned char *)sv.data(), sv.size());
+    write_string(std::string_view(s));
   }
 
   template <typename TKey, typename TValue>
@@ -90,12 +84,32 @@ public:
   void error(const std::string &) override;
 
 private:
-  void output_yajl_buffer(bool ignore_buffer_size);
+  // the buffer is handed over to the output once it grows beyond this
+  static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+  // what is expected next at each nesting level
+  enum class state : uint8_t {
+    start,
+    map_start,
+    map_key,
+    map_val,
+    array_start,
+    in_array,
+    complete
+  };
+
+  bool begin_value(bool is_string);
+  void end_value();
+  void open(state s, char c);
+  void close(char c);
+  void write_number(std::string_view number);
+  void write_string(std::string_view s);
+  void write_buffer();
 
-  yajl_gen gen;
   output_buffer& out;
-
-  constexpr static int MAX_BUFFER = 16384;
+  bool indent;
+  std::string buffer;
+  std::vector<state> states;
 };
 
 #endif /* JSON_WRITER_HPP */
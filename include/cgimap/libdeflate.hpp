@@ -0,0 +1,65 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef LIBDEFLATE_HPP
+#define LIBDEFLATE_HPP
+
+#if HAVE_LIBDEFLATE
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "cgimap/output_buffer.hpp"
+#include "cgimap/zlib.hpp"
+
+/**
+ * Compresses a response for the "gzip" or "deflate" Content-Encoding with
+ * libdeflate, which is considerably faster than zlib and compresses better,
+ * but only works on a whole buffer at once.
+ *
+ * The response is therefore collected in memory and compressed on close.
+ * Should it grow beyond BUFFER_LIMIT, it's streamed through zlib instead,
+ * which keeps the memory use of large responses bounded.
+ */
+class libdeflate_output_buffer : public output_buffer {
+public:
+  static constexpr std::size_t BUFFER_LIMIT = 1024 * 1024;
+
+  libdeflate_output_buffer(output_buffer& o, zlib_output_buffer::mode m,
+                           int level, int zlib_level);
+
+  libdeflate_output_buffer(const libdeflate_output_buffer &) = delete;
+  libdeflate_output_buffer& operator=(const libdeflate_output_buffer &) = delete;
+  libdeflate_output_buffer(libdeflate_output_buffer &&) = delete;
+  libdeflate_output_buffer& operator=(libdeflate_output_buffer &&) = delete;
+
+  ~libdeflate_output_buffer() override = default;
+
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override;
+  int written() const override;
+  int close() noexcept override;
+  int flush() noexcept override;
+
+private:
+  output_buffer& out;
+  zlib_output_buffer::mode mode;
+  int level;
+  int zlib_level;
+  // keep track of bytes written
+  std::size_t bytes_in = 0;
+  std::string pending;
+  // set once the response has grown too large for buffering
+  std::unique_ptr<zlib_output_buffer> streaming;
+};
+
+#endif
+
+#endif /* LIBDEFLATE_HPP */
@@ -22,6 +22,7 @@ enum class type {
   text_plain,
   application_xml,
   application_json,
+  application_x_protobuf,
   any_type // the "*/*" type used to mean that anything is acceptable.
 };
 
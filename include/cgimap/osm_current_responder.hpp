@@ -28,15 +28,31 @@ public:
                         data_selection &s,
                         std::optional<bbox> bounds = {});
 
+  // nodes, ways and relations can also be written as OSM PBF
+  std::vector<mime::type> types_available() const override;
+
   // writes whatever is in the tmp_nodes/ways/relations tables to the given
   // formatter.
   void write(output_formatter& f,
              const std::string &generator,
              const std::chrono::system_clock::time_point &now) override;
 
+  // the version of the selected elements, which are all written out
+  std::optional<data_selection::selection_version> version() const override;
+
 protected:
+  // whether writing the response ran into an error, in which case the
+  // response is incomplete.
+  bool write_failed() const;
+
   // current selection of elements to be written out
   data_selection& sel;
+
+  // whether the selection may include old versions or deleted elements
+  bool historical = false;
+
+private:
+  bool failed = false;
 };
 
 #endif /* OSM_CURRENT_RESPONDER_HPP */
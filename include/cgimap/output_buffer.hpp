@@ -10,8 +10,15 @@
 #ifndef OUTPUT_BUFFER_HPP
 #define OUTPUT_BUFFER_HPP
 
+#include <cstddef>
+#include <span>
 #include <string_view>
 
+// size of the pieces in which output is handed to the client. buffers
+// which produce their output in chunks of their own, e.g. for compression,
+// use this size so that their chunks can be passed on without copying.
+inline constexpr std::size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
+
 /**
  * Implement this interface to provide custom output.
  */
@@ -20,6 +27,19 @@ struct output_buffer {
   // that don't support exceptions. A return code of -1 is used instead to signal errors.
   virtual int write(const char *buffer, int len) noexcept = 0;
   virtual int write(std::string_view str) noexcept { return write(str.data(), str.size()); }
+  // writes several pieces of data in order. implementations may hand them
+  // on together, e.g. in a single system call. returns the total number of
+  // bytes written, or -1 on error.
+  virtual int write_chunks(std::span<const std::string_view> chunks) noexcept {
+    int total = 0;
+    for (const auto &chunk : chunks) {
+      const int rc = write(chunk);
+      if (rc < 0)
+        return rc;
+      total += rc;
+    }
+    return total;
+  }
   virtual int written() const = 0;
   virtual int close() noexcept = 0;
   virtual int flush() noexcept = 0;
@@ -156,6 +156,15 @@ struct member_info {
   bool operator==(const member_info &other) const = default;
 };
 
+// location of a node as stored in the database, i.e. in units of
+// 1 / global_settings::get_scale() degrees.
+struct fixed_lonlat {
+  int64_t lon;
+  int64_t lat;
+
+  bool operator==(const fixed_lonlat &other) const = default;
+};
+
 using nodes_t = std::vector<osm_nwr_id_t>;
 using members_t = std::vector<member_info>;
 using tags_t = std::vector<std::pair<std::string, std::string> >;
@@ -197,6 +206,11 @@ struct output_formatter {
   virtual void start_document(
     const std::string &generator, const std::string &root_name) = 0;
 
+  // may be called before start_document if the document can contain old
+  // versions or deleted elements, for formats which have to declare that
+  // before the first element. does nothing by default.
+  virtual void set_historical(bool) {}
+
   // called once to end the document - there will be no calls after this
   // one. this will be called, even if an error has occurred.
   virtual void end_document() = 0;
@@ -227,6 +241,12 @@ struct output_formatter {
   virtual void write_node(const element_info &elem, double lon, double lat,
                           const tags_t &tags) = 0;
 
+  // output a single node with its location as stored in the database.
+  // formatters printing coordinates override this to print the integers
+  // directly, the default converts them to degrees for the above.
+  virtual void write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                          const tags_t &tags);
+
   // output a single way given a row and iterators for nodes and tags
   virtual void write_way(const element_info &elem, const nodes_t &nodes,
                          const tags_t &tags) = 0;
@@ -0,0 +1,103 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef PARALLEL_COMPRESSION_HPP
+#define PARALLEL_COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+
+#include "cgimap/output_buffer.hpp"
+#include "cgimap/thread_pool.hpp"
+
+/**
+ * Sets the number of threads of the compression thread pool. Zero, the
+ * default, disables parallel compression. This has to be called before
+ * the first request is processed.
+ */
+void set_compression_threads(unsigned int threads);
+
+/**
+ * The thread pool shared by all requests of the process for compressing
+ * large responses, or nullptr if parallel compression is disabled. The
+ * threads are only started on first use, i.e. after any forking.
+ */
+thread_pool *compression_thread_pool();
+
+/**
+ * Compresses a response in independent blocks on a thread pool, the way
+ * pigz does, and writes the compressed blocks in order.
+ *
+ * For gzip and zlib, each block is a piece of a single deflate stream:
+ * blocks end on a byte boundary with a sync flush, and use the end of the
+ * previous block as their dictionary, so the compression ratio is close
+ * to that of a single stream. The checksums of the blocks are combined
+ * for the trailer. For zstd, each block is a separate frame, and a stream
+ * of several frames is a valid zstd stream.
+ *
+ * The last block is compressed on the calling thread, so responses which
+ * fit into a single block are compressed without any hand over.
+ */
+class parallel_output_buffer : public output_buffer {
+public:
+  enum class format { gzip, zlib, zstd };
+
+  parallel_output_buffer(output_buffer& o, thread_pool& pool, format f, int level);
+
+  parallel_output_buffer(const parallel_output_buffer &) = delete;
+  parallel_output_buffer& operator=(const parallel_output_buffer &) = delete;
+  parallel_output_buffer(parallel_output_buffer &&) = delete;
+  parallel_output_buffer& operator=(parallel_output_buffer &&) = delete;
+
+  ~parallel_output_buffer() override;
+
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override;
+  int written() const override;
+  int close() noexcept override;
+  int flush() noexcept override;
+
+  struct compressed_block {
+    std::string data;
+    // crc32 or adler32 of the uncompressed block
+    uint32_t check = 0;
+    std::size_t size = 0;
+  };
+
+private:
+  void submit_block(bool last);
+  void write_blocks(bool all);
+  void write_header();
+  void write_trailer();
+  void write_data(std::string_view data);
+
+  output_buffer& out;
+  thread_pool& pool;
+  format type;
+  int level;
+  std::size_t block_size;
+
+  std::string block;
+  // the end of the previous block, for deflate
+  std::string dictionary;
+  // blocks being compressed, in order
+  std::deque<std::future<compressed_block>> pending;
+
+  // keep track of bytes written
+  std::size_t bytes_in = 0;
+  // combined checksum of the blocks written so far
+  uint32_t check;
+  bool header_written = false;
+  bool frame_written = false;
+};
+
+#endif /* PARALLEL_COMPRESSION_HPP */
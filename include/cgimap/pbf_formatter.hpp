@@ -0,0 +1,144 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef PBF_FORMATTER_HPP
+#define PBF_FORMATTER_HPP
+
+#include "cgimap/output_formatter.hpp"
+#include "cgimap/pbf_writer.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Outputs an OSM PBF file, which is a lot smaller and cheaper to parse
+ * than XML. Nodes are written as dense nodes, ids, coordinates and the
+ * metadata are delta coded and each block has its own string table.
+ *
+ * PBF can only carry nodes, ways and relations, so this is only offered
+ * for responses made of those.
+ */
+class pbf_formatter : public output_formatter {
+public:
+  // a block is written once it has this many elements, the same number
+  // as used by osmium and osmosis.
+  static constexpr std::size_t MAX_BLOCK_ELEMENTS = 8000;
+
+  // ... or once it's roughly this large, well below the 32 MB limit of
+  // the format, which only matters for long ways and large relations.
+  static constexpr std::size_t MAX_BLOCK_BYTES = 8 * 1024 * 1024;
+
+  explicit pbf_formatter(std::unique_ptr<pbf_writer> w);
+  ~pbf_formatter() override;
+
+  mime::type mime_type() const override;
+
+  void set_historical(bool) override;
+  void start_document(const std::string &generator, const std::string &root_name) override;
+  void end_document() override;
+  void write_bounds(const bbox &bounds) override;
+
+  void start_element() override;
+  void end_element() override;
+  void start_changeset(bool) override;
+  void end_changeset(bool) override;
+
+  void start_action(action_type type) override;
+  void end_action(action_type type) override;
+  void error(const std::exception &e) override;
+
+  void write_node(const element_info &elem, double lon, double lat,
+                  const tags_t &tags) override;
+  void write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                  const tags_t &tags) override;
+  void write_way(const element_info &elem, const nodes_t &nodes,
+                 const tags_t &tags) override;
+  void write_relation(const element_info &elem, const members_t &members,
+                      const tags_t &tags) override;
+
+  void write_changeset(const changeset_info &elem,
+                       const tags_t &tags,
+                       bool include_comments,
+                       const comments_t &comments,
+                       const std::chrono::system_clock::time_point &now) override;
+
+  void write_diffresult_create_modify(const element_type elem,
+                                      const osm_nwr_signed_id_t old_id,
+                                      const osm_nwr_id_t new_id,
+                                      const osm_version_t new_version) override;
+  void write_diffresult_delete(const element_type elem,
+                               const osm_nwr_signed_id_t old_id) override;
+
+  void flush() override;
+  void error(const std::string &) override;
+
+private:
+  // column wise storage of the nodes of the current block
+  struct dense_columns {
+    std::vector<int64_t> ids;
+    std::vector<int64_t> lats;
+    std::vector<int64_t> lons;
+    std::vector<int32_t> versions;
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> changesets;
+    std::vector<int32_t> uids;
+    std::vector<int32_t> user_sids;
+    std::vector<bool> visible;
+    std::vector<uint32_t> keys_vals;
+
+    [[nodiscard]] bool empty() const { return ids.empty(); }
+    void clear();
+  };
+
+  uint32_t string_id(const std::string &s);
+  // lon and lat are in units of the block granularity
+  void add_node(const element_info &elem, int64_t lon, int64_t lat,
+                const tags_t &tags);
+  void start_block(element_type type);
+  void write_info(pbf_message &msg, const element_info &elem);
+  void write_tags(pbf_message &msg, const tags_t &tags);
+  void write_header();
+  void write_block();
+
+  std::unique_ptr<pbf_writer> writer;
+
+  std::string generator;
+  std::optional<bbox> bounds;
+  bool header_written = false;
+  // whether the header declares historical information, which is decided
+  // by the responder, as deleted elements may first turn up in later blocks.
+  bool historical = false;
+  bool has_deleted = false;
+  bool failed = false;
+
+  // state of the current block
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, uint32_t> string_ids;
+  element_type block_type = element_type::node;
+  std::size_t block_elements = 0;
+  dense_columns nodes;
+  pbf_message ways;
+  pbf_message relations;
+
+  // scratch space, kept to reuse allocations
+  pbf_message element;
+  pbf_message metadata;
+  pbf_message block;
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> vals;
+  std::vector<int64_t> deltas;
+  std::vector<int32_t> roles;
+  std::vector<uint32_t> types;
+};
+
+#endif /* PBF_FORMATTER_HPP */
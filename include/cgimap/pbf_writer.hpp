@@ -0,0 +1,112 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef PBF_WRITER_HPP
+#define PBF_WRITER_HPP
+
+#include "cgimap/output_buffer.hpp"
+#include "cgimap/output_writer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Minimal protocol buffers encoder, just enough to build the messages of
+ * the OSM PBF format. Fields are appended in the order they're added.
+ */
+class pbf_message {
+public:
+  // int32, int64, uint32, uint64, bool and enum fields
+  void add_uint(uint32_t field, uint64_t value);
+
+  // sint32 and sint64 fields (zigzag encoded)
+  void add_sint(uint32_t field, int64_t value);
+
+  // string, bytes and embedded message fields
+  void add_bytes(uint32_t field, std::string_view value);
+  void add_message(uint32_t field, const pbf_message &msg) { add_bytes(field, msg.data()); }
+
+  // packed repeated fields
+  template <typename T>
+  void add_packed_uint(uint32_t field, const std::vector<T> &values) {
+    if (values.empty())
+      return;
+    packed.clear();
+    for (auto v : values)
+      append_varint(packed, static_cast<uint64_t>(v));
+    add_bytes(field, packed);
+  }
+
+  template <typename T>
+  void add_packed_sint(uint32_t field, const std::vector<T> &values) {
+    if (values.empty())
+      return;
+    packed.clear();
+    for (auto v : values)
+      append_varint(packed, zigzag(v));
+    add_bytes(field, packed);
+  }
+
+  [[nodiscard]] std::string_view data() const { return buf; }
+  [[nodiscard]] std::size_t size() const { return buf.size(); }
+  [[nodiscard]] bool empty() const { return buf.empty(); }
+  void clear() { buf.clear(); }
+
+  static void append_varint(std::string &out, uint64_t value);
+
+  static constexpr uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+  }
+
+private:
+  std::string buf;
+  // scratch space for packed fields, kept to reuse its allocation
+  std::string packed;
+};
+
+/**
+ * Writes the file blocks of an OSM PBF file, see
+ * https://wiki.openstreetmap.org/wiki/PBF_Format
+ */
+class pbf_writer : public output_writer {
+public:
+  pbf_writer(const pbf_writer &) = delete;
+  pbf_writer& operator=(const pbf_writer &) = delete;
+  pbf_writer(pbf_writer &&) = delete;
+  pbf_writer& operator=(pbf_writer &&) = delete;
+
+  explicit pbf_writer(output_buffer &out);
+
+  // closes the output buffer, which ends the response, like the other
+  // writers do.
+  ~pbf_writer() noexcept override;
+
+  // zlib compresses the serialised block and writes it as a blob of the
+  // given type ("OSMHeader" or "OSMData"), prefixed by its blob header.
+  void write_block(std::string_view type, const pbf_message &block);
+
+  // flushes the output buffer
+  void flush() override;
+
+  // PBF has no way to signal an error in-band, so all we can do is to
+  // stop writing blocks, leaving the client with a truncated file.
+  void error(const std::string &) override;
+
+private:
+  output_buffer& out;
+  bool failed = false;
+
+  std::string compressed;
+  pbf_message blob;
+  pbf_message blob_header;
+};
+
+#endif /* PBF_WRITER_HPP */
@@ -15,15 +15,18 @@
 #include "cgimap/data_update.hpp"
 #include "cgimap/data_selection.hpp"
 #include "cgimap/routes.hpp"
+#include "cgimap/response_cache.hpp"
 
 #include <string>
 
 /**
- * process a single request.
+ * process a single request. responses which can be cached are looked up
+ * in and added to the cache, if there is one.
  */
 void process_request(request &req, rate_limiter &limiter,
                      const std::string &generator, const routes &route,
                      data_selection::factory& factory,
-                     data_update::factory* update_factory);
+                     data_update::factory* update_factory,
+                     response_cache *cache = nullptr);
 
 #endif /* PROCESS_REQUEST_HPP */
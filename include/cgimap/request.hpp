@@ -13,6 +13,8 @@
 #include "cgimap/http.hpp"
 
 #include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <string_view>
 
@@ -46,7 +48,19 @@ struct request {
 
   // get payload provided for the request. this is useful in particular
   // for HTTP POST and PUT requests.
-  virtual std::string get_payload() = 0;
+  std::string get_payload();
+
+  // read the complete raw payload as sent by the client, i.e. still
+  // compressed according to the Content-Encoding header. the payload can
+  // only be read once.
+  std::string read_raw_payload();
+
+  // decompress a payload from read_raw_payload() according to the
+  // Content-Encoding header, passing it to consumer piece by piece, so the
+  // complete decompressed payload never has to be held in memory. the
+  // payload size limit applies to the decompressed bytes so far.
+  void decode_payload(std::string_view raw,
+                      const std::function<void(std::string_view)> &consumer) const;
 
   /********************** RESPONSE HEADER FUNCTIONS **************************/
 
@@ -91,6 +105,17 @@ struct request {
   // dispose of any resources allocated to the request.
   virtual void dispose() = 0;
 
+  // how the response was written: the number of writes to the output buffer,
+  // the number of system calls it took to send them to the client and the
+  // size of the (possibly compressed) body as sent. not all output systems
+  // keep track of this.
+  struct output_stats {
+    uint64_t writes = 0;
+    uint64_t syscalls = 0;
+    uint64_t body_bytes = 0;
+  };
+  [[nodiscard]] virtual output_stats get_output_stats() const { return {}; }
+
   /******************** RANDOM FUDGE FUNCTION *******************************/
 
   void set_default_methods(http::method);
@@ -103,6 +128,11 @@ protected:
   // status & header information.
   virtual void write_header_info(int status, const http::headers_t &headers) = 0;
 
+  // returns the next chunk of the raw (possibly compressed) request body, or
+  // an empty string_view at the end of the body. the chunk is only valid
+  // until the next call.
+  virtual std::string_view read_body() = 0;
+
   // internal functions.
   // TODO: this is really bad design and indicates this should probably use
   // composition rather than inheritance.
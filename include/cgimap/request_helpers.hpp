@@ -12,6 +12,7 @@
 
 #include "cgimap/request.hpp"
 #include "cgimap/http.hpp"
+#include "cgimap/mime_types.hpp"
 
 #include <string>
 #include <memory>
@@ -40,9 +41,11 @@ std::string get_query_string(const request &req);
 std::string get_request_path(const request &req);
 
 /**
- * get encoding to use for response.
+ * get encoding to use for a response of the given mime type. PBF
+ * responses are always sent with identity encoding, as their blobs are
+ * compressed already.
  */
-std::unique_ptr<http::encoding> get_encoding(const request &req);
+std::unique_ptr<http::encoding> get_encoding(const request &req, mime::type mt);
 
 /**
  * return shared pointer to a buffer object which can be
@@ -0,0 +1,128 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <libmemcached/memcached.h>
+#include <boost/program_options.hpp>
+
+// a response as sent to the client, i.e. after compression
+struct cached_response {
+  std::string body;
+  // size of the response before compression
+  std::size_t written = 0;
+};
+
+/**
+ * Thread safe LRU cache of responses, bounded by the total size of the
+ * keys and bodies it holds.
+ */
+class memory_response_cache {
+public:
+  explicit memory_response_cache(std::size_t capacity);
+
+  std::optional<cached_response> get(const std::string &key);
+
+  // responses larger than an eighth of the capacity aren't stored, so
+  // that a single one can't push out most of the others.
+  void put(const std::string &key, const cached_response &response);
+
+  // total size of the keys and bodies held
+  [[nodiscard]] std::size_t bytes() const;
+  [[nodiscard]] std::size_t size() const;
+
+  // cache shared by all worker threads of this process, which is created
+  // with the given capacity on first use. returns nullptr if it is 0.
+  static std::shared_ptr<memory_response_cache> shared(std::size_t capacity);
+
+private:
+  struct entry {
+    std::string key;
+    cached_response response;
+  };
+
+  using entry_list = std::list<entry>;
+
+  const std::size_t m_capacity;
+  std::size_t m_bytes = 0;
+
+  mutable std::mutex m_mutex;
+  // most recently used entries first
+  entry_list m_entries;
+  std::unordered_map<std::string, entry_list::iterator> m_index;
+};
+
+/**
+ * Cache of complete responses which can only change along with their
+ * version (see responder::cacheable), such as historic versions of
+ * elements. Hits skip extracting, formatting and compressing the data.
+ *
+ * Entries are keyed by the request and the response's entity tag, which
+ * covers the versions and redaction ids of the elements, whether the
+ * client may see redacted versions, the format and the encoding. When a
+ * version is redacted, the key of every response containing it changes,
+ * so nothing has to be invalidated: the old entries are no longer looked
+ * up and get evicted, or expire in memcached.
+ *
+ * Responses are looked up in memory first, then in memcached if that is
+ * enabled, in which case they're shared by all processes using it.
+ */
+class response_cache {
+public:
+  // counters for all response caches of the process
+  struct statistics {
+    uint64_t memory_hits = 0;
+    uint64_t shared_hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+  };
+
+  // sets up the cache from the response-cache-size (in MB),
+  // response-cache-memcache and memcache options.
+  explicit response_cache(const boost::program_options::variables_map &options);
+
+  // memory may be nullptr, and memcached isn't used if memcache_servers
+  // is empty.
+  response_cache(std::shared_ptr<memory_response_cache> memory,
+                 const std::string &memcache_servers);
+
+  ~response_cache();
+
+  response_cache(const response_cache &) = delete;
+  response_cache& operator=(const response_cache &) = delete;
+  response_cache(response_cache &&) = delete;
+  response_cache& operator=(response_cache &&) = delete;
+
+  [[nodiscard]] bool enabled() const;
+
+  std::optional<cached_response> get(const std::string &key);
+  void put(const std::string &key, const cached_response &response);
+
+  static statistics get_statistics();
+
+private:
+  std::optional<cached_response> get_shared(const std::string &key);
+  void put_shared(const std::string &key, const cached_response &response);
+
+  std::shared_ptr<memory_response_cache> m_memory;
+  // not thread safe, so each worker has its own connection
+  memcached_st *m_memcached = nullptr;
+};
+
+#endif /* RESPONSE_CACHE_HPP */
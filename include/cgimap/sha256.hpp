@@ -0,0 +1,20 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <string>
+#include <string_view>
+
+// SHA-256 digest of data as lowercase hex string, same as Postgres'
+// encode(sha256(data), 'hex').
+std::string sha256_hex(std::string_view data);
+
+#endif /* SHA256_HPP */
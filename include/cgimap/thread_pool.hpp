@@ -0,0 +1,65 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A fixed number of threads running tasks in the order they were
+ * submitted. The threads don't receive any signals, so that these still
+ * interrupt the request threads.
+ */
+class thread_pool {
+public:
+  explicit thread_pool(unsigned int threads);
+
+  // waits for the tasks already submitted to finish
+  ~thread_pool();
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool& operator=(const thread_pool &) = delete;
+  thread_pool(thread_pool &&) = delete;
+  thread_pool& operator=(thread_pool &&) = delete;
+
+  // runs f on one of the threads. the result, or any exception thrown,
+  // is passed on through the future.
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F &&f) {
+    using result_t = std::invoke_result_t<F>;
+
+    auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(f));
+    auto future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+  }
+
+  [[nodiscard]] unsigned int size() const { return m_threads.size(); }
+
+private:
+  void enqueue(std::function<void()> task);
+  void run();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_tasks;
+  bool m_stopping = false;
+  std::vector<std::thread> m_threads;
+};
+
+#endif /* THREAD_POOL_HPP */
@@ -13,6 +13,8 @@
 #include "cgimap/output_formatter.hpp"
 #include "cgimap/xml_writer.hpp"
 
+#include <memory>
+
 /**
  * Outputs an XML-formatted document, i.e: the OSM document type we all know
  * and love.
@@ -45,6 +47,8 @@ public:
 
   void write_node(const element_info &elem, double lon, double lat,
                   const tags_t &tags) override;
+  void write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                  const tags_t &tags) override;
   void write_way(const element_info &elem, const nodes_t &nodes,
                  const tags_t &tags) override;
   void write_relation(const element_info &elem, const members_t &members,
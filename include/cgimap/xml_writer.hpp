@@ -13,22 +13,26 @@
 #include "cgimap/output_buffer.hpp"
 #include "cgimap/output_writer.hpp"
 
-#include <libxml/encoding.h>
-#include <libxml/xmlwriter.h>
-
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <charconv>
 #include <array>
+#include <vector>
 
 /**
  * Writes UTF-8 output to a file or stdout.
+ *
+ * The output is assembled in a large buffer and handed to the output
+ * buffer in big pieces. It's byte for byte the same as what libxml2's
+ * xmlTextWriter produces with the same settings, which this replaces.
  */
 class xml_writer : public output_writer {
 public:
   xml_writer(const xml_writer &) = delete;
   xml_writer& operator=(const xml_writer &) = delete;
-  xml_writer(xml_writer &&) = default;
-  xml_writer& operator=(xml_writer &&) = default;
+  xml_writer(xml_writer &&) = delete;
+  xml_writer& operator=(xml_writer &&) = delete;
 
   // create a new XML writer using writer callback functions
   explicit xml_writer(output_buffer &out, bool indent = false);
@@ -50,6 +54,10 @@ public:
   void attribute(const char *name, double value);
   void attribute(const char *name, bool value);
 
+  // write value / scale, for coordinates in the fixed-point format of the
+  // database
+  void attribute(const char *name, int64_t value, int64_t scale);
+
   template<typename T>
   inline void attribute(const std::string &name, T value) { attribute(name.c_str(), value); }
 
@@ -59,15 +67,12 @@ public:
     static_assert(sizeof(value) <= 8);
     std::array<char, 32> buf;
 
-    auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size() - 1, value);
+    auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
     if (ec != std::errc())
       throw write_error("cannot convert integer attribute to string.");
 
-    *ptr = '\0'; // Null terminate string
-    int rc = writeAttribute(name, buf.data());
-    if (rc < 0) {
-      throw write_error("cannot write integer attribute.");
-    }
+    // digits never need escaping
+    write_attribute_raw(name, std::string_view(buf.data(), ptr - buf.data()));
   }
 
   // write a child text element
@@ -83,9 +88,27 @@ public:
   void error(const std::string &) override;
 
 private:
-  int writeAttribute(const char* name, const char* value);
-
-  xmlTextWriterPtr writer;
+  // the buffer is handed over to the output once it grows beyond this
+  static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+  struct open_element {
+    std::string name;
+    // true while the start tag is still open for attributes
+    bool in_start_tag;
+  };
+
+  void close_start_tag();
+  void write_indent();
+  void write_attribute_raw(const char *name, std::string_view value);
+  void write_escaped(std::string_view s, bool attribute);
+  void write_buffer();
+
+  output_buffer& out;
+  const bool indent;
+  // indent the next end tag, i.e. the last thing written wasn't text
+  bool indent_end_tag = true;
+  std::string buffer;
+  std::vector<open_element> elements;
 };
 
 #endif /* WRITER_HPP */
@@ -17,6 +17,7 @@
 const unsigned int ZLIB_COMPLETE_CHUNK = 16384;
 
 #include <zlib.h>
+#include "cgimap/decompressor.hpp"
 #include "cgimap/output_buffer.hpp"
 
 /**
@@ -32,7 +33,7 @@ public:
   /**
    * Methods.
    */
-  zlib_output_buffer(output_buffer& o, mode m);
+  zlib_output_buffer(output_buffer& o, mode m, int level = Z_DEFAULT_COMPRESSION);
 
   zlib_output_buffer(const zlib_output_buffer &old) = delete;
   zlib_output_buffer& operator=(const zlib_output_buffer &old) = delete;
@@ -56,38 +57,32 @@ private:
   // update unless its flushed.
   size_t bytes_in = 0;
   z_stream stream{};
-  char outbuf[4096];
+  char outbuf[OUTPUT_CHUNK_SIZE];
 };
 
 /*******************************************************************************/
 
 // parts adopted from https://github.com/rudi-cilibrasi/zlibcomplete
 
-class ZLibBaseDecompressor {
+class ZLibBaseDecompressor : public Decompressor {
 public:
   /**
-  * @brief Decompression function for gzip using std::string.
+  * @brief Decompression function for zlib and gzip streams.
   *
-  * Accepts a std::string of any size containing compressed data.  Returns
-  * as much gzip uncompressed data as possible.  Call this function over
-  * and over with all the compressed data in a stream in order to decompress
-  * the entire stream.
-  * @param input Any amount of data to decompress.
-  * @retval std::string containing the decompressed data.
+  * Accepts input of any size containing compressed data, and inflates it
+  * directly from the caller's memory. Call this function over and over with
+  * all the compressed data in a stream in order to decompress the entire
+  * stream.
   */
-  std::string decompress(const std::string& input);
-  ~ZLibBaseDecompressor();
+  void decompress(std::string_view input, const sink_t &sink) override;
+  ~ZLibBaseDecompressor() override;
 
 protected:
-  ZLibBaseDecompressor() = default;
   explicit ZLibBaseDecompressor(int windowBits);
 
-
 private:
-  char inbuf[ZLIB_COMPLETE_CHUNK];
   char outbuf[ZLIB_COMPLETE_CHUNK];
   z_stream stream{};
-  bool use_decompression{false};
 };
 
 class ZLibDecompressor : public ZLibBaseDecompressor {
@@ -100,9 +95,4 @@ public:
   GZipDecompressor();
 };
 
-class IdentityDecompressor : public ZLibBaseDecompressor {
-public:
-  IdentityDecompressor();
-};
-
 #endif /* ZLIB_HPP */
@@ -0,0 +1,67 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#ifndef ZSTD_HPP
+#define ZSTD_HPP
+
+#if HAVE_ZSTD
+
+#include <zstd.h>
+
+#include "cgimap/decompressor.hpp"
+#include "cgimap/output_buffer.hpp"
+
+/**
+ * Compresses a response with Zstandard, for the "zstd" Content-Encoding.
+ */
+class zstd_output_buffer : public output_buffer {
+public:
+  zstd_output_buffer(output_buffer& o, int level);
+
+  zstd_output_buffer(const zstd_output_buffer &) = delete;
+  zstd_output_buffer& operator=(const zstd_output_buffer &) = delete;
+  zstd_output_buffer(zstd_output_buffer &&) = delete;
+  zstd_output_buffer& operator=(zstd_output_buffer &&) = delete;
+
+  ~zstd_output_buffer() override;
+
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override;
+  int written() const override;
+  int close() noexcept override;
+  int flush() noexcept override;
+
+private:
+  int compress(const char *data, std::size_t len, ZSTD_EndDirective mode) noexcept;
+
+  output_buffer& out;
+  ZSTD_CCtx *ctx = nullptr;
+  // keep track of bytes written
+  std::size_t bytes_in = 0;
+  char outbuf[OUTPUT_CHUNK_SIZE];
+};
+
+/**
+ * Decompresses a Zstandard ("zstd") encoded payload.
+ */
+class ZstdDecompressor : public Decompressor {
+public:
+  ZstdDecompressor();
+  ~ZstdDecompressor() override;
+
+  void decompress(std::string_view input, const sink_t &sink) override;
+
+private:
+  ZSTD_DCtx *ctx = nullptr;
+  char outbuf[ZSTD_BLOCKSIZE_MAX];
+};
+
+#endif
+
+#endif /* ZSTD_HPP */
@@ -48,6 +48,10 @@ changeset_update_sel_responder::changeset_update_sel_responder(
   sel.select_changesets({changeset_id});
 }
 
+std::vector<mime::type> changeset_update_sel_responder::types_available() const {
+  return osm_responder::types_available();
+}
+
 
 changeset_update_handler::changeset_update_handler(const request &, osm_changeset_id_t id)
     : payload_enabled_handler(mime::type::application_xml,
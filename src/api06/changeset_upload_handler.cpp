@@ -25,13 +25,14 @@
 #include <fmt/core.h>
 
 #include <string>
+#include <string_view>
 
 namespace api06 {
 
 changeset_upload_responder::changeset_upload_responder(mime::type mt,
                                                        data_update& upd,
                                                        osm_changeset_id_t changeset,
-                                                       const std::string &payload,
+                                                       std::string_view raw_payload,
                                                        const RequestContext& req_ctx)
     : osm_diffresult_responder(mt) {
 
@@ -53,7 +54,13 @@ changeset_upload_responder::changeset_upload_responder(mime::type mt,
 
   // TODO: check HTTP Accept header
   if (mt != mime::type::application_json) {
-    OSMChangeXMLParser(handler).process_message(payload);
+    // objects are passed on to the updaters while the payload is being
+    // decompressed, so it's never held in memory decompressed as a whole.
+    OSMChangeXMLParser parser(handler);
+    req_ctx.req.decode_payload(raw_payload, [&parser](std::string_view chunk) {
+      parser.process_chunk(chunk);
+    });
+    parser.finish_message();
   }
 
   // store diffresult for output handling in class osm_diffresult_responder
@@ -124,4 +131,8 @@ bool changeset_upload_handler::requires_selection_after_update() const {
   return false;
 }
 
+bool changeset_upload_handler::streams_payload() const {
+  return true;
+}
+
 } // namespace api06
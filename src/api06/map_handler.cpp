@@ -19,11 +19,19 @@
 
 namespace api06 {
 
+namespace {
+
+// rough size of a node in the response, together with its share of the
+// ways and relations using it.
+constexpr std::size_t BYTES_PER_NODE = 250;
+
+} // anonymous namespace
+
 map_responder::map_responder(mime::type mt, bbox b, data_selection &x)
     : osm_current_responder(mt, x, std::optional<bbox>(b)) {
-  // create temporary tables of nodes, ways and relations which
-  // are in or used by elements in the bbox
-  uint32_t num_nodes = sel.select_nodes_from_bbox(b, global_settings::get_map_max_nodes());
+  // select nodes, ways and relations which are in or used by elements
+  // in the bbox
+  num_nodes = sel.select_map_closure(b, global_settings::get_map_max_nodes());
 
   if (num_nodes > global_settings::get_map_max_nodes()) {
     throw http::bad_request(
@@ -31,14 +39,10 @@ map_responder::map_responder(mime::type mt, bbox b, data_selection &x)
                 "Either request a smaller area, or use planet.osm",
             global_settings::get_map_max_nodes()));
   }
-  // Short-circuit empty areas
-  if (num_nodes > 0) {
-    sel.select_ways_from_nodes();
-    sel.select_nodes_from_way_nodes();
-    sel.select_relations_from_ways();
-    sel.select_relations_from_nodes();
-    sel.select_relations_from_relations();
-  }
+}
+
+std::optional<std::size_t> map_responder::expected_size() const {
+  return std::size_t{num_nodes} * BYTES_PER_NODE;
 }
 
 map_handler::map_handler(request &req) : bounds(validate_request(req)) {
@@ -15,11 +15,17 @@ namespace api06 {
 node_history_responder::node_history_responder(mime::type mt, osm_nwr_id_t id, data_selection &w)
   : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_nodes_with_history({id}) == 0) {
     throw http::not_found("");
   }
 }
 
+bool node_history_responder::cacheable() const {
+  return !write_failed();
+}
+
 node_history_handler::node_history_handler(const request &, osm_nwr_id_t id) : id(id) {}
 
 std::string node_history_handler::log_name() const { return "node/history"; }
@@ -18,11 +18,17 @@ node_version_responder::node_version_responder(mime::type mt,
                                                data_selection &w)
     : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_historical_nodes({std::make_pair(id, v)}) == 0) {
      throw http::not_found("");
   }
 }
 
+bool node_version_responder::cacheable() const {
+  return !write_failed();
+}
+
 node_version_handler::node_version_handler(const request &, osm_nwr_id_t id, osm_version_t v) :
   id(id), v(v) {}
 
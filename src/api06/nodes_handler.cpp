@@ -21,6 +21,8 @@ nodes_responder::nodes_responder(mime::type mt, const std::vector<id_version> &i
                                  data_selection &w)
     : osm_current_responder(mt, w) {
 
+  historical = true;
+
   std::vector<osm_nwr_id_t> current_ids;
   std::vector<osm_edition_t> historic_ids;
 
@@ -15,11 +15,17 @@ namespace api06 {
 relation_history_responder::relation_history_responder(mime::type mt, osm_nwr_id_t id, data_selection &w)
   : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_relations_with_history({id}) == 0) {
     throw http::not_found("");
   }
 }
 
+bool relation_history_responder::cacheable() const {
+  return !write_failed();
+}
+
 relation_history_handler::relation_history_handler(const request &, osm_nwr_id_t id) : id(id) {}
 
 std::string relation_history_handler::log_name() const { return "relation/history"; }
@@ -16,11 +16,17 @@ relation_version_responder::relation_version_responder(mime::type mt, osm_nwr_id
                                        osm_version_t v, data_selection &w)
     : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_historical_relations({std::make_pair(id, v)}) == 0) {
      throw http::not_found("");
   }
 }
 
+bool relation_version_responder::cacheable() const {
+  return !write_failed();
+}
+
 relation_version_handler::relation_version_handler(const request &, osm_nwr_id_t id, osm_version_t v) : id(id), v(v) {}
 
 std::string relation_version_handler::log_name() const { return "relation"; }
@@ -24,6 +24,8 @@ relations_responder::relations_responder(mime::type mt, const std::vector<id_ver
                                          data_selection &s)
     : osm_current_responder(mt, s) {
 
+  historical = true;
+
   std::vector<osm_nwr_id_t> current_ids;
   std::vector<osm_edition_t> historic_ids;
 
@@ -18,11 +18,17 @@ namespace api06 {
 way_history_responder::way_history_responder(mime::type mt, osm_nwr_id_t id, data_selection &w)
   : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_ways_with_history({id}) == 0) {
     throw http::not_found("");
   }
 }
 
+bool way_history_responder::cacheable() const {
+  return !write_failed();
+}
+
 way_history_handler::way_history_handler(const request &, osm_nwr_id_t id) : id(id) {}
 
 std::string way_history_handler::log_name() const { return "way/history"; }
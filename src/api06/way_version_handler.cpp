@@ -20,11 +20,17 @@ way_version_responder::way_version_responder(mime::type mt,
                                              data_selection &w)
     : osm_current_responder(mt, w) {
 
+  historical = true;
+
   if (sel.select_historical_ways({std::make_pair(id, v)}) == 0) {
      throw http::not_found("");
   }
 }
 
+bool way_version_responder::cacheable() const {
+  return !write_failed();
+}
+
 way_version_handler::way_version_handler(const request &, osm_nwr_id_t id, osm_version_t v) :
   id(id), v(v) {}
 
@@ -20,6 +20,8 @@ ways_responder::ways_responder(mime::type mt, const std::vector<id_version>& ids
                                data_selection &w)
     : osm_current_responder(mt, w) {
 
+  historical = true;
+
   std::vector<osm_nwr_id_t> current_ids;
   std::vector<osm_edition_t> historic_ids;
 
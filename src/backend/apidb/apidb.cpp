@@ -38,7 +38,19 @@ struct apidb_backend : public backend {
       ("update-password", po::value<std::string>(),
        "database password for API write operations, if different from --password")
       ("update-dbport", po::value<std::string>(),
-       "database port for API write operations, if different from --dbport");
+       "database port for API write operations, if different from --dbport")
+      ("changeset-cache-size", po::value<int>(),
+       "number of changeset user details cached across requests, 0 to disable")
+      ("changeset-cache-ttl", po::value<int>(),
+       "seconds until cached changeset user details are fetched again")
+      ("map-tile-cache-size", po::value<int>(),
+       "number of blocks of tiles whose /map closures are cached across requests, 0 to disable")
+      ("map-tile-cache-ttl", po::value<int>(),
+       "seconds until cached /map closures of blocks of tiles are selected again")
+      ("map-tile-cache-edit-margin", po::value<int>(),
+       "seconds by which changeset edits may predate a cached /map closure and still be missing from it")
+      ("oauth2-cache-ttl", po::value<int>(),
+       "seconds to cache OAuth 2.0 token and user status lookups, 0 to disable");
     // clang-format on
   }
   ~apidb_backend() override = default;
@@ -0,0 +1,48 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/backend/apidb/auth_cache.hpp"
+
+#include <mutex>
+
+namespace {
+
+// maximum number of valid and unknown tokens kept in the cache
+constexpr std::size_t AUTH_CACHE_CAPACITY = 10000;
+constexpr std::size_t AUTH_CACHE_UNKNOWN_CAPACITY = 1000;
+
+} // anonymous namespace
+
+data_selection::oauth2_user_details
+cached_oauth2_token::at(time_point now) const {
+  auto result = details;
+  result.expired = expires_at && *expires_at < now;
+  result.revoked = revoked_at && *revoked_at < now;
+  return result;
+}
+
+auth_cache::auth_cache(std::size_t capacity, std::size_t unknown_capacity,
+                       std::chrono::seconds ttl)
+    : tokens(capacity, ttl), unknown_tokens(unknown_capacity, ttl) {}
+
+std::shared_ptr<auth_cache> auth_cache::shared(std::chrono::seconds ttl) {
+  static std::mutex mutex;
+  static std::shared_ptr<auth_cache> cache;
+
+  if (ttl.count() <= 0)
+    return {};
+
+  std::scoped_lock lock(mutex);
+
+  if (!cache)
+    cache = std::make_shared<auth_cache>(AUTH_CACHE_CAPACITY,
+                                         AUTH_CACHE_UNKNOWN_CAPACITY, ttl);
+
+  return cache;
+}
@@ -0,0 +1,60 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/backend/apidb/changeset_cache.hpp"
+
+#include <mutex>
+
+changeset_cache::changeset_cache(std::size_t capacity, std::chrono::seconds ttl)
+    : m_cache(capacity, ttl) {}
+
+std::vector<osm_changeset_id_t>
+changeset_cache::lookup(const std::vector<osm_changeset_id_t> &ids,
+                        std::map<osm_changeset_id_t, changeset> &cc,
+                        clock::time_point now) {
+  std::vector<osm_changeset_id_t> missing;
+
+  for (auto id : ids) {
+    if (auto cs = m_cache.get(id, now))
+      cc.try_emplace(id, std::move(*cs));
+    else
+      missing.emplace_back(id);
+  }
+
+  return missing;
+}
+
+void changeset_cache::insert(osm_changeset_id_t id, const changeset &cs,
+                             clock::time_point now) {
+  m_cache.put(id, cs, now);
+}
+
+void changeset_cache::clear() {
+  m_cache.clear();
+}
+
+std::size_t changeset_cache::size() const {
+  return m_cache.size();
+}
+
+std::shared_ptr<changeset_cache>
+changeset_cache::shared(std::size_t capacity, std::chrono::seconds ttl) {
+  static std::mutex mutex;
+  static std::shared_ptr<changeset_cache> cache;
+
+  if (capacity == 0)
+    return {};
+
+  std::scoped_lock lock(mutex);
+
+  if (!cache)
+    cache = std::make_shared<changeset_cache>(capacity, ttl);
+
+  return cache;
+}
@@ -110,13 +110,15 @@ void ApiDB_Changeset_Updater::update_changeset(
         WHERE id = $8
     )"_M);
 
-    auto r = m.exec_prepared(
-        "changeset_update_w_bbox", cs_num_changes, cs_bbox.minlat,
+    m.exec_prepared_deferred(
+        "changeset_update_w_bbox", [](const pqxx::result &r) {
+          if (r.affected_rows() != 1)
+            throw http::server_error("Cannot update changeset");
+        },
+        cs_num_changes, cs_bbox.minlat,
         cs_bbox.minlon, cs_bbox.maxlat, cs_bbox.maxlon,
         global_settings::get_changeset_timeout_open_max(),
         global_settings::get_changeset_timeout_idle(), changeset);
-    if (r.affected_rows() != 1)
-      throw http::server_error("Cannot update changeset");
 
   } else {
 
@@ -135,12 +137,15 @@ void ApiDB_Changeset_Updater::update_changeset(
         WHERE id = $4
     )"_M);
 
-    auto r = m.exec_prepared("changeset_update", cs_num_changes,
-                             global_settings::get_changeset_timeout_open_max(),
-                             global_settings::get_changeset_timeout_idle(),
-                             changeset);
-    if (r.affected_rows() != 1)
-      throw http::server_error("Cannot update changeset");
+    m.exec_prepared_deferred("changeset_update",
+        [](const pqxx::result &r) {
+          if (r.affected_rows() != 1)
+            throw http::server_error("Cannot update changeset");
+        },
+        cs_num_changes,
+        global_settings::get_changeset_timeout_open_max(),
+        global_settings::get_changeset_timeout_idle(),
+        changeset);
   }
 
   changeset_update_enhanced_stats(new_changes);
@@ -167,14 +172,16 @@ void ApiDB_Changeset_Updater::changeset_update_enhanced_stats(
         WHERE id = $10
         )"_M);
 
-    auto r = m.exec_prepared("changeset_update_enhanced_stats",
+    m.exec_prepared_deferred("changeset_update_enhanced_stats",
+                             [](const pqxx::result &r) {
+                               if (r.affected_rows() != 1)
+                                 throw http::server_error(
+                                     "Cannot update changeset - changeset_update_enhanced_stats");
+                             },
                              new_changes.node.num_create, new_changes.node.num_modify, new_changes.node.num_delete,
                              new_changes.way.num_create, new_changes.way.num_modify, new_changes.way.num_delete,
                              new_changes.relation.num_create, new_changes.relation.num_modify, new_changes.relation.num_delete,
                              changeset);
-    if (r.affected_rows() != 1)
-      throw http::server_error(
-          "Cannot update changeset - changeset_update_enhanced_stats");
   }
 }
 void ApiDB_Changeset_Updater::changeset_update_users_cs_count() {
@@ -187,11 +194,12 @@ void ApiDB_Changeset_Updater::changeset_update_users_cs_count() {
              WHERE "id" = $1
    )"_M);
 
-  auto r = m.exec_prepared ("update_users", req_ctx.user->id);
-
-  if (r.affected_rows () != 1)
-    throw http::server_error (
-        "Cannot create changeset - update changesets_count");
+  m.exec_prepared_deferred ("update_users",
+      [](const pqxx::result &r) {
+        if (r.affected_rows() != 1)
+          throw http::server_error("Cannot create changeset - update changesets_count");
+      },
+      req_ctx.user->id);
 }
 
 osm_changeset_id_t ApiDB_Changeset_Updater::api_create_changeset(const std::map<std::string, std::string>& tags)
@@ -297,10 +305,12 @@ void ApiDB_Changeset_Updater::changeset_insert_subscriber()
 {
   m.prepare ("insert_changeset_subscribers", R"( INSERT INTO "changesets_subscribers" ("subscriber_id", "changeset_id") VALUES ($1, $2) )");
 
-  auto r = m.exec_prepared ("insert_changeset_subscribers", req_ctx.user->id,
-                                    changeset);
-  if (r.affected_rows () != 1)
-    throw http::server_error("Cannot create changeset - insert_changeset_subscribers");
+  m.exec_prepared_deferred ("insert_changeset_subscribers",
+      [](const pqxx::result &r) {
+        if (r.affected_rows() != 1)
+          throw http::server_error("Cannot create changeset - insert_changeset_subscribers");
+      },
+      req_ctx.user->id, changeset);
 }
 
 void ApiDB_Changeset_Updater::changeset_insert_tags(
@@ -337,17 +347,18 @@ void ApiDB_Changeset_Updater::changeset_insert_tags(
       ++total_tags;
   }
 
-  auto r = m.exec_prepared ("changeset_insert_tags", cs, ks, vs);
-
-  if (r.affected_rows () != total_tags)
-    throw http::server_error (
-	"Cannot create changeset - changeset_insert_tags");
+  m.exec_prepared_deferred ("changeset_insert_tags",
+      [expected = total_tags](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Cannot create changeset - changeset_insert_tags");
+      },
+      cs, ks, vs);
 }
 
 void ApiDB_Changeset_Updater::changeset_delete_tags()
 {
   m.prepare ("delete_changeset_tags",  R"( DELETE FROM "changeset_tags" WHERE "changeset_tags"."changeset_id" = $1 )");
-  auto r = m.exec_prepared ("delete_changeset_tags", changeset);
+  m.exec_prepared_deferred ("delete_changeset_tags", {}, changeset);
 }
 
 void ApiDB_Changeset_Updater::changeset_insert_cs()
@@ -752,10 +752,12 @@ std::vector<osm_nwr_id_t> ApiDB_Node_Updater::insert_new_current_node_tags(
   if (total_tags == 0)
     return {};
 
-  auto r = m.exec_prepared("insert_new_current_node_tags", ids, ks, vs);
-
-  if (r.affected_rows() != total_tags)
-    throw http::server_error("Could not create new current node tags");
+  m.exec_prepared_deferred("insert_new_current_node_tags",
+      [expected = total_tags](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not create new current node tags");
+      },
+      ids, ks, vs);
 
 #else
 
@@ -798,10 +800,12 @@ void ApiDB_Node_Updater::save_current_nodes_to_history(
               WHERE id = ANY($1)
        )"_M);
 
-  auto r = m.exec_prepared("current_nodes_to_history", ids);
-
-  if (r.affected_rows() != ids.size())
-    throw http::server_error("Could not save current nodes to history");
+  m.exec_prepared_deferred("current_nodes_to_history",
+      [expected = ids.size()](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not save current nodes to history");
+      },
+      ids);
 }
 
 void ApiDB_Node_Updater::save_current_node_tags_to_history(
@@ -821,7 +825,7 @@ void ApiDB_Node_Updater::save_current_node_tags_to_history(
                 WHERE id = ANY($1)
            )"_M);
 
-  auto r = m.exec_prepared("current_node_tags_to_history", ids);
+  m.exec_prepared_deferred("current_node_tags_to_history", {}, ids);
 }
 
 std::vector<ApiDB_Node_Updater::node_t>
@@ -975,7 +979,7 @@ void ApiDB_Node_Updater::delete_current_node_tags(
   m.prepare("delete_current_node_tags",
             "DELETE FROM current_node_tags WHERE node_id = ANY($1)");
 
-  auto r = m.exec_prepared("delete_current_node_tags", ids);
+  m.exec_prepared_deferred("delete_current_node_tags", {}, ids);
 }
 
 changeset_upload_stats::element_stats ApiDB_Node_Updater::get_stats() const {
@@ -1365,10 +1365,12 @@ std::vector<osm_nwr_id_t>  ApiDB_Relation_Updater::insert_new_current_relation_t
   if (total_tags == 0)
     return {};
 
-  auto r = m.exec_prepared("insert_new_current_relation_tags", ids, ks, vs);
-
-  if (r.affected_rows() != total_tags)
-    throw http::server_error("Could not create new current relation tags");
+  m.exec_prepared_deferred("insert_new_current_relation_tags",
+      [expected = total_tags](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not create new current relation tags");
+      },
+      ids, ks, vs);
 
 
 #else
@@ -1435,8 +1437,8 @@ void ApiDB_Relation_Updater::insert_new_current_relation_members(
       sequenceids.emplace_back(member.sequence_id);
     }
 
-  auto r = m.exec_prepared("insert_new_current_relation_members",
-				   ids, membertypes, memberids, memberroles, sequenceids);
+  m.exec_prepared_deferred("insert_new_current_relation_members", {},
+      ids, membertypes, memberids, memberroles, sequenceids);
 #else
 
   auto stream = m.to_stream("current_relation_members", "relation_id, member_type, member_id, member_role, sequence_id");
@@ -1466,10 +1468,12 @@ void ApiDB_Relation_Updater::save_current_relations_to_history(
                 WHERE id = ANY($1)
             )"_M);
 
-  auto r = m.exec_prepared("current_relations_to_history", ids);
-
-  if (r.affected_rows() != ids.size())
-    throw http::server_error("Could not save current relations to history");
+  m.exec_prepared_deferred("current_relations_to_history",
+      [expected = ids.size()](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not save current relations to history");
+      },
+      ids);
 }
 
 void ApiDB_Relation_Updater::save_current_relation_tags_to_history(
@@ -1486,7 +1490,7 @@ void ApiDB_Relation_Updater::save_current_relation_tags_to_history(
                  WHERE id = ANY($1)
              )"_M);
 
-  auto r = m.exec_prepared("current_relation_tags_to_history", ids);
+  m.exec_prepared_deferred("current_relation_tags_to_history", {}, ids);
 }
 
 void ApiDB_Relation_Updater::save_current_relation_members_to_history(
@@ -1507,8 +1511,7 @@ void ApiDB_Relation_Updater::save_current_relation_members_to_history(
                  WHERE id = ANY($1)
                           )"_M);
 
-  auto r =
-      m.exec_prepared("current_relation_members_to_history", ids);
+  m.exec_prepared_deferred("current_relation_members_to_history", {}, ids);
 }
 
 void
@@ -1772,7 +1775,7 @@ void ApiDB_Relation_Updater::delete_current_relation_members(
   m.prepare("delete_current_relation_members",
             "DELETE FROM current_relation_members WHERE relation_id = ANY($1)");
 
-  auto r = m.exec_prepared("delete_current_relation_members", ids);
+  m.exec_prepared_deferred("delete_current_relation_members", {}, ids);
 }
 
 void ApiDB_Relation_Updater::delete_current_relation_tags(
@@ -1783,7 +1786,7 @@ void ApiDB_Relation_Updater::delete_current_relation_tags(
   m.prepare("delete_current_relation_tags",
             "DELETE FROM current_relation_tags WHERE relation_id = ANY($1)");
 
-  auto r = m.exec_prepared("delete_current_relation_tags", ids);
+  m.exec_prepared_deferred("delete_current_relation_tags", {}, ids);
 }
 
 changeset_upload_stats::element_stats ApiDB_Relation_Updater::get_stats() const {
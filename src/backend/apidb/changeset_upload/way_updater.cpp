@@ -768,10 +768,12 @@ std::vector<osm_nwr_id_t> ApiDB_Way_Updater::insert_new_current_way_tags(
   if (total_tags == 0)
     return {};
 
-  auto r = m.exec_prepared("insert_new_current_way_tags", ids, ks, vs);
-
-  if (r.affected_rows() != total_tags)
-    throw http::server_error("Could not create new current way tags");
+  m.exec_prepared_deferred("insert_new_current_way_tags",
+      [expected = total_tags](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not create new current way tags");
+      },
+      ids, ks, vs);
 
 #else
 
@@ -830,7 +832,7 @@ void ApiDB_Way_Updater::insert_new_current_way_nodes(
       sequenceids.emplace_back(wn.sequence_id);
     }
 
-  auto r = m.exec_prepared("insert_new_current_way_nodes", ids, nodeids, sequenceids);
+  m.exec_prepared_deferred("insert_new_current_way_nodes", {}, ids, nodeids, sequenceids);
 #else
 
   auto stream = m.to_stream("current_way_nodes", "way_id, node_id, sequence_id");
@@ -861,10 +863,12 @@ void ApiDB_Way_Updater::save_current_ways_to_history(
         WHERE id = ANY($1)
     )"_M);
 
-  auto r = m.exec_prepared("current_ways_to_history", ids);
-
-  if (r.affected_rows() != ids.size())
-    throw http::server_error("Could not save current ways to history");
+  m.exec_prepared_deferred("current_ways_to_history",
+      [expected = ids.size()](const pqxx::result &r) {
+        if (r.affected_rows() != expected)
+          throw http::server_error("Could not save current ways to history");
+      },
+      ids);
 }
 
 void ApiDB_Way_Updater::save_current_way_nodes_to_history(
@@ -883,7 +887,7 @@ void ApiDB_Way_Updater::save_current_way_nodes_to_history(
        ON wn.way_id = w.id
        WHERE id = ANY($1) )"_M);
 
-  auto r = m.exec_prepared("current_way_nodes_to_history", ids);
+  m.exec_prepared_deferred("current_way_nodes_to_history", {}, ids);
 }
 
 void ApiDB_Way_Updater::save_current_way_tags_to_history(
@@ -903,7 +907,7 @@ void ApiDB_Way_Updater::save_current_way_tags_to_history(
              WHERE id = ANY($1)
      )"_M);
 
-  auto r = m.exec_prepared("current_way_tags_to_history", ids);
+  m.exec_prepared_deferred("current_way_tags_to_history", {}, ids);
 }
 
 std::vector<ApiDB_Way_Updater::way_t>
@@ -1025,7 +1029,7 @@ void ApiDB_Way_Updater::delete_current_way_tags(
   m.prepare("delete_current_way_tags",
             "DELETE FROM current_way_tags WHERE way_id = ANY($1)");
 
-  auto r = m.exec_prepared("delete_current_way_tags", ids);
+  m.exec_prepared_deferred("delete_current_way_tags", {}, ids);
 }
 
 void ApiDB_Way_Updater::delete_current_way_nodes(
@@ -1037,7 +1041,7 @@ void ApiDB_Way_Updater::delete_current_way_nodes(
   m.prepare("delete_current_way_nodes",
             "DELETE FROM current_way_nodes WHERE way_id = ANY($1)");
 
-  auto r = m.exec_prepared("delete_current_way_nodes", ids);
+  m.exec_prepared_deferred("delete_current_way_nodes", {}, ids);
 }
 
 changeset_upload_stats::element_stats ApiDB_Way_Updater::get_stats() const {
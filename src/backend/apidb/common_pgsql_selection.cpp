@@ -129,7 +129,7 @@ struct comments_columns
 
   elem.id        = row[col.id_col].as<osm_nwr_id_t>();
   elem.version   = row[col.version_col].as<int>();
-  elem.timestamp = row[col.timestamp_col].as<std::string>();
+  elem.timestamp = format_pg_timestamp(row[col.timestamp_col]);
   elem.changeset = row[col.changeset_id_col].as<osm_changeset_id_t>();
   elem.visible   = row[col.visible_col].as<bool>();
 
@@ -161,8 +161,8 @@ std::optional<T> extract_optional(const pqxx_field &f) {
   changeset_info elem;
 
   elem.id = row[col.id_col].as<osm_changeset_id_t>();
-  elem.created_at = row[col.created_at_col].as<std::string>();
-  elem.closed_at = row[col.closed_at_col].as<std::string>();
+  elem.created_at = format_pg_timestamp(row[col.created_at_col]);
+  elem.closed_at = format_pg_timestamp(row[col.closed_at_col]);
 
   const auto & cs = changeset_cache[elem.id];
 
@@ -197,8 +197,12 @@ std::optional<T> extract_optional(const pqxx_field &f) {
 
   tags_t tags;
 
-  auto keys   = psql_array_to_vector(row[col.tag_k_col]);
-  auto values = psql_array_to_vector(row[col.tag_v_col]);
+  // keys and values are views into the result row (or the unescape
+  // buffers), so only the final tag strings get allocated.
+  std::string keys_buf;
+  std::string values_buf;
+  const auto keys   = psql_array_to_views(row[col.tag_k_col], keys_buf);
+  const auto values = psql_array_to_views(row[col.tag_v_col], values_buf);
 
   if (keys.size() != values.size()) {
     throw std::runtime_error("Mismatch in tags key and value size");
@@ -207,7 +211,7 @@ std::optional<T> extract_optional(const pqxx_field &f) {
   tags.reserve(keys.size());
 
   for (std::size_t i = 0; i < keys.size(); i++)
-    tags.emplace_back(std::move(keys[i]), std::move(values[i]));
+    tags.emplace_back(keys[i], values[i]);
 
   return tags;
 }
@@ -217,10 +221,10 @@ std::optional<T> extract_optional(const pqxx_field &f) {
   return psql_array_ids_to_vector<osm_nwr_id_t>(row[col.node_ids_col]);
 }
 
-element_type type_from_name(const char *name) {
+element_type type_from_name(std::string_view name) {
   element_type type{};
 
-  switch (name[0]) {
+  switch (name.empty() ? '\0' : name[0]) {
   case 'N':
   case 'n':
     type = element_type::node;
@@ -250,8 +254,10 @@ element_type type_from_name(const char *name) {
   members_t members;
 
   auto ids   = psql_array_ids_to_vector<osm_nwr_id_t>(row[col.member_ids_col]);
-  auto types = psql_array_to_vector(row[col.member_types_col], ids.size());
-  auto roles = psql_array_to_vector(row[col.member_roles_col], ids.size());
+  std::string types_buf;
+  std::string roles_buf;
+  const auto types = psql_array_to_views(row[col.member_types_col], types_buf, ids.size());
+  const auto roles = psql_array_to_views(row[col.member_roles_col], roles_buf, ids.size());
 
   if (types.size() != ids.size() ||
       ids.size() != roles.size()) {
@@ -261,8 +267,8 @@ element_type type_from_name(const char *name) {
   members.reserve(ids.size());
 
   for (std::size_t i=0; i<ids.size(); i++) {
-    element_type member_type = type_from_name(types[i].c_str());
-    members.emplace_back(member_type, ids[i], std::move(roles[i]));
+    element_type member_type = type_from_name(types[i]);
+    members.emplace_back(member_type, ids[i], std::string(roles[i]));
   }
 
   return members;
@@ -291,7 +297,7 @@ element_type type_from_name(const char *name) {
     comments.emplace_back(id[i],
                           author_id[i],
                           std::move(body[i]),
-                          std::move(created_at[i]),
+                          format_pg_timestamp(created_at[i]),
                           std::move(display_name[i]));
   }
 
@@ -303,16 +309,17 @@ struct node {
   using extra_columns = node_extra_columns;
 
   struct extra_info {
-    const double lon;
-    const double lat;
+    // kept in the database's fixed-point format, so that the coordinates
+    // are printed exactly as stored
+    const fixed_lonlat lonlat;
     extra_info(const pqxx_tuple &row, const extra_columns& col) :
-      lon(double(row[col.longitude_col].as<int64_t>()) / global_settings::get_scale()),
-      lat(double(row[col.latitude_col].as<int64_t>()) / global_settings::get_scale()) {}
+      lonlat{ .lon = row[col.longitude_col].as<int64_t>(),
+              .lat = row[col.latitude_col].as<int64_t>() } {}
   };
   static inline void write(
     output_formatter &formatter, const element_info &elem,
     const extra_info &extra, const tags_t &tags) {
-    formatter.write_node(elem, extra.lon, extra.lat, tags);
+    formatter.write_node(elem, extra.lonlat, tags);
   }
 };
 
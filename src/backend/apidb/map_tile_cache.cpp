@@ -0,0 +1,68 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/backend/apidb/map_tile_cache.hpp"
+
+#include <mutex>
+
+namespace {
+
+// blocks are aligned, so their first and last tiles identify them
+uint64_t block_key(const tile_block &block) {
+  return (uint64_t(block.tiles.first) << 32) | block.tiles.second;
+}
+
+} // anonymous namespace
+
+map_tile_cache::map_tile_cache(std::size_t capacity, std::chrono::seconds ttl,
+                               std::chrono::seconds edit_margin)
+    : m_cache(capacity, ttl), m_edit_margin(edit_margin) {}
+
+map_tile_cache::closure_ptr map_tile_cache::get(const tile_block &block,
+                                                clock::time_point now) {
+  return m_cache.get(block_key(block), now).value_or(nullptr);
+}
+
+void map_tile_cache::insert(const tile_block &block, closure_ptr closure,
+                            clock::time_point now) {
+  m_cache.put(block_key(block), std::move(closure), now);
+}
+
+void map_tile_cache::invalidate(const tile_block &block) {
+  m_cache.invalidate(block_key(block));
+}
+
+void map_tile_cache::clear() {
+  m_cache.clear();
+}
+
+std::size_t map_tile_cache::size() const {
+  return m_cache.size();
+}
+
+std::chrono::seconds map_tile_cache::edit_margin() const {
+  return m_edit_margin;
+}
+
+std::shared_ptr<map_tile_cache>
+map_tile_cache::shared(std::size_t capacity, std::chrono::seconds ttl,
+                       std::chrono::seconds edit_margin) {
+  static std::mutex mutex;
+  static std::shared_ptr<map_tile_cache> cache;
+
+  if (capacity == 0)
+    return {};
+
+  std::scoped_lock lock(mutex);
+
+  if (!cache)
+    cache = std::make_shared<map_tile_cache>(capacity, ttl, edit_margin);
+
+  return cache;
+}
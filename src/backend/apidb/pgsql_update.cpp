@@ -147,6 +147,13 @@ pgsql_update::factory::factory(const po::variables_map &opts)
   check_postgres_version(m_connection);
   m_connection.set_client_encoding("utf8");
 
+  // readonly selections on this connection format timestamps client side
+#if PQXX_VERSION_MAJOR < 7
+  m_connection.set_variable("DateStyle", "ISO");
+#else
+  m_connection.set_session_var("DateStyle", "ISO");
+#endif
+
   // set the connection to readonly transaction, if disable-api-write flag is set
   if (opts.contains("disable-api-write") != 0) {
     m_api_write_disabled = true;
@@ -9,6 +9,7 @@
 
 #include "cgimap/backend/apidb/quad_tile.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 
 
@@ -39,3 +40,138 @@ std::vector<tile_id_t> tiles_for_area(double minlat, double minlon, double maxla
 
   return tiles;
 }
+
+namespace {
+
+// number of bits per coordinate in a tile id
+constexpr unsigned int TILE_BITS = 16;
+
+struct tile_area {
+  unsigned int minx, maxx, miny, maxy;
+};
+
+// walks the quadrant of side 2^level starting at (x0, y0), whose tiles
+// start at first_tile, in Z-order. quadrants completely inside the area
+// are emitted as a single range, merging with the previous range if the
+// two are adjacent.
+void add_tile_ranges(const tile_area &area, unsigned int x0, unsigned int y0,
+                     unsigned int level, uint64_t first_tile,
+                     std::vector<tile_range_t> &ranges) {
+  const uint64_t x1 = x0 + (uint64_t(1) << level) - 1;
+  const uint64_t y1 = y0 + (uint64_t(1) << level) - 1;
+
+  if (x1 < area.minx || x0 > area.maxx || y1 < area.miny || y0 > area.maxy)
+    return;
+
+  if (x0 >= area.minx && x1 <= area.maxx && y0 >= area.miny && y1 <= area.maxy) {
+    const auto last_tile = tile_id_t(first_tile + (uint64_t(1) << (2 * level)) - 1);
+
+    if (!ranges.empty() && uint64_t(ranges.back().second) + 1 == first_tile)
+      ranges.back().second = last_tile;
+    else
+      ranges.emplace_back(tile_id_t(first_tile), last_tile);
+    return;
+  }
+
+  // x is the more significant bit of each pair, see xy2tile
+  const unsigned int half = 1U << (level - 1);
+  const uint64_t quarter = uint64_t(1) << (2 * (level - 1));
+
+  add_tile_ranges(area, x0,        y0,        level - 1, first_tile,               ranges);
+  add_tile_ranges(area, x0,        y0 + half, level - 1, first_tile + quarter,     ranges);
+  add_tile_ranges(area, x0 + half, y0,        level - 1, first_tile + 2 * quarter, ranges);
+  add_tile_ranges(area, x0 + half, y0 + half, level - 1, first_tile + 3 * quarter, ranges);
+}
+
+// walks the quadrant like add_tile_ranges, but emits the largest
+// quadrants of at most max_level which are completely inside the area, and
+// gives up on the parts of the area which aren't covered by quadrants of
+// min_level.
+void add_tile_blocks(const tile_area &area, unsigned int x0, unsigned int y0,
+                     unsigned int level, uint64_t first_tile,
+                     unsigned int min_level, unsigned int max_level,
+                     std::vector<tile_block> &blocks) {
+  const uint64_t x1 = x0 + (uint64_t(1) << level) - 1;
+  const uint64_t y1 = y0 + (uint64_t(1) << level) - 1;
+
+  if (x1 < area.minx || x0 > area.maxx || y1 < area.miny || y0 > area.maxy)
+    return;
+
+  const bool inside = x0 >= area.minx && x1 <= area.maxx &&
+                      y0 >= area.miny && y1 <= area.maxy;
+
+  if (inside && level <= max_level) {
+    blocks.push_back(tile_block{
+        {tile_id_t(first_tile), tile_id_t(first_tile + (uint64_t(1) << (2 * level)) - 1)},
+        x0, unsigned(x1), y0, unsigned(y1)});
+    return;
+  }
+
+  if (level <= min_level)
+    return;
+
+  const unsigned int half = 1U << (level - 1);
+  const uint64_t quarter = uint64_t(1) << (2 * (level - 1));
+
+  add_tile_blocks(area, x0,        y0,        level - 1, first_tile,               min_level, max_level, blocks);
+  add_tile_blocks(area, x0,        y0 + half, level - 1, first_tile + quarter,     min_level, max_level, blocks);
+  add_tile_blocks(area, x0 + half, y0,        level - 1, first_tile + 2 * quarter, min_level, max_level, blocks);
+  add_tile_blocks(area, x0 + half, y0 + half, level - 1, first_tile + 3 * quarter, min_level, max_level, blocks);
+}
+
+} // anonymous namespace
+
+std::vector<tile_range_t> tile_ranges_for_area(double minlat, double minlon,
+                                               double maxlat, double maxlon) {
+  const tile_area area{lon2x(minlon), lon2x(maxlon), lat2y(minlat), lat2y(maxlat)};
+
+  std::vector<tile_range_t> ranges;
+
+  if (area.minx <= area.maxx && area.miny <= area.maxy)
+    add_tile_ranges(area, 0, 0, TILE_BITS, 0, ranges);
+
+  return ranges;
+}
+
+std::vector<tile_block> tile_blocks_for_area(double minlat, double minlon,
+                                             double maxlat, double maxlon,
+                                             unsigned int min_level,
+                                             unsigned int max_level,
+                                             unsigned int margin) {
+  std::vector<tile_block> blocks;
+
+  const unsigned int minx = lon2x(minlon);
+  const unsigned int maxx = lon2x(maxlon);
+  const unsigned int miny = lat2y(minlat);
+  const unsigned int maxy = lat2y(maxlat);
+
+  if (uint64_t(minx) + 2 * margin > maxx || uint64_t(miny) + 2 * margin > maxy)
+    return blocks;
+
+  const tile_area inner{minx + margin, maxx - margin, miny + margin, maxy - margin};
+
+  add_tile_blocks(inner, 0, 0, TILE_BITS, 0, min_level, max_level, blocks);
+
+  return blocks;
+}
+
+std::vector<tile_range_t> subtract_tile_blocks(const std::vector<tile_range_t> &ranges,
+                                               const std::vector<tile_block> &blocks) {
+  std::vector<tile_range_t> result;
+  std::size_t i = 0;
+
+  for (const auto &[first, last] : ranges) {
+    uint64_t start = first;
+
+    for (; i < blocks.size() && blocks[i].tiles.first <= last; ++i) {
+      if (blocks[i].tiles.first > start)
+        result.emplace_back(tile_id_t(start), tile_id_t(blocks[i].tiles.first - 1));
+      start = uint64_t(blocks[i].tiles.second) + 1;
+    }
+
+    if (start <= last)
+      result.emplace_back(tile_id_t(start), last);
+  }
+
+  return result;
+}
@@ -16,6 +16,9 @@
 #include "cgimap/options.hpp"
 #include "cgimap/backend/apidb/quad_tile.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 #include <functional>
 #include <set>
 #include <sstream>
@@ -26,6 +29,24 @@ namespace po = boost::program_options;
 
 namespace {
 
+// seconds until cached changeset user details are fetched again
+constexpr int DEFAULT_CHANGESET_CACHE_TTL = 60;
+
+// seconds until cached /map closures of tiles are selected again
+constexpr int DEFAULT_MAP_TILE_CACHE_TTL = 600;
+
+// /map closures are cached for aligned blocks of 4x4 up to 32x32 tiles,
+// which are at least two tiles inside the bbox, so that all of their
+// nodes are in the bbox.
+constexpr unsigned int MAP_TILE_MIN_LEVEL = 2;
+constexpr unsigned int MAP_TILE_MAX_LEVEL = 5;
+constexpr unsigned int MAP_TILE_MARGIN = 2;
+
+// seconds by which edits in transactions which started before a /map
+// closure was selected may not be part of it, as the transactions were
+// still running or not yet replicated.
+constexpr int DEFAULT_MAP_TILE_CACHE_EDIT_MARGIN = 600;
+
 std::string connect_db_str(const po::variables_map &options) {
 
   std::ostringstream ostr;
@@ -85,26 +106,131 @@ osm_edition_t id_of<osm_edition_t>(const pqxx_tuple &row, pqxx::row_size_type co
 }
 
 template <typename T>
-inline int insert_results(const pqxx::result &res, std::set<T> &elems) {
+inline int insert_results(const pqxx::result &res, id_set<T> &elems) {
 
   auto const id_col = res.column_number("id");
 
-  const auto old_size = elems.size();
+  std::vector<T> ids;
+  ids.reserve(res.size());
 
-  auto it = elems.begin();
   for (const auto & row : res) {
-    const T id = id_of<T>(row, id_col);
-    it = elems.emplace_hint(it, id);
+    ids.emplace_back(id_of<T>(row, id_col));
+  }
+
+  return elems.insert_batch(std::move(ids)); // number of inserted elements
+}
+
+// versions of the current elements in res, to be merged into the
+// corresponding historic selection.
+std::vector<osm_edition_t> current_editions(const pqxx::result &res) {
+  std::vector<osm_edition_t> eds;
+  eds.reserve(res.size());
+
+  for (const auto & row : res) {
+    eds.emplace_back(row[0].as<osm_nwr_id_t>(), row[1].as<osm_version_t>());
+  }
+  return eds;
+}
+
+// maximum number of elements fetched by a single extract query. results
+// are written out and released chunk by chunk, so memory use for large
+// selections stays bounded and output starts before all rows are fetched.
+constexpr std::size_t EXTRACT_CHUNK_SIZE = 10000;
+
+// call fn for consecutive chunks of the (ordered) set of ids, so that
+// ordered queries on each chunk return rows in overall order.
+template <typename T, typename F>
+void for_each_chunk(const id_set<T> &elems, F &&fn) {
+  if (elems.size() <= EXTRACT_CHUNK_SIZE) {
+    fn(elems.values());
+    return;
+  }
+
+  for (auto it = elems.begin(); it != elems.end();) {
+    const auto chunk_end = it + std::min<std::ptrdiff_t>(elems.end() - it, EXTRACT_CHUNK_SIZE);
+    fn(std::vector<T>(it, chunk_end));
+    it = chunk_end;
+  }
+}
+
+std::pair<std::vector<osm_nwr_id_t>, std::vector<osm_nwr_id_t>>
+split_editions(const std::vector<osm_edition_t> &eds) {
+  std::vector<osm_nwr_id_t> ids;
+  std::vector<osm_nwr_id_t> versions;
+  ids.reserve(eds.size());
+  versions.reserve(eds.size());
+
+  for (const auto &[id, version] : eds) {
+    ids.emplace_back(id);
+    versions.emplace_back(version);
   }
 
-  return elems.size() - old_size; // number of inserted elements
+  return {std::move(ids), std::move(versions)};
+}
+
+// splits tile ranges into arrays of first and last tiles, which are
+// passed to statements as a set of ranges via unnest.
+std::pair<std::vector<tile_id_t>, std::vector<tile_id_t>>
+split_tile_ranges(const std::vector<tile_range_t> &ranges) {
+  std::vector<tile_id_t> first;
+  std::vector<tile_id_t> last;
+  first.reserve(ranges.size());
+  last.reserve(ranges.size());
+
+  for (const auto &[f, l] : ranges) {
+    first.emplace_back(f);
+    last.emplace_back(l);
+  }
+
+  return {std::move(first), std::move(last)};
+}
+
+// hack around problem with postgres' statistics, which was
+// making it do seq scans all the time on smaug...
+const planner_settings nested_loop_joins{
+  {"enable_mergejoin", "off"},
+  {"enable_hashjoin", "off"}
+};
+
+// the area of the block in fixed point coordinates, with a tile to spare
+// on each side.
+void block_area(const tile_block &block, map_tile_closure &closure) {
+  const auto scale = double(global_settings::get_scale());
+
+  closure.minlat = int64_t(std::floor(y2lat(block.miny - 1.0) * scale));
+  closure.maxlat = int64_t(std::ceil(y2lat(block.maxy + 1.0) * scale));
+  closure.minlon = int64_t(std::floor(x2lon(block.minx - 1.0) * scale));
+  closure.maxlon = int64_t(std::ceil(x2lon(block.maxx + 1.0) * scale));
+}
+
+// a time given in seconds after the database's now(), as returned by
+// extract(epoch from ... - now()), relative to the local time now.
+std::optional<std::chrono::steady_clock::time_point>
+time_from_now(const pqxx::field &field, std::chrono::steady_clock::time_point now) {
+  if (field.is_null())
+    return std::nullopt;
+
+  return now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(field.as<double>()));
+}
+
+std::optional<osm_user_role_t> role_from_name(std::string_view name) {
+  if (name == "moderator")
+    return osm_user_role_t::moderator;
+  if (name == "administrator")
+    return osm_user_role_t::administrator;
+  if (name == "importer")
+    return osm_user_role_t::importer;
+  return std::nullopt;
 }
 
 } // anonymous namespace
 
 readonly_pgsql_selection::readonly_pgsql_selection(
-    Transaction_Owner_Base& to)
-    : m(to) {}
+    Transaction_Owner_Base& to, std::shared_ptr<changeset_cache> cache,
+    std::shared_ptr<auth_cache> auth, std::shared_ptr<map_tile_cache> map_tiles)
+    : m(to), m_changeset_cache(std::move(cache)), m_auth_cache(std::move(auth)),
+      m_map_tile_cache(std::move(map_tiles)) {}
 
 void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
 
@@ -122,9 +248,7 @@ void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
 
     auto res = m.exec_prepared("lookup_node_versions", sel_nodes);
 
-    for (const auto & row : res) {
-      sel_historic_nodes.insert({row[0].as<osm_nwr_id_t>(), row[1].as<osm_version_t>()});
-    }
+    sel_historic_nodes.insert_batch(current_editions(res));
     sel_nodes.clear();
   }
 
@@ -136,7 +260,7 @@ void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
 
     m.prepare("extract_nodes",
       R"(SELECT n.id, n.latitude, n.longitude, n.visible,
-          to_char(n.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          n.timestamp,
           n.changeset_id, n.version,
           array_agg(t.k ORDER BY k) as tag_k,
           array_agg(t.v ORDER BY k) as tag_v
@@ -145,9 +269,11 @@ void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
         WHERE n.id = ANY($1)
         GROUP BY n.id ORDER BY n.id)"_M);
 
-    auto result = m.exec_prepared("extract_nodes", sel_nodes);
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_nodes(result, formatter, cc);
+    for_each_chunk(sel_nodes, [&](const std::vector<osm_nwr_id_t> &ids) {
+      auto result = m.exec_prepared("extract_nodes", ids);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_nodes(result, formatter, cc);
+    });
   }
   else if (!sel_historic_nodes.empty()) {
 
@@ -156,7 +282,7 @@ void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
         SELECT * FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[]))
       )
       SELECT n.node_id AS id, n.latitude, n.longitude, n.visible,
-          to_char(n.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          n.timestamp,
           n.changeset_id, n.version,
           array_agg(t.k ORDER BY k) as tag_k,
           array_agg(t.v ORDER BY k) as tag_v
@@ -165,17 +291,12 @@ void readonly_pgsql_selection::write_nodes(output_formatter &formatter) {
           LEFT JOIN node_tags t ON n.node_id = t.node_id AND n.version = t.version
         GROUP BY n.node_id, n.version ORDER BY n.node_id, n.version)"_M);
 
-    std::vector<osm_nwr_id_t> ids;
-    std::vector<osm_nwr_id_t> versions;
-
-    for (const auto &[id, version] : sel_historic_nodes) {
-      ids.emplace_back(id);
-      versions.emplace_back(version);
-    }
-
-    auto result = m.exec_prepared("extract_historic_nodes", ids, versions);
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_nodes(result, formatter, cc);
+    for_each_chunk(sel_historic_nodes, [&](const std::vector<osm_edition_t> &eds) {
+      const auto [ids, versions] = split_editions(eds);
+      auto result = m.exec_prepared("extract_historic_nodes", ids, versions);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_nodes(result, formatter, cc);
+    });
   }
 }
 
@@ -195,9 +316,7 @@ void readonly_pgsql_selection::write_ways(output_formatter &formatter) {
 
     auto res = m.exec_prepared("lookup_way_versions", sel_ways);
 
-    for (const auto & row : res) {
-      sel_historic_ways.insert({row[0].as<osm_nwr_id_t>(), row[1].as<osm_version_t>()});
-    }
+    sel_historic_ways.insert_batch(current_editions(res));
     sel_ways.clear();
   }
 
@@ -211,7 +330,7 @@ void readonly_pgsql_selection::write_ways(output_formatter &formatter) {
 
     m.prepare("extract_ways",
       R"(SELECT w.id, w.visible,
-          to_char(w.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          w.timestamp,
           w.changeset_id, w.version, t.keys as tag_k, t.values as tag_v,
           wn.node_ids as node_ids
         FROM current_ways w
@@ -228,9 +347,11 @@ void readonly_pgsql_selection::write_ways(output_formatter &formatter) {
         WHERE w.id = ANY($1)
         ORDER BY w.id)"_M);
 
-    auto result = m.exec_prepared("extract_ways", sel_ways);
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_ways(result, formatter, cc);
+    for_each_chunk(sel_ways, [&](const std::vector<osm_nwr_id_t> &ids) {
+      auto result = m.exec_prepared("extract_ways", ids);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_ways(result, formatter, cc);
+    });
   }
   else if (!sel_historic_ways.empty()) {
 
@@ -239,7 +360,7 @@ void readonly_pgsql_selection::write_ways(output_formatter &formatter) {
         SELECT * FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[]))
       )
       SELECT w.way_id AS id, w.visible,
-          to_char(w.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          w.timestamp,
           w.changeset_id, w.version, t.keys as tag_k, t.values as tag_v,
           wn.node_ids as node_ids
         FROM ways w
@@ -257,19 +378,12 @@ void readonly_pgsql_selection::write_ways(output_formatter &formatter) {
                 ORDER BY sequence_id) x) wn ON true
         ORDER BY w.way_id, w.version)"_M);
 
-    std::vector<osm_nwr_id_t> ids;
-    std::vector<osm_nwr_id_t> versions;
-    ids.reserve(sel_historic_ways.size());
-    versions.reserve(sel_historic_ways.size());
-
-    for (const auto &[id, version] : sel_historic_ways) {
-      ids.emplace_back(id);
-      versions.emplace_back(version);
-    }
-
-    auto result = m.exec_prepared("extract_historic_ways", ids, versions);
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_ways(result, formatter, cc);
+    for_each_chunk(sel_historic_ways, [&](const std::vector<osm_edition_t> &eds) {
+      const auto [ids, versions] = split_editions(eds);
+      auto result = m.exec_prepared("extract_historic_ways", ids, versions);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_ways(result, formatter, cc);
+    });
   }
 }
 
@@ -289,9 +403,7 @@ void readonly_pgsql_selection::write_relations(output_formatter &formatter) {
 
     auto res = m.exec_prepared("lookup_relation_versions", sel_relations);
 
-    for (const auto & row : res) {
-      sel_historic_relations.insert({row[0].as<osm_nwr_id_t>(), row[1].as<osm_version_t>()});
-    }
+    sel_historic_relations.insert_batch(current_editions(res));
     sel_relations.clear();
   }
 
@@ -301,7 +413,7 @@ void readonly_pgsql_selection::write_relations(output_formatter &formatter) {
 
     m.prepare("extract_relations",
       R"(SELECT r.id, r.visible,
-          to_char(r.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          r.timestamp,
           r.changeset_id, r.version, t.keys as tag_k, t.values as tag_v,
           rm.types as member_types, rm.ids as member_ids, rm.roles as member_roles
         FROM current_relations r
@@ -319,10 +431,11 @@ void readonly_pgsql_selection::write_relations(output_formatter &formatter) {
         WHERE r.id = ANY($1)
         ORDER BY r.id)"_M);
 
-    auto result = m.exec_prepared("extract_relations", sel_relations);
-
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_relations(result, formatter, cc);
+    for_each_chunk(sel_relations, [&](const std::vector<osm_nwr_id_t> &ids) {
+      auto result = m.exec_prepared("extract_relations", ids);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_relations(result, formatter, cc);
+    });
   }
   else if (!sel_historic_relations.empty()) {
 
@@ -331,7 +444,7 @@ void readonly_pgsql_selection::write_relations(output_formatter &formatter) {
         SELECT * FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[]))
       )
       SELECT r.relation_id AS id, r.visible,
-          to_char(r.timestamp,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS timestamp,
+          r.timestamp,
           r.changeset_id, r.version, t.keys as tag_k, t.values as tag_v,
           rm.types as member_types, rm.ids as member_ids, rm.roles as member_roles
         FROM relations r
@@ -349,19 +462,12 @@ void readonly_pgsql_selection::write_relations(output_formatter &formatter) {
                 ORDER BY sequence_id) x) rm ON true
         ORDER BY r.relation_id, r.version)"_M);
 
-    std::vector<osm_nwr_id_t> ids;
-    std::vector<osm_nwr_id_t> versions;
-    ids.reserve(sel_historic_relations.size());
-    versions.reserve(sel_historic_relations.size());
-
-    for (const auto &[id, version] : sel_historic_relations) {
-      ids.emplace_back(id);
-      versions.emplace_back(version);
-    }
-
-    auto result = m.exec_prepared("extract_historic_relations", ids, versions);
-    fetch_changesets(extract_changeset_ids(result), cc);
-    extract_relations(result, formatter, cc);
+    for_each_chunk(sel_historic_relations, [&](const std::vector<osm_edition_t> &eds) {
+      const auto [ids, versions] = split_editions(eds);
+      auto result = m.exec_prepared("extract_historic_relations", ids, versions);
+      fetch_changesets(extract_changeset_ids(result), cc);
+      extract_relations(result, formatter, cc);
+    });
   }
 }
 
@@ -373,8 +479,7 @@ void readonly_pgsql_selection::write_changesets(output_formatter &formatter,
 
   m.prepare("extract_changesets",
       R"(SELECT c.id,
-        to_char(c.created_at,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS created_at,
-        to_char(c.closed_at, 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS closed_at,
+        c.created_at, c.closed_at,
         c.min_lat, c.max_lat, c.min_lon, c.max_lon,
         c.num_changes,
         t.keys as tag_k, t.values as tag_v,
@@ -395,8 +500,7 @@ void readonly_pgsql_selection::write_changesets(output_formatter &formatter,
          array_agg(display_name) as display_name,
          array_agg(body) as body,
          array_agg(created_at) as created_at FROM
-           (SELECT cc.id, cc.author_id, u.display_name, cc.body,
-           to_char(cc.created_at,'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS created_at
+           (SELECT cc.id, cc.author_id, u.display_name, cc.body, cc.created_at
            FROM changeset_comments cc JOIN users u ON cc.author_id = u.id
            where cc.changeset_id=c.id AND cc.visible ORDER BY cc.created_at) x
          )cc ON true
@@ -461,26 +565,24 @@ int readonly_pgsql_selection::select_relations(const std::vector<osm_nwr_id_t> &
 
 int readonly_pgsql_selection::select_nodes_from_bbox(const bbox &bounds,
                                                      int max_nodes) {
-  const std::vector<tile_id_t> tiles = tiles_for_area(
-      bounds.minlat, bounds.minlon, bounds.maxlat, bounds.maxlon);
+  // contiguous ranges of tiles rather than every single tile in the bbox,
+  // which is a few hundred ranges instead of tens of thousands of tiles
+  // for large requests.
+  const auto [first_tiles, last_tiles] = split_tile_ranges(tile_ranges_for_area(
+      bounds.minlat, bounds.minlon, bounds.maxlat, bounds.maxlon));
 
   // select nodes with bbox
  m.prepare("visible_node_in_bbox",
-    R"(SELECT id
-      FROM current_nodes
-      WHERE tile = ANY($1)
-        AND latitude BETWEEN $2 AND $3
-        AND longitude BETWEEN $4 AND $5
-        AND visible = true
-      LIMIT $6)"_M);
-
-  // hack around problem with postgres' statistics, which was
-  // making it do seq scans all the time on smaug...
-  m.exec("set enable_mergejoin=false");
-  m.exec("set enable_hashjoin=false");
+    R"(SELECT n.id
+      FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[])) AS t(first_tile, last_tile)
+        INNER JOIN current_nodes n ON n.tile BETWEEN t.first_tile AND t.last_tile
+      WHERE n.latitude BETWEEN $3 AND $4
+        AND n.longitude BETWEEN $5 AND $6
+        AND n.visible = true
+      LIMIT $7)"_M, nested_loop_joins);
 
   return insert_results(
-      m.exec_prepared("visible_node_in_bbox", tiles,
+      m.exec_prepared("visible_node_in_bbox", first_tiles, last_tiles,
 		      int(bounds.minlat * global_settings::get_scale()),
 		      int(bounds.maxlat * global_settings::get_scale()),
 		      int(bounds.minlon * global_settings::get_scale()),
@@ -489,6 +591,360 @@ int readonly_pgsql_selection::select_nodes_from_bbox(const bbox &bounds,
       sel_nodes);
 }
 
+int readonly_pgsql_selection::select_map_closure(const bbox &bounds,
+                                                 int max_nodes) {
+  auto ranges = tile_ranges_for_area(bounds.minlat, bounds.minlon,
+                                     bounds.maxlat, bounds.maxlon);
+
+  int num_nodes = 0;
+  std::vector<osm_nwr_id_t> nodes;
+  std::vector<osm_nwr_id_t> ways;
+  std::vector<osm_nwr_id_t> relations;
+
+  // the closures of blocks of tiles well inside the bbox can come from the
+  // cache. only the remaining tiles are selected below, along with the
+  // parent relations of all relations.
+  if (m_map_tile_cache) {
+    const auto blocks = tile_blocks_for_area(bounds.minlat, bounds.minlon,
+                                             bounds.maxlat, bounds.maxlon,
+                                             MAP_TILE_MIN_LEVEL, MAP_TILE_MAX_LEVEL,
+                                             MAP_TILE_MARGIN);
+
+    if (!blocks.empty()) {
+      for (const auto &closure : select_map_tile_closures(blocks, max_nodes)) {
+        num_nodes += closure->num_nodes;
+        nodes.insert(nodes.end(), closure->nodes.begin(), closure->nodes.end());
+        ways.insert(ways.end(), closure->ways.begin(), closure->ways.end());
+        relations.insert(relations.end(), closure->relations.begin(),
+                         closure->relations.end());
+      }
+
+      if (num_nodes > max_nodes)
+        return num_nodes;
+
+      ranges = subtract_tile_blocks(ranges, blocks);
+    }
+  }
+
+  const auto [first_tiles, last_tiles] = split_tile_ranges(ranges);
+  const int remaining_nodes = max_nodes - num_nodes;
+
+  // same selections as select_nodes_from_bbox, select_ways_from_nodes,
+  // select_nodes_from_way_nodes, select_relations_from_ways,
+  // select_relations_from_nodes and select_relations_from_relations, in a
+  // single round trip. the closure is only computed if the node limit
+  // isn't exceeded, as the request will be rejected otherwise. the parent
+  // relations also include those of the relations given in $9.
+  m.prepare("map_closure",
+    R"(WITH bbox_nodes AS (
+        SELECT n.id
+        FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[])) AS t(first_tile, last_tile)
+          INNER JOIN current_nodes n ON n.tile BETWEEN t.first_tile AND t.last_tile
+        WHERE n.latitude BETWEEN $3 AND $4
+          AND n.longitude BETWEEN $5 AND $6
+          AND n.visible = true
+        LIMIT $7
+      ),
+      wanted AS (
+        SELECT count(*) <= $8 AS closure FROM bbox_nodes
+      ),
+      ways AS (
+        SELECT DISTINCT wn.way_id AS id
+        FROM current_way_nodes wn
+        WHERE wn.node_id IN (SELECT id FROM bbox_nodes)
+          AND (SELECT closure FROM wanted)
+      ),
+      nodes AS (
+        SELECT id FROM bbox_nodes
+        UNION
+        SELECT wn.node_id AS id
+        FROM current_way_nodes wn
+        WHERE wn.way_id IN (SELECT id FROM ways)
+      ),
+      relations AS (
+        SELECT rm.relation_id AS id
+        FROM current_relation_members rm
+        WHERE rm.member_type = 'Way'
+          AND rm.member_id IN (SELECT id FROM ways)
+        UNION
+        SELECT rm.relation_id AS id
+        FROM current_relation_members rm
+        WHERE rm.member_type = 'Node'
+          AND rm.member_id IN (SELECT id FROM nodes)
+          AND (SELECT closure FROM wanted)
+      ),
+      parent_relations AS (
+        SELECT rm.relation_id AS id
+        FROM current_relation_members rm
+        WHERE rm.member_type = 'Relation'
+          AND rm.member_id IN (SELECT id FROM relations
+                               UNION ALL
+                               SELECT unnest(CAST($9 AS bigint[])))
+      )
+      SELECT 'b' AS type, id FROM bbox_nodes
+      UNION ALL
+      SELECT 'n' AS type, id FROM nodes WHERE (SELECT closure FROM wanted)
+      UNION ALL
+      SELECT 'w' AS type, id FROM ways
+      UNION ALL
+      SELECT 'r' AS type, id FROM relations
+      UNION ALL
+      SELECT 'r' AS type, id FROM parent_relations
+      ORDER BY type, id)"_M, nested_loop_joins);
+
+  auto res = m.exec_prepared("map_closure", first_tiles, last_tiles,
+      int(bounds.minlat * global_settings::get_scale()),
+      int(bounds.maxlat * global_settings::get_scale()),
+      int(bounds.minlon * global_settings::get_scale()),
+      int(bounds.maxlon * global_settings::get_scale()),
+      (remaining_nodes + 1), remaining_nodes, relations);
+
+  auto const type_col = res.column_number("type");
+  auto const id_col = res.column_number("id");
+
+  for (const auto &row : res) {
+    const auto id = row[id_col].as<osm_nwr_id_t>();
+
+    switch (row[type_col].c_str()[0]) {
+    case 'b':
+      ++num_nodes;
+      nodes.emplace_back(id);
+      break;
+    case 'n':
+      nodes.emplace_back(id);
+      break;
+    case 'w':
+      ways.emplace_back(id);
+      break;
+    case 'r':
+      relations.emplace_back(id);
+      break;
+    default:
+      break;
+    }
+  }
+
+  sel_nodes.insert_batch(std::move(nodes));
+  sel_ways.insert_batch(std::move(ways));
+  sel_relations.insert_batch(std::move(relations));
+
+  return num_nodes;
+}
+
+std::vector<map_tile_cache::closure_ptr>
+readonly_pgsql_selection::select_map_tile_closures(const std::vector<tile_block> &blocks,
+                                                   int max_nodes) {
+  std::vector<map_tile_cache::closure_ptr> closures(blocks.size());
+
+  std::vector<std::size_t> cached;
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    if ((closures[i] = m_map_tile_cache->get(blocks[i])))
+      cached.emplace_back(i);
+  }
+
+  // cached closures are only used if no changeset which could have changed
+  // them has been edited since they were selected, whether the edits were
+  // uploaded here, by another instance or by the rails port. the last edit
+  // of a closed changeset may have been right before it was closed. open
+  // changesets close an idle timeout after their last edit, unless that
+  // would exceed their maximum duration, so they only count as edited if
+  // closed_at minus the idle timeout is recent enough, or if they are close
+  // to their maximum duration.
+  if (!cached.empty()) {
+    std::vector<int64_t> minlat, maxlat, minlon, maxlon;
+    std::vector<std::string> selected_at;
+
+    for (auto i : cached) {
+      const auto &closure = *closures[i];
+      minlat.emplace_back(closure.minlat);
+      maxlat.emplace_back(closure.maxlat);
+      minlon.emplace_back(closure.minlon);
+      maxlon.emplace_back(closure.maxlon);
+      selected_at.emplace_back(closure.selected_at);
+    }
+
+    m.prepare("map_tiles_changed",
+      R"(SELECT b.idx
+         FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[]),
+                     CAST($3 AS bigint[]), CAST($4 AS bigint[]),
+                     CAST($5 AS timestamp without time zone[]))
+           WITH ORDINALITY AS b(min_lat, max_lat, min_lon, max_lon, selected_at, idx)
+         WHERE EXISTS (
+           SELECT 1
+           FROM changesets c
+           WHERE c.closed_at > b.selected_at - CAST($6 AS interval)
+             AND c.min_lat <= b.max_lat AND c.max_lat >= b.min_lat
+             AND c.min_lon <= b.max_lon AND c.max_lon >= b.min_lon
+             AND (c.closed_at <= now() at time zone 'utc'
+                  OR c.closed_at - c.created_at > CAST($8 AS interval) - CAST($7 AS interval)
+                  OR c.closed_at - CAST($7 AS interval) > b.selected_at - CAST($6 AS interval))))"_M);
+
+    auto res = m.exec_prepared("map_tiles_changed", minlat, maxlat, minlon,
+                               maxlon, selected_at,
+                               fmt::format("{} seconds", m_map_tile_cache->edit_margin().count()),
+                               global_settings::get_changeset_timeout_idle(),
+                               global_settings::get_changeset_timeout_open_max());
+
+    for (const auto &row : res) {
+      const auto i = cached[row[0].as<std::size_t>() - 1];
+      m_map_tile_cache->invalidate(blocks[i]);
+      closures[i].reset();
+    }
+  }
+
+  int num_nodes = 0;
+  std::vector<tile_block> missing;
+  std::vector<tile_range_t> missing_ranges;
+
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    if (closures[i]) {
+      num_nodes += closures[i]->num_nodes;
+    } else {
+      missing.emplace_back(blocks[i]);
+      missing_ranges.emplace_back(blocks[i].tiles);
+    }
+  }
+
+  if (missing.empty() || num_nodes > max_nodes) {
+    std::erase(closures, nullptr);
+    return closures;
+  }
+
+  const auto [first_tiles, last_tiles] = split_tile_ranges(missing_ranges);
+  const int remaining_nodes = max_nodes - num_nodes;
+
+  // the closure of select_map_closure without the parent relations, for
+  // each block, and the area of the nodes of each closure. all nodes of the
+  // blocks are inside the bbox, so they're not checked against it.
+  m.prepare("map_tile_closures",
+    R"(WITH blocks AS (
+        SELECT *
+        FROM unnest(CAST($1 AS bigint[]), CAST($2 AS bigint[]))
+          WITH ORDINALITY AS t(first_tile, last_tile, block)
+      ),
+      block_nodes AS (
+        SELECT b.block, n.id
+        FROM blocks b
+          INNER JOIN current_nodes n ON n.tile BETWEEN b.first_tile AND b.last_tile
+        WHERE n.visible = true
+        LIMIT $3
+      ),
+      wanted AS (
+        SELECT count(*) <= $4 AS closure FROM block_nodes
+      ),
+      ways AS (
+        SELECT DISTINCT bn.block, wn.way_id AS id
+        FROM block_nodes bn
+          INNER JOIN current_way_nodes wn ON wn.node_id = bn.id
+        WHERE (SELECT closure FROM wanted)
+      ),
+      nodes AS (
+        SELECT block, id FROM block_nodes
+        UNION
+        SELECT w.block, wn.node_id AS id
+        FROM ways w
+          INNER JOIN current_way_nodes wn ON wn.way_id = w.id
+      ),
+      relations AS (
+        SELECT w.block, rm.relation_id AS id
+        FROM ways w
+          INNER JOIN current_relation_members rm
+            ON rm.member_type = 'Way' AND rm.member_id = w.id
+        UNION
+        SELECT n.block, rm.relation_id AS id
+        FROM nodes n
+          INNER JOIN current_relation_members rm
+            ON rm.member_type = 'Node' AND rm.member_id = n.id
+        WHERE (SELECT closure FROM wanted)
+      ),
+      areas AS (
+        SELECT n.block,
+               min(cn.latitude) AS min_lat, max(cn.latitude) AS max_lat,
+               min(cn.longitude) AS min_lon, max(cn.longitude) AS max_lon
+        FROM nodes n
+          INNER JOIN current_nodes cn ON cn.id = n.id
+        GROUP BY n.block
+      )
+      SELECT block, 'a' AS type, NULL AS id, min_lat, max_lat, min_lon, max_lon
+      FROM areas
+      UNION ALL
+      SELECT block, 'b' AS type, id, NULL, NULL, NULL, NULL FROM block_nodes
+      UNION ALL
+      SELECT block, 'n' AS type, id, NULL, NULL, NULL, NULL
+      FROM nodes WHERE (SELECT closure FROM wanted)
+      UNION ALL
+      SELECT block, 'w' AS type, id, NULL, NULL, NULL, NULL FROM ways
+      UNION ALL
+      SELECT block, 'r' AS type, id, NULL, NULL, NULL, NULL FROM relations
+      ORDER BY block, type, id)"_M, nested_loop_joins);
+
+  auto res = m.exec_prepared("map_tile_closures", first_tiles, last_tiles,
+                             (remaining_nodes + 1), remaining_nodes);
+
+  // now() is the start of the transaction, which the closures are as of
+  const auto selected_at = m.exec(
+      R"(SELECT to_char(now() at time zone 'utc', 'YYYY-MM-DD"T"HH24:MI:SS.US'))")[0][0]
+      .as<std::string>();
+
+  std::vector<map_tile_closure> selected(missing.size());
+  for (std::size_t i = 0; i < missing.size(); ++i) {
+    block_area(missing[i], selected[i]);
+    selected[i].selected_at = selected_at;
+  }
+
+  auto const block_col = res.column_number("block");
+  auto const type_col = res.column_number("type");
+  auto const id_col = res.column_number("id");
+  auto const min_lat_col = res.column_number("min_lat");
+  auto const max_lat_col = res.column_number("max_lat");
+  auto const min_lon_col = res.column_number("min_lon");
+  auto const max_lon_col = res.column_number("max_lon");
+
+  for (const auto &row : res) {
+    auto &closure = selected[row[block_col].as<std::size_t>() - 1];
+
+    switch (row[type_col].c_str()[0]) {
+    case 'a':
+      closure.minlat = std::min(closure.minlat, row[min_lat_col].as<int64_t>());
+      closure.maxlat = std::max(closure.maxlat, row[max_lat_col].as<int64_t>());
+      closure.minlon = std::min(closure.minlon, row[min_lon_col].as<int64_t>());
+      closure.maxlon = std::max(closure.maxlon, row[max_lon_col].as<int64_t>());
+      break;
+    case 'b':
+      ++closure.num_nodes;
+      ++num_nodes;
+      break;
+    case 'n':
+      closure.nodes.emplace_back(row[id_col].as<osm_nwr_id_t>());
+      break;
+    case 'w':
+      closure.ways.emplace_back(row[id_col].as<osm_nwr_id_t>());
+      break;
+    case 'r':
+      closure.relations.emplace_back(row[id_col].as<osm_nwr_id_t>());
+      break;
+    default:
+      break;
+    }
+  }
+
+  // the closures weren't selected, so they mustn't be cached
+  const bool complete = num_nodes <= max_nodes;
+
+  for (std::size_t i = 0, j = 0; i < blocks.size(); ++i) {
+    if (closures[i])
+      continue;
+
+    auto closure = std::make_shared<const map_tile_closure>(std::move(selected[j]));
+    if (complete)
+      m_map_tile_cache->insert(missing[j], closure);
+    closures[i] = std::move(closure);
+    ++j;
+  }
+
+  return closures;
+}
+
 void readonly_pgsql_selection::select_nodes_from_relations() {
   logger::message("Filling sel_nodes (from relations)");
 
@@ -575,7 +1031,7 @@ void readonly_pgsql_selection::select_relations_from_nodes() {
 void readonly_pgsql_selection::select_relations_from_relations(bool drop_relations) {
   if (!sel_relations.empty()) {
 
-    std::set<osm_nwr_id_t> sel;
+    id_set<osm_nwr_id_t> sel;
     if (drop_relations)
       sel_relations.swap(sel);
     else
@@ -786,6 +1242,68 @@ int readonly_pgsql_selection::select_historical_by_changesets(
   return selected;
 }
 
+std::optional<data_selection::selection_version>
+readonly_pgsql_selection::get_selection_version() {
+
+  if (sel_nodes.empty() && sel_ways.empty() && sel_relations.empty() &&
+      sel_historic_nodes.empty() && sel_historic_ways.empty() &&
+      sel_historic_relations.empty())
+    return {};
+
+  // the elements are written out with the name of the user of their
+  // changeset, so that is part of the digest too.
+  m.prepare("selection_version",
+    R"(WITH elements(type, id, version, redaction_id, changeset_id, timestamp) AS (
+        SELECT 'n', id, version, NULL::bigint, changeset_id, timestamp
+          FROM current_nodes WHERE id = ANY($1)
+        UNION ALL
+        SELECT 'w', id, version, NULL::bigint, changeset_id, timestamp
+          FROM current_ways WHERE id = ANY($2)
+        UNION ALL
+        SELECT 'r', id, version, NULL::bigint, changeset_id, timestamp
+          FROM current_relations WHERE id = ANY($3)
+        UNION ALL
+        SELECT 'n', n.node_id, n.version, n.redaction_id, n.changeset_id, n.timestamp
+          FROM nodes n
+          INNER JOIN unnest(CAST($4 AS bigint[]), CAST($5 AS bigint[])) AS x(id, version)
+            ON n.node_id = x.id AND n.version = x.version
+        UNION ALL
+        SELECT 'w', w.way_id, w.version, w.redaction_id, w.changeset_id, w.timestamp
+          FROM ways w
+          INNER JOIN unnest(CAST($6 AS bigint[]), CAST($7 AS bigint[])) AS x(id, version)
+            ON w.way_id = x.id AND w.version = x.version
+        UNION ALL
+        SELECT 'r', r.relation_id, r.version, r.redaction_id, r.changeset_id, r.timestamp
+          FROM relations r
+          INNER JOIN unnest(CAST($8 AS bigint[]), CAST($9 AS bigint[])) AS x(id, version)
+            ON r.relation_id = x.id AND r.version = x.version
+      )
+      SELECT md5(string_agg(concat_ws(':', e.type, e.id, e.version,
+                                      coalesce(e.redaction_id, 0),
+                                      u.data_public, u.display_name),
+                            ',' ORDER BY e.type, e.id, e.version)) AS digest,
+             CAST(extract(epoch FROM max(e.timestamp)) AS bigint) AS last_modified
+        FROM elements e
+          LEFT JOIN changesets c ON c.id = e.changeset_id
+          LEFT JOIN users u ON u.id = c.user_id)"_M);
+
+  const auto [node_ids, node_versions] = split_editions(sel_historic_nodes.values());
+  const auto [way_ids, way_versions] = split_editions(sel_historic_ways.values());
+  const auto [relation_ids, relation_versions] = split_editions(sel_historic_relations.values());
+
+  auto res = m.exec_prepared("selection_version", sel_nodes, sel_ways, sel_relations,
+                             node_ids, node_versions, way_ids, way_versions,
+                             relation_ids, relation_versions);
+
+  if (res.empty() || res[0]["digest"].is_null())
+    return {};
+
+  // redacted versions are only included for moderators
+  return selection_version{
+    fmt::format("{}:{}", res[0]["digest"].as<std::string>(), m_redactions_visible),
+    std::chrono::system_clock::from_time_t(res[0]["last_modified"].as<std::time_t>())};
+}
+
 void readonly_pgsql_selection::drop_nodes() {
   sel_nodes.clear();
 }
@@ -822,6 +1340,9 @@ bool readonly_pgsql_selection::supports_user_details() const {
 
 bool readonly_pgsql_selection::is_user_blocked(const osm_user_id_t id) {
 
+  if (m_user_details && m_user_details->user_id == id)
+    return m_user_details->blocked;
+
   m.prepare("check_user_blocked",
     R"(SELECT id FROM "user_blocks"
           WHERE "user_blocks"."user_id" = $1
@@ -833,6 +1354,9 @@ bool readonly_pgsql_selection::is_user_blocked(const osm_user_id_t id) {
 
 std::set< osm_user_role_t > readonly_pgsql_selection::get_roles_for_user(osm_user_id_t id)
 {
+  if (m_user_details && m_user_details->user_id == id)
+    return m_user_details->roles;
+
   std::set<osm_user_role_t> roles;
 
   // return all the roles to which the user belongs.
@@ -842,14 +1366,8 @@ std::set< osm_user_role_t > readonly_pgsql_selection::get_roles_for_user(osm_use
   auto res = m.exec_prepared("roles_for_user", id);
 
   for (const auto &tuple : res) {
-    auto role = tuple[0].as<std::string>();
-    if (role == "moderator") {
-      roles.insert(osm_user_role_t::moderator);
-    } else if (role == "administrator") {
-      roles.insert(osm_user_role_t::administrator);
-    } else if (role == "importer") {
-      roles.insert(osm_user_role_t::importer);
-    }
+    if (auto role = role_from_name(tuple[0].as<std::string>()))
+      roles.insert(*role);
   }
 
   return roles;
@@ -859,37 +1377,84 @@ std::optional< osm_user_id_t > readonly_pgsql_selection::get_user_id_for_oauth2_
     const std::string &token_id, bool &expired, bool &revoked,
     bool &allow_api_write)
 {
-  // return details for OAuth 2.0 access token
-  m.prepare("oauth2_access_token",
-    R"(SELECT resource_owner_id as user_id,
-         CASE WHEN expires_in IS NULL THEN false
-              ELSE (created_at + expires_in * interval '1' second) < now() at time zone 'utc'
-         END as expired,
-         COALESCE(revoked_at < now() at time zone 'utc', false) as revoked,
-         'write_api' = any(string_to_array(coalesce(scopes,''), ' ')) as allow_api_write
-       FROM oauth_access_tokens
-       WHERE token = $1
-          OR token = encode(sha256($1::bytea), 'hex'))"_M);
-
-  auto res = m.exec_prepared("oauth2_access_token", token_id);
-
-  if (!res.empty()) {
-    auto uid = res[0]["user_id"].as<osm_user_id_t>();
-    expired = res[0]["expired"].as<bool>();
-    revoked = res[0]["revoked"].as<bool>();
-    allow_api_write = res[0]["allow_api_write"].as<bool>();
-    return uid;
+  const auto details = get_oauth2_user_details(token_id);
 
-  } else {
-    expired = true;
-    revoked = true;
-    allow_api_write = false;
-    return {};
+  expired = details.expired;
+  revoked = details.revoked;
+  allow_api_write = details.allow_api_write;
+  return details.user_id;
+}
+
+data_selection::oauth2_user_details
+readonly_pgsql_selection::get_oauth2_user_details(const std::string &token_id)
+{
+  const auto now = std::chrono::steady_clock::now();
+
+  auto token = m_auth_cache ? m_auth_cache->tokens.get(token_id) : std::nullopt;
+
+  if (!token && m_auth_cache && m_auth_cache->unknown_tokens.get(token_id))
+    token = cached_oauth2_token{};
+
+  if (!token) {
+    // return details for OAuth 2.0 access token, and the roles and
+    // status of its user, in a single query.
+    m.prepare("oauth2_user_details",
+      R"(SELECT t.resource_owner_id as user_id,
+           extract(epoch from t.created_at + t.expires_in * interval '1' second
+                              - (now() at time zone 'utc')) as expires_in,
+           extract(epoch from t.revoked_at - (now() at time zone 'utc')) as revoked_in,
+           'write_api' = any(string_to_array(coalesce(t.scopes,''), ' ')) as allow_api_write,
+           ARRAY(SELECT r.role FROM user_roles r
+                 WHERE r.user_id = t.resource_owner_id) as roles,
+           EXISTS(SELECT 1 FROM user_blocks b
+                  WHERE b.user_id = t.resource_owner_id
+                    AND (b.needs_view or b.ends_at > (now() at time zone 'utc'))) as blocked,
+           EXISTS(SELECT 1 FROM users u
+                  WHERE u.id = t.resource_owner_id
+                    AND (u.status = 'active' or u.status = 'confirmed')) as active
+         FROM oauth_access_tokens t
+         WHERE t.token = $1
+            OR t.token = encode(sha256($1::bytea), 'hex'))"_M);
+
+    auto res = m.exec_prepared("oauth2_user_details", token_id);
+
+    token = cached_oauth2_token{};
+
+    if (!res.empty()) {
+      const auto &row = res[0];
+      auto &details = token->details;
+      details.user_id = row["user_id"].as<osm_user_id_t>();
+      token->expires_at = time_from_now(row["expires_in"], now);
+      token->revoked_at = time_from_now(row["revoked_in"], now);
+      details.allow_api_write = row["allow_api_write"].as<bool>();
+      for (const auto &name : psql_array_to_vector(row["roles"])) {
+        if (auto role = role_from_name(name))
+          details.roles.insert(*role);
+      }
+      details.blocked = row["blocked"].as<bool>();
+      details.active = row["active"].as<bool>();
+    }
+
+    // the cache is keyed on the token itself, as it's only kept in memory
+    if (m_auth_cache) {
+      if (token->details.user_id)
+        m_auth_cache->tokens.put(token_id, *token);
+      else
+        m_auth_cache->unknown_tokens.put(token_id, {});
+    }
   }
+
+  // the other user functions answer from this for the token's user
+  m_user_details = token->at(now);
+
+  return *m_user_details;
 }
 
 bool readonly_pgsql_selection::is_user_active(const osm_user_id_t id)
 {
+  if (m_user_details && m_user_details->user_id == id)
+    return m_user_details->active;
+
   m.prepare("is_user_active",
          R"(SELECT id FROM users
             WHERE id = $1
@@ -899,28 +1464,39 @@ bool readonly_pgsql_selection::is_user_active(const osm_user_id_t id)
   return (!res.empty());
 }
 
-std::set< osm_changeset_id_t > readonly_pgsql_selection::extract_changeset_ids(const pqxx::result& result) const {
+id_set< osm_changeset_id_t > readonly_pgsql_selection::extract_changeset_ids(const pqxx::result& result) const {
 
-  std::set< osm_changeset_id_t > changeset_ids;
+  std::vector< osm_changeset_id_t > ids;
+  ids.reserve(result.size());
   auto const changeset_id_col = result.column_number("changeset_id");
 
   for (const auto & row : result) {
-    changeset_ids.insert(row[changeset_id_col].as<osm_changeset_id_t>());
+    ids.emplace_back(row[changeset_id_col].as<osm_changeset_id_t>());
   }
+
+  id_set< osm_changeset_id_t > changeset_ids;
+  changeset_ids.insert_batch(std::move(ids));
   return changeset_ids;
 }
 
-void readonly_pgsql_selection::fetch_changesets(const std::set< osm_changeset_id_t >& all_ids, std::map<osm_changeset_id_t, changeset>& cc ) {
+void readonly_pgsql_selection::fetch_changesets(const id_set< osm_changeset_id_t >& all_ids, std::map<osm_changeset_id_t, changeset>& cc ) {
 
-  std::set< osm_changeset_id_t> ids;
+  std::vector< osm_changeset_id_t > missing;
 
   // check if changeset is already contained in map
   for (auto id: all_ids) {
     if (!cc.contains(id)) {
-      ids.insert(id);
+      missing.emplace_back(id);
     }
   }
 
+  // ... or in the cache shared with earlier requests
+  if (m_changeset_cache && !missing.empty())
+    missing = m_changeset_cache->lookup(missing, cc);
+
+  id_set< osm_changeset_id_t > ids;
+  ids.insert_batch(std::move(missing));
+
   if (ids.empty())
     return;
 
@@ -967,6 +1543,12 @@ void readonly_pgsql_selection::fetch_changesets(const std::set< osm_changeset_id
           fmt::format("Possible database inconsistency with changeset {:d}.", id));
     }
   }
+
+  if (m_changeset_cache) {
+    for (const auto & id : ids) {
+      m_changeset_cache->insert(id, cc[id]);
+    }
+  }
 }
 
 readonly_pgsql_selection::factory::factory(const po::variables_map &opts)
@@ -981,15 +1563,68 @@ readonly_pgsql_selection::factory::factory(const po::variables_map &opts)
 #if PQXX_VERSION_MAJOR < 7
   // set the connection to use readonly transaction.
   m_connection.set_variable("default_transaction_read_only", "true");
+  // timestamps are formatted client side, see format_pg_timestamp
+  m_connection.set_variable("DateStyle", "ISO");
 #else
   m_connection.set_session_var("default_transaction_read_only", "true");
+  m_connection.set_session_var("DateStyle", "ISO");
 #endif
+
+  if (opts.contains("changeset-cache-size")) {
+    const auto size = opts["changeset-cache-size"].as<int>();
+    const auto ttl = opts.contains("changeset-cache-ttl")
+                         ? opts["changeset-cache-ttl"].as<int>()
+                         : DEFAULT_CHANGESET_CACHE_TTL;
+
+    if (size < 0)
+      throw std::runtime_error("changeset-cache-size must not be negative");
+
+    if (ttl <= 0)
+      throw std::runtime_error("changeset-cache-ttl must be greater than 0");
+
+    if (size > 0)
+      m_changeset_cache = changeset_cache::shared(size, std::chrono::seconds(ttl));
+  }
+
+  if (opts.contains("map-tile-cache-size")) {
+    const auto size = opts["map-tile-cache-size"].as<int>();
+    const auto ttl = opts.contains("map-tile-cache-ttl")
+                         ? opts["map-tile-cache-ttl"].as<int>()
+                         : DEFAULT_MAP_TILE_CACHE_TTL;
+
+    const auto edit_margin = opts.contains("map-tile-cache-edit-margin")
+                                 ? opts["map-tile-cache-edit-margin"].as<int>()
+                                 : DEFAULT_MAP_TILE_CACHE_EDIT_MARGIN;
+
+    if (size < 0)
+      throw std::runtime_error("map-tile-cache-size must not be negative");
+
+    if (ttl <= 0)
+      throw std::runtime_error("map-tile-cache-ttl must be greater than 0");
+
+    if (edit_margin < 0)
+      throw std::runtime_error("map-tile-cache-edit-margin must not be negative");
+
+    if (size > 0)
+      m_map_tile_cache = map_tile_cache::shared(size, std::chrono::seconds(ttl),
+                                                std::chrono::seconds(edit_margin));
+  }
+
+  if (opts.contains("oauth2-cache-ttl")) {
+    const auto ttl = opts["oauth2-cache-ttl"].as<int>();
+
+    if (ttl < 0)
+      throw std::runtime_error("oauth2-cache-ttl must not be negative");
+
+    m_auth_cache = auth_cache::shared(std::chrono::seconds(ttl));
+  }
 }
 
 
 std::unique_ptr<data_selection>
 readonly_pgsql_selection::factory::make_selection(Transaction_Owner_Base& to) const {
-  return std::make_unique<readonly_pgsql_selection>(to);
+  return std::make_unique<readonly_pgsql_selection>(to, m_changeset_cache, m_auth_cache,
+                                                    m_map_tile_cache);
 }
 
 std::unique_ptr<Transaction_Owner_Base>
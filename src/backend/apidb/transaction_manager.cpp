@@ -9,6 +9,12 @@
 
 #include "cgimap/backend/apidb/transaction_manager.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
 #include <pqxx/pqxx>
 
 
@@ -50,16 +56,114 @@ Transaction_Manager::Transaction_Manager(Transaction_Owner_Base &to) :
 }
 
 void Transaction_Manager::prepare(const std::string &name,
-                                  const std::string &definition) {
+                                  const std::string &definition,
+                                  const planner_settings &settings) {
   if (!m_prep_stmt.contains(name))
   {
     m_txn.conn().prepare(name, definition);
+#if PQXX_VERSION_MAJOR < 7
+    // libpqxx 6 only prepares on first use through exec_prepared, but
+    // deferred statements refer to it by name with EXECUTE.
+    m_txn.conn().prepare_now(name);
+#endif
     m_prep_stmt.insert(name);
   }
+
+  if (!settings.empty())
+    m_planner_settings.insert_or_assign(name, settings);
+}
+
+const planner_settings &
+Transaction_Manager::declared_planner_settings(std::string_view statement) const {
+  static const planner_settings none;
+
+  auto it = m_planner_settings.find(statement);
+  return it == m_planner_settings.end() ? none : it->second;
+}
+
+bool Transaction_Manager::planner_settings_change(std::string_view statement) const {
+  const auto &declared = declared_planner_settings(statement);
+
+  return declared.size() != m_active_settings.size() ||
+         !std::ranges::all_of(declared, [&](const auto &setting) {
+           auto active = m_active_settings.find(setting.first);
+           return active != m_active_settings.end() && active->second == setting.second;
+         });
+}
+
+std::vector<std::string>
+Transaction_Manager::pending_planner_settings(std::string_view statement) {
+  const auto &declared = declared_planner_settings(statement);
+
+  std::vector<std::string> queries;
+
+  // SET LOCAL lasts until the end of the transaction, so settings which
+  // this statement doesn't declare are put back to their defaults.
+  for (auto active = m_active_settings.begin(); active != m_active_settings.end();) {
+    if (std::ranges::any_of(declared, [&](const auto &setting) { return setting.first == active->first; })) {
+      ++active;
+      continue;
+    }
+
+    queries.emplace_back(fmt::format("SET LOCAL {} TO DEFAULT", m_txn.quote_name(active->first)));
+    active = m_active_settings.erase(active);
+  }
+
+  for (const auto &[name, value] : declared) {
+    auto active = m_active_settings.find(name);
+    if (active != m_active_settings.end() && active->second == value)
+      continue;
+
+    queries.emplace_back(fmt::format("SET LOCAL {} = {}", m_txn.quote_name(name), m_txn.quote(value)));
+    m_active_settings.insert_or_assign(name, value);
+  }
+
+  return queries;
+}
+
+pqxx::result Transaction_Manager::flush() {
+  if (m_deferred.empty())
+    return {};
+
+  const auto deferred = std::exchange(m_deferred, {});
+
+  pqxx_stats stats;
+
+  pqxx::pipeline pipeline(m_txn);
+  std::vector<pqxx::pipeline::query_id> query_ids;
+  query_ids.reserve(deferred.size());
+
+  // hold back all queries until complete(), so they're sent in one go
+  pipeline.retain(std::numeric_limits<int>::max());
+
+  for (const auto &statement : deferred) {
+    for (const auto &setting : statement.settings)
+      pipeline.insert(setting);
+    query_ids.push_back(pipeline.insert(statement.query));
+  }
+
+  pipeline.complete();
+
+  pqxx::result res;
+  for (std::size_t i = 0; i < deferred.size(); ++i) {
+    res = pipeline.retrieve(query_ids[i]);
+    stats.log_statement_stats(deferred[i].name, res);
+    if (deferred[i].check)
+      deferred[i].check(res);
+  }
+
+  return res;
 }
 
 pqxx::result Transaction_Manager::exec(const std::string &query,
                                        const std::string &) {
+  flush();
+
+  // plain queries don't declare any planner settings, so reset those
+  // still in effect in the same round trip.
+  const auto settings = pending_planner_settings({});
+  if (!settings.empty())
+    return m_txn.exec(fmt::format("{};{}", fmt::join(settings, ";"), query));
+
   return m_txn.exec(query);
 }
-
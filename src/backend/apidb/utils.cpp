@@ -7,7 +7,9 @@
  * For a full list of authors see the git log.
  */
 
+#include <bit>
 #include <charconv>
+#include <stdexcept>
 #include <string_view>
 #include <string>
 #include <vector>
@@ -17,6 +19,10 @@
 
 #include "cgimap/backend/apidb/utils.hpp"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 void check_postgres_version(const pqxx::connection_base &conn) {
   auto version = conn.server_version();
   if (version < 110000) {
@@ -35,6 +41,27 @@ void extract_bbox_from_row(const pqxx::row &row, bbox_t &result) {
   result.maxlon = row["maxlon"].as<int64_t>();
 }
 
+std::string format_pg_timestamp(std::string_view ts) {
+
+  // YYYY-MM-DD HH:MM:SS, optionally followed by fractional seconds
+  if (ts.size() < 19 || ts[4] != '-' || ts[7] != '-' || ts[10] != ' ' ||
+      ts[13] != ':' || ts[16] != ':') {
+    throw std::runtime_error(fmt::format("Unexpected timestamp format: {}", ts));
+  }
+
+  std::string result;
+  result.reserve(20);
+  result.append(ts.substr(0, 10));
+  result += 'T';
+  result.append(ts.substr(11, 8));
+  result += 'Z';
+  return result;
+}
+
+std::string format_pg_timestamp(const pqxx::field& field) {
+  return format_pg_timestamp(std::string_view(field.c_str(), field.size()));
+}
+
 /**
  * From: https://www.postgresql.org/docs/current/libpq-connect.html
  * Keyword/Value Connection Strings
@@ -63,64 +90,124 @@ std::string escape_pg_value(const std::string &value) {
   return escaped;
 }
 
+namespace {
+
+// returns the position of the next ',', '"', '\\' or '}' at or after pos,
+// or the size of str if there isn't any.
+std::size_t find_array_special(std::string_view str, std::size_t pos) {
+#if defined(__SSE2__)
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i brace = _mm_set1_epi8('}');
+
+  while (pos + 16 <= str.size()) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + pos));
+    const __m128i matches = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, quote)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, brace)));
+    if (const int mask = _mm_movemask_epi8(matches); mask != 0) {
+      return pos + std::countr_zero(static_cast<unsigned int>(mask));
+    }
+    pos += 16;
+  }
+#endif
+
+  for (; pos < str.size(); pos++) {
+    switch (str[pos]) {
+    case ',':
+    case '"':
+    case '\\':
+    case '}':
+      return pos;
+    default:
+      break;
+    }
+  }
+  return str.size();
+}
+
+} // anonymous namespace
+
 std::vector<std::string> psql_array_to_vector(const pqxx::field& field, int size_hint) {
   return psql_array_to_vector(std::string_view(field.c_str(), field.size()), size_hint);
 }
 
 std::vector<std::string> psql_array_to_vector(std::string_view str, int size_hint) {
-  std::vector<std::string> strs;
-  std::string value;
-  bool quotedValue = false;
-  bool escaped = false;
-  bool write = false;
+  std::string unescaped;
+  const auto views = psql_array_to_views(str, unescaped, size_hint);
+  return {views.begin(), views.end()};
+}
+
+std::vector<std::string_view> psql_array_to_views(const pqxx::field& field, std::string &unescaped, int size_hint) {
+  return psql_array_to_views(std::string_view(field.c_str(), field.size()), unescaped, size_hint);
+}
+
+std::vector<std::string_view> psql_array_to_views(std::string_view str, std::string &unescaped, int size_hint) {
+  std::vector<std::string_view> values;
+
+  unescaped.clear();
 
   if (size_hint > 0)
-    strs.reserve(size_hint);
+    values.reserve(size_hint);
 
-  if (str == "{NULL}" || str.empty())
-    return strs;
+  if (str == "{NULL}" || str.size() < 2 || str == "{}")
+    return values;
 
   const auto str_size = str.size();
-  for (unsigned int i = 1; i < str_size; i++) {
-    if (str[i] == ',') {
-      if (quotedValue) {
-        value += ',';
-      } else {
-        write = true;
-      }
-    } else if (str[i] == '"') {
-      if (escaped) {
-        value += '"';
-        escaped = false;
-      } else if (quotedValue) {
-        quotedValue = false;
-      } else {
-        quotedValue = true;
+  std::size_t pos = 1;
+
+  while (pos < str_size) {
+    if (str[pos] == '"') {
+      // quoted value, ',' and '}' are part of the value, '"' and '\\' are
+      // escaped with a backslash.
+      const std::size_t start = pos + 1;
+      std::size_t end = start;
+      bool escaped = false;
+
+      while ((end = find_array_special(str, end)) < str_size) {
+        if (str[end] == '"')
+          break;
+        if (str[end] == '\\') {
+          escaped = true;
+          end++;
+        }
+        end++;
       }
-    } else if (str[i] == '\\') {
+
+      if (end >= str_size)
+        throw std::runtime_error("Unterminated quoted value in array");
+
       if (escaped) {
-        value += '\\';
-        escaped = false;
-      } else {
-        escaped = true;
-      }
-    } else if (str[i] == '}') {
-      if (quotedValue) {
-        value += '}';
+        // unescaped values are never longer than the input, so reserving
+        // once guarantees views into the buffer stay valid.
+        if (unescaped.capacity() < str_size)
+          unescaped.reserve(str_size);
+
+        const auto offset = unescaped.size();
+        for (std::size_t i = start; i < end; i++) {
+          if (str[i] == '\\')
+            i++;
+          unescaped += str[i];
+        }
+        values.emplace_back(unescaped.data() + offset, unescaped.size() - offset);
       } else {
-        write = true;
+        values.emplace_back(str.substr(start, end - start));
       }
+      pos = end + 1;
     } else {
-      value += str[i];
+      // unquoted values don't contain any special characters
+      const std::size_t end = find_array_special(str, pos);
+      values.emplace_back(str.substr(pos, end - pos));
+      pos = end;
     }
 
-    if (write) {
-      strs.emplace_back(std::move(value));
-      value.clear();
-      write = false;
-    }
+    // pos is now at the ',' or '}' after the value
+    if (pos >= str_size || str[pos] == '}')
+      break;
+    pos++;
   }
-  return strs;
+  return values;
 }
 
 template <typename T>
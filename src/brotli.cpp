@@ -11,16 +11,19 @@
 #include "cgimap/brotli.hpp"
 
 #include <cassert>
+#include <new>
+
+#include <fmt/core.h>
 
 #if HAVE_BROTLI
 
 
-brotli_output_buffer::brotli_output_buffer(output_buffer& o)
+brotli_output_buffer::brotli_output_buffer(output_buffer& o, int quality)
     : out(o) {
 
   state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
 
-  BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, 5);
+  BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, quality);
 }
 
 int brotli_output_buffer::compress(const char *data, int data_length, bool last)
@@ -83,4 +86,42 @@ int brotli_output_buffer::flush() noexcept {
   return 0;
 }
 
+BrotliDecompressor::BrotliDecompressor()
+    : state_(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)) {
+
+  if (state_ == nullptr)
+    throw std::bad_alloc();
+}
+
+BrotliDecompressor::~BrotliDecompressor() {
+  BrotliDecoderDestroyInstance(state_);
+}
+
+void BrotliDecompressor::decompress(std::string_view input, const sink_t &sink) {
+
+  size_t available_in = input.size();
+  auto next_in = reinterpret_cast<const uint8_t *>(input.data());
+
+  while (true) {
+    auto available_out = buff.size();
+    auto next_out = buff.data();
+
+    auto result = BrotliDecoderDecompressStream(state_, &available_in, &next_in,
+                                                &available_out, &next_out, nullptr);
+
+    if (result == BROTLI_DECODER_RESULT_ERROR)
+      throw decompression_error(fmt::format("Brotli decompression failed: {}",
+          BrotliDecoderErrorString(BrotliDecoderGetErrorCode(state_))));
+
+    auto output_bytes = buff.size() - available_out;
+    if (output_bytes) {
+      sink(std::string_view(reinterpret_cast<const char *>(buff.data()), output_bytes));
+    }
+
+    // all input consumed, or end of stream reached
+    if (result != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT)
+      break;
+  }
+}
+
 #endif
@@ -15,6 +15,8 @@
 #include "cgimap/xml_formatter.hpp"
 #include "cgimap/json_writer.hpp"
 #include "cgimap/json_formatter.hpp"
+#include "cgimap/pbf_writer.hpp"
+#include "cgimap/pbf_formatter.hpp"
 #include "cgimap/text_writer.hpp"
 #include "cgimap/text_formatter.hpp"
 #include "cgimap/util.hpp"
@@ -243,6 +245,9 @@ std::unique_ptr<output_formatter> create_formatter(mime::type best_type, output_
     case mime::type::application_json:
       return std::make_unique<json_formatter>(std::make_unique<json_writer>(out, false));
 
+    case mime::type::application_x_protobuf:
+      return std::make_unique<pbf_formatter>(std::make_unique<pbf_writer>(out));
+
     case mime::type::text_plain:
       return std::make_unique<text_formatter>(std::make_unique<text_writer>(out, true));
 
@@ -0,0 +1,89 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/coalescing_output_buffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+coalescing_output_buffer::coalescing_output_buffer(output_buffer &o,
+                                                   std::size_t capacity)
+    : out(o), m_buffer(std::max<std::size_t>(capacity, 1)),
+      m_direct(std::max<std::size_t>(capacity / 4, 1)) {}
+
+int coalescing_output_buffer::write(const char *buffer, int len) noexcept {
+  if (len < 0)
+    return -1;
+
+  ++m_writes;
+
+  const auto size = static_cast<std::size_t>(len);
+
+  if (size < m_direct && m_used + size <= m_buffer.size()) {
+    std::memcpy(m_buffer.data() + m_used, buffer, size);
+    m_used += size;
+    m_written += len;
+
+    if (m_used == m_buffer.size() && drain() < 0)
+      return -1;
+
+    return len;
+  }
+
+  if (hand_on(std::string_view(buffer, size)) < 0)
+    return -1;
+
+  m_written += len;
+  return len;
+}
+
+// hands on the collected data followed by data, in one go
+int coalescing_output_buffer::hand_on(std::string_view data) noexcept {
+  std::array<std::string_view, 2> pieces;
+  std::size_t count = 0;
+
+  if (m_used > 0)
+    pieces[count++] = std::string_view(m_buffer.data(), m_used);
+  if (!data.empty())
+    pieces[count++] = data;
+
+  if (count == 0)
+    return 0;
+
+  ++m_chunks;
+  const int rc = out.write_chunks(std::span(pieces.data(), count));
+  m_used = 0;
+  return rc;
+}
+
+int coalescing_output_buffer::drain() noexcept {
+  return hand_on({});
+}
+
+int coalescing_output_buffer::written() const { return m_written; }
+
+int coalescing_output_buffer::close() noexcept {
+  if (drain() < 0)
+    return -1;
+  return out.close();
+}
+
+int coalescing_output_buffer::flush() noexcept {
+  if (drain() < 0)
+    return -1;
+  return out.flush();
+}
+
+void coalescing_output_buffer::reset() noexcept {
+  m_used = 0;
+  m_written = 0;
+  m_writes = 0;
+  m_chunks = 0;
+}
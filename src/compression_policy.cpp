@@ -0,0 +1,94 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/compression_policy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+// responses expected to be at least this large are compressed with less
+// effort, as compression time grows with their size while the client
+// spends most of its time waiting for the database anyway.
+constexpr std::size_t MEDIUM_EFFORT_SIZE = 512 * 1024;
+constexpr std::size_t FAST_EFFORT_SIZE = 4 * 1024 * 1024;
+
+// below this share of idle CPU time, responses are compressed with one
+// level less effort, and below the second with the least.
+constexpr double LOW_HEADROOM = 0.25;
+constexpr double NO_HEADROOM = 0.1;
+
+// responses are only split up for parallel compression if they're large
+// enough for several blocks, and if other requests don't need the CPUs.
+constexpr std::size_t PARALLEL_SIZE = 1024 * 1024;
+constexpr double PARALLEL_HEADROOM = 0.5;
+
+compression_effort less_effort(compression_effort effort) {
+  return effort == compression_effort::high ? compression_effort::medium
+                                            : compression_effort::fast;
+}
+
+} // anonymous namespace
+
+compression_effort choose_compression_effort(std::optional<std::size_t> expected_size,
+                                             double cpu_headroom) {
+  auto effort = compression_effort::high;
+
+  if (expected_size) {
+    if (*expected_size >= FAST_EFFORT_SIZE)
+      effort = compression_effort::fast;
+    else if (*expected_size >= MEDIUM_EFFORT_SIZE)
+      effort = compression_effort::medium;
+  }
+
+  if (cpu_headroom < NO_HEADROOM)
+    effort = compression_effort::fast;
+  else if (cpu_headroom < LOW_HEADROOM)
+    effort = less_effort(effort);
+
+  return effort;
+}
+
+compression_settings choose_compression(std::optional<std::size_t> expected_size,
+                                        double cpu_headroom) {
+  compression_settings settings;
+  settings.effort = choose_compression_effort(expected_size, cpu_headroom);
+  settings.parallel = expected_size && *expected_size >= PARALLEL_SIZE &&
+                      cpu_headroom >= PARALLEL_HEADROOM;
+  return settings;
+}
+
+double cpu_headroom() {
+  using namespace std::chrono;
+
+  static std::atomic<double> headroom{1.0};
+  static std::atomic<int64_t> next_update{0};
+
+  const int64_t now =
+      duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+
+  // only one thread refreshes the value, the others use the old one
+  auto next = next_update.load(std::memory_order_relaxed);
+  if (now >= next &&
+      next_update.compare_exchange_strong(next, now + 1000,
+                                          std::memory_order_relaxed)) {
+    double load = 0.0;
+    const unsigned int cpus = std::max(1u, std::thread::hardware_concurrency());
+    if (getloadavg(&load, 1) == 1) {
+      headroom.store(std::clamp(1.0 - load / cpus, 0.0, 1.0),
+                     std::memory_order_relaxed);
+    }
+  }
+
+  return headroom.load(std::memory_order_relaxed);
+}
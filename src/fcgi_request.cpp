@@ -8,20 +8,39 @@
  */
 
 #include "cgimap/fcgi_request.hpp"
+#include "cgimap/coalescing_output_buffer.hpp"
 #include "cgimap/http.hpp"
 #include "cgimap/options.hpp"
 #include "cgimap/output_buffer.hpp"
 
 #include <fmt/core.h>
 
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 #include <fcgiapp.h>
+#include <sys/uio.h>
 #include <cerrno>
 #include <cstring>
 
 
 namespace {
+
+// FastCGI record layout, see section 3.3 of the FastCGI specification
+constexpr unsigned char FCGI_VERSION_1 = 1;
+constexpr unsigned char FCGI_STDOUT = 6;
+constexpr std::size_t FCGI_HEADER_LEN = 8;
+constexpr std::size_t FCGI_MAX_CONTENT_LEN = 65535;
+
+/**
+ * Writes the response body as FastCGI stdout records straight to the
+ * connection, with one writev() for many records, rather than through
+ * libfcgi's stream, which copies everything into an 8 KiB buffer and
+ * writes each one separately. The stream is still used to end the output,
+ * when the buffer is closed, and for anything written to it by libfcgi.
+ * Once the request is finished, libfcgi has freed the stream, and nothing
+ * more can be written.
+ */
 struct fcgi_buffer : public output_buffer {
 
   fcgi_buffer() = delete;
@@ -30,34 +49,136 @@ struct fcgi_buffer : public output_buffer {
   fcgi_buffer(fcgi_buffer&&) = delete;
   fcgi_buffer& operator=(fcgi_buffer&&) = delete;
 
-  explicit fcgi_buffer(FCGX_Request req) : m_req(req) {}
+  explicit fcgi_buffer(FCGX_Request &req) : m_req(req) {}
 
   ~fcgi_buffer() override = default;
 
   using output_buffer::write;
   int write(const char *buffer, int len) noexcept override {
-    int bytes = FCGX_PutStr(buffer, len, m_req.out);
-    if (bytes >= 0) {
-      m_written += bytes;
+    const std::array<std::string_view, 1> chunks{
+        std::string_view(buffer, len)};
+    return write_chunks(chunks);
+  }
+
+  int write_chunks(std::span<const std::string_view> chunks) noexcept override {
+    // anything buffered in the stream has to go first
+    if (m_req.out == nullptr || FCGX_FFlush(m_req.out) < 0)
+      return -1;
+
+    constexpr std::size_t MAX_RECORDS = 32;
+    std::array<std::array<unsigned char, FCGI_HEADER_LEN>, MAX_RECORDS> headers;
+    std::array<iovec, 4 * MAX_RECORDS> iov;
+
+    auto chunk = chunks.begin();
+    std::size_t offset = 0;
+    int total = 0;
+
+    while (chunk != chunks.end()) {
+      std::size_t n_records = 0;
+      std::size_t n_iov = 0;
+
+      // each record takes a header and the pieces of up to 65535 bytes
+      // of content, which may come from several chunks
+      while (chunk != chunks.end() && n_records < MAX_RECORDS &&
+             n_iov + 2 < iov.size()) {
+        const std::size_t header = n_iov++;
+        std::size_t len = 0;
+
+        while (chunk != chunks.end() && len < FCGI_MAX_CONTENT_LEN &&
+               n_iov < iov.size()) {
+          const auto n = std::min(chunk->size() - offset, FCGI_MAX_CONTENT_LEN - len);
+          if (n > 0) {
+            iov[n_iov++] = {const_cast<char *>(chunk->data() + offset), n};
+            len += n;
+            offset += n;
+          }
+          if (offset == chunk->size()) {
+            ++chunk;
+            offset = 0;
+          }
+        }
+
+        if (len == 0) {
+          // only empty chunks were left
+          --n_iov;
+          break;
+        }
+
+        auto &h = headers[n_records++];
+        h = {FCGI_VERSION_1, FCGI_STDOUT,
+             static_cast<unsigned char>((m_req.requestId >> 8) & 0xff),
+             static_cast<unsigned char>(m_req.requestId & 0xff),
+             static_cast<unsigned char>((len >> 8) & 0xff),
+             static_cast<unsigned char>(len & 0xff),
+             0, 0};
+        iov[header] = {h.data(), h.size()};
+        total += static_cast<int>(len);
+      }
+
+      if (n_iov > 0 && !write_all(iov.data(), static_cast<int>(n_iov)))
+        return -1;
     }
-    return bytes;
+
+    m_written += total;
+    return total;
   }
 
   [[nodiscard]] int written() const override { return m_written; }
 
-  int close() noexcept override { return FCGX_FClose(m_req.out); }
+  int close() noexcept override {
+    return m_req.out == nullptr ? 0 : FCGX_FClose(m_req.out);
+  }
+
+  int flush() noexcept override {
+    return m_req.out == nullptr ? 0 : FCGX_FFlush(m_req.out);
+  }
 
-  int flush() noexcept override { return FCGX_FFlush(m_req.out); }
+  [[nodiscard]] uint64_t syscalls() const { return m_syscalls; }
+
+  void reset() noexcept {
+    m_written = 0;
+    m_syscalls = 0;
+  }
 
 private:
-  FCGX_Request m_req;
+  bool write_all(iovec *iov, int count) noexcept {
+    while (count > 0) {
+      const auto n = ::writev(m_req.ipcFd, iov, count);
+      ++m_syscalls;
+
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+
+      // skip over what was written, which may end part way into a piece
+      auto left = static_cast<std::size_t>(n);
+      while (count > 0 && left >= iov->iov_len) {
+        left -= iov->iov_len;
+        ++iov;
+        --count;
+      }
+      if (count > 0) {
+        iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+        iov->iov_len -= left;
+      }
+    }
+    return true;
+  }
+
+  FCGX_Request &m_req;
   int m_written{0};
+  uint64_t m_syscalls{0};
 };
 }
 
 struct fcgi_request::pimpl {
   FCGX_Request req;
   std::chrono::system_clock::time_point now;
+  fcgi_buffer sink{req};
+  coalescing_output_buffer buffer{sink};
+  int header_bytes = 0;
 };
 
 fcgi_request::fcgi_request(int socket, const std::chrono::system_clock::time_point &now) : m_impl(std::make_unique<pimpl>()) {
@@ -69,7 +190,6 @@ fcgi_request::fcgi_request(int socket, const std::chrono::system_clock::time_poi
     throw std::runtime_error("Couldn't initialise FCGX request structure.");
   }
   m_impl->now = now;
-  m_buffer = std::make_unique<fcgi_buffer>(m_impl->req);
 }
 
 fcgi_request::~fcgi_request() { FCGX_Free(&m_impl->req, true); }
@@ -78,47 +198,13 @@ const char *fcgi_request::get_param(const char *key) const {
   return FCGX_GetParam(key, m_impl->req.envp);
 }
 
-std::string fcgi_request::get_payload() {
-
-  // fetch and parse the content length
-  const char *content_length_str = FCGX_GetParam("CONTENT_LENGTH", m_impl->req.envp);
-  const char *content_encoding = FCGX_GetParam("HTTP_CONTENT_ENCODING",  m_impl->req.envp);
-
-  auto content_encoding_handler = http::get_content_encoding_handler(
-         std::string_view(content_encoding == nullptr ? "" : content_encoding));
+std::string_view fcgi_request::read_body() {
+  const int len = FCGX_GetStr(content_buffer.data(), BUFFER_LEN, m_impl->req.in);
 
-  unsigned long content_length = 0;
-  unsigned long curr_content_length = 0;
-  unsigned long result_length = 0;
+  if (len <= 0)
+    return {};
 
-  if (content_length_str)
-    content_length = http::parse_content_length(content_length_str);
-
-  std::string result{};
-
-  while ((curr_content_length = FCGX_GetStr(content_buffer.data(), BUFFER_LEN, m_impl->req.in)) > 0)
-  {
-      std::string content(content_buffer.data(), curr_content_length);
-      result_length += content.length();
-
-      // Decompression according to Content-Encoding header (null op, if header is not set)
-      try {
-        std::string content_decompressed = content_encoding_handler->decompress(content);
-        result += content_decompressed;
-      } catch (std::bad_alloc& e) {
-	  throw http::server_error("Decompression failed due to memory issue");
-      } catch (std::runtime_error& e) {
-	  throw http::bad_request("Payload cannot be decompressed according to Content-Encoding");
-      }
-
-      if (result.length() > global_settings::get_payload_max_size())
-         throw http::payload_too_large(fmt::format("Payload exceeds limit of {:d} bytes", global_settings::get_payload_max_size()));
-  }
-
-  if (content_length > 0 && result_length != content_length)
-    throw http::server_error("HTTP Header field 'Content-Length' differs from actual payload length");
-
-  return result;
+  return {content_buffer.data(), static_cast<std::size_t>(len)};
 }
 
 std::chrono::system_clock::time_point fcgi_request::get_current_time() const {
@@ -130,16 +216,31 @@ void fcgi_request::set_current_time(const std::chrono::system_clock::time_point
 }
 
 void fcgi_request::write_header_info(int status, const http::headers_t &headers) {
-  m_buffer->write(http::format_header(status, headers));
+  // goes out together with the start of the body
+  m_impl->header_bytes = m_impl->buffer.write(http::format_header(status, headers));
 }
 
 output_buffer& fcgi_request::get_buffer_internal() {
-  return *m_buffer;
+  return m_impl->buffer;
 }
 
-void fcgi_request::finish_internal() {}
+request::output_stats fcgi_request::get_output_stats() const {
+  const auto body_bytes = std::max(m_impl->buffer.written() - m_impl->header_bytes, 0);
+  return {m_impl->buffer.writes(), m_impl->sink.syscalls(),
+          static_cast<uint64_t>(body_bytes)};
+}
+
+// sends whatever is still buffered and ends the request, so that the
+// client doesn't have to wait for the next one to be accepted.
+void fcgi_request::finish_internal() {
+  m_impl->buffer.drain();
+  FCGX_Finish_r(&m_impl->req);
+}
 
-void fcgi_request::dispose() { FCGX_Finish_r(&m_impl->req); }
+void fcgi_request::dispose() {
+  m_impl->buffer.drain();
+  FCGX_Finish_r(&m_impl->req);
+}
 
 int fcgi_request::accept_r() {
   int status = FCGX_Accept_r(&m_impl->req);
@@ -159,9 +260,10 @@ int fcgi_request::accept_r() {
   // reset status, as we re-use requests.
   reset();
 
-  // swap out the output buffer for a new one referencing the new
-  // request.
-  m_buffer = std::make_unique<fcgi_buffer>(m_impl->req);
+  // the output buffers are re-used for the new request.
+  m_impl->buffer.reset();
+  m_impl->sink.reset();
+  m_impl->header_bytes = 0;
 
   return status;
 }
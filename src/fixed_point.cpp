@@ -0,0 +1,107 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/fixed_point.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+#include <fmt/core.h>
+#include <fmt/compile.h>
+
+namespace {
+
+// coordinates are stored with 7 decimal places, so most doubles written
+// are the closest double to some integer / 10^7. below 2^29 such a double
+// is less than 0.5 * 10^-7 away from that value, so printing the integer
+// gives the same result as correctly rounding the double.
+bool to_fixed_point(double value, int64_t &scaled) {
+  if (!(std::abs(value) < 1'000'000.0))
+    return false;
+
+  scaled = std::llround(value * 10'000'000.0);
+
+  // negative zero is printed as "-0.0000000"
+  if (scaled == 0 && std::signbit(value))
+    return false;
+
+  return static_cast<double>(scaled) / 10'000'000.0 == value;
+}
+
+// writes the 7 decimal digits of a fraction of 10^7, including leading zeros
+char *write_fraction(char *ptr, uint64_t fraction) {
+  for (int i = 6; i >= 0; --i) {
+    ptr[i] = static_cast<char>('0' + fraction % 10);
+    fraction /= 10;
+  }
+  return ptr + 7;
+}
+
+// returns 10^7 / scale if scale is a power of ten up to 10^7, otherwise 0
+uint64_t fraction_multiplier(int64_t scale) {
+  uint64_t multiplier = 1;
+  for (int64_t s = 10'000'000; s >= 1; s /= 10, multiplier *= 10) {
+    if (s == scale)
+      return multiplier;
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+std::string_view format_fixed_point(fixed_point_buffer &buf, double value) {
+  int64_t scaled;
+
+  if (!to_fixed_point(value, scaled)) {
+    // anything else is formatted the slow way
+#if FMT_VERSION >= 90000
+    auto [end, n_written] = fmt::format_to_n(buf.begin(), buf.size(), FMT_COMPILE("{:.7f}"), value);
+#else
+    auto [end, n_written] = fmt::format_to_n(buf.begin(), buf.size(), "{:.7f}", value);
+#endif
+    return { buf.data(), n_written };
+  }
+
+  char *ptr = buf.data();
+
+  if (scaled < 0) {
+    *ptr++ = '-';
+    scaled = -scaled;
+  }
+
+  ptr = std::to_chars(ptr, buf.data() + buf.size(), scaled / 10'000'000).ptr;
+  *ptr++ = '.';
+  ptr = write_fraction(ptr, scaled % 10'000'000);
+
+  return { buf.data(), static_cast<std::size_t>(ptr - buf.data()) };
+}
+
+std::string_view format_fixed_point(fixed_point_buffer &buf, int64_t value, int64_t scale) {
+  const auto multiplier = fraction_multiplier(scale);
+
+  if (multiplier == 0)
+    return format_fixed_point(buf, static_cast<double>(value) / static_cast<double>(scale));
+
+  char *ptr = buf.data();
+
+  // the magnitude of INT64_MIN doesn't fit into an int64_t
+  uint64_t magnitude = static_cast<uint64_t>(value);
+  if (value < 0) {
+    *ptr++ = '-';
+    magnitude = 0 - magnitude;
+  }
+
+  const auto s = static_cast<uint64_t>(scale);
+  ptr = std::to_chars(ptr, buf.data() + buf.size(), magnitude / s).ptr;
+  *ptr++ = '.';
+  ptr = write_fraction(ptr, (magnitude % s) * multiplier);
+
+  return { buf.data(), static_cast<std::size_t>(ptr - buf.data()) };
+}
@@ -13,9 +13,13 @@
 #include <vector>
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iterator> // for distance
 #include <cctype>   // for toupper, isxdigit
 #include <cstdlib>
+#include <ctime>
 #include <ranges>
 #include <string_view>
 
@@ -73,6 +77,8 @@ const char *status_message(int code) {
   switch (code) {
   case 200:
     return "OK";
+  case 304:
+    return "Not Modified";
   case 400:
     return "Bad Request";
   case 401:
@@ -166,6 +172,7 @@ std::unique_ptr<encoding> choose_encoding(const std::string &accept_encoding) {
   float deflate_quality = 0.000;
   float gzip_quality = 0.000;
   float brotli_quality = 0.000;
+  float zstd_quality = 0.000;
 
   // set default if header empty
   if (encodings.empty())
@@ -202,6 +209,8 @@ std::unique_ptr<encoding> choose_encoding(const std::string &accept_encoding) {
       gzip_quality = quality;
     } else if (name == "br") {
       brotli_quality = quality;
+    } else if (name == "zstd") {
+      zstd_quality = quality;
     } else if (name == "*") {
       if (identity_quality == 0.000)
         identity_quality = quality;
@@ -211,9 +220,25 @@ std::unique_ptr<encoding> choose_encoding(const std::string &accept_encoding) {
         gzip_quality = quality;
       if (brotli_quality == 0.000)
         brotli_quality = quality;
+      if (zstd_quality == 0.000)
+        zstd_quality = quality;
     }
   }
 
+#if HAVE_ZSTD
+#if !HAVE_BROTLI
+  brotli_quality = 0.000;
+#endif
+  // zstd is preferred when the client doesn't mind, as it compresses about
+  // as well as brotli at a fraction of the CPU time.
+  if (zstd_quality > 0.0 && zstd_quality >= identity_quality &&
+      zstd_quality >= brotli_quality &&
+      zstd_quality >= deflate_quality &&
+      zstd_quality >= gzip_quality) {
+    return std::make_unique<zstd>();
+  }
+#endif
+
 #if HAVE_BROTLI
   if (brotli_quality > 0.0 && brotli_quality >= identity_quality &&
       brotli_quality >= deflate_quality &&
@@ -237,7 +262,7 @@ std::unique_ptr<encoding> choose_encoding(const std::string &accept_encoding) {
   }
 }
 
-std::unique_ptr<ZLibBaseDecompressor> get_content_encoding_handler(std::string_view content_encoding) {
+std::unique_ptr<Decompressor> get_content_encoding_handler(std::string_view content_encoding) {
 
   if (content_encoding.empty())
     return std::make_unique<IdentityDecompressor>();
@@ -249,11 +274,27 @@ std::unique_ptr<ZLibBaseDecompressor> get_content_encoding_handler(std::string_v
     return std::make_unique<GZipDecompressor>();
   else if (content_encoding == "deflate")
     return std::make_unique<ZLibDecompressor>();
-  throw http::unsupported_media_type("Supported Content-Encodings include 'gzip' and 'deflate'");
+#endif
+#if HAVE_BROTLI
+  else if (content_encoding == "br")
+    return std::make_unique<BrotliDecompressor>();
+#endif
+#if HAVE_ZSTD
+  else if (content_encoding == "zstd")
+    return std::make_unique<ZstdDecompressor>();
+#endif
 
-#else
-  throw http::unsupported_media_type("Supported Content-Encodings are 'identity'");
+  std::string supported = "'identity'";
+#ifdef HAVE_LIBZ
+  supported += ", 'gzip', 'deflate'";
+#endif
+#if HAVE_BROTLI
+  supported += ", 'br'";
+#endif
+#if HAVE_ZSTD
+  supported += ", 'zstd'";
 #endif
+  throw http::unsupported_media_type("Supported Content-Encodings are " + supported);
 }
 
 namespace {
@@ -310,4 +351,156 @@ unsigned long parse_content_length(const std::string &content_length_str) {
   return length;
 }
 
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+
+  // weak comparison ignores the weakness indicator on either tag
+  const auto opaque = [](std::string_view tag) {
+    if (tag.starts_with("W/"))
+      tag.remove_prefix(2);
+    return tag;
+  };
+
+  for (const auto part : std::views::split(if_none_match, ',')) {
+    auto tag = std::string_view(part.begin(), part.end());
+
+    const auto first = tag.find_first_not_of(" \t");
+    if (first == std::string_view::npos)
+      continue;
+    tag = tag.substr(first, tag.find_last_not_of(" \t") - first + 1);
+
+    if (tag == "*" || opaque(tag) == opaque(etag))
+      return true;
+  }
+  return false;
+}
+
+namespace {
+
+// the names of HTTP dates are always English, whatever the locale
+constexpr std::array<std::string_view, 7> DAY_NAMES = {
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+constexpr std::array<std::string_view, 12> MONTH_NAMES = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// the consume_* functions remove what they match from the front of s
+bool consume(std::string_view &s, std::string_view prefix) {
+  if (!s.starts_with(prefix))
+    return false;
+  s.remove_prefix(prefix.size());
+  return true;
+}
+
+bool consume_number(std::string_view &s, std::size_t digits, int &value) {
+  if (s.size() < digits)
+    return false;
+  value = 0;
+  for (std::size_t i = 0; i < digits; ++i) {
+    if (s[i] < '0' || s[i] > '9')
+      return false;
+    value = value * 10 + (s[i] - '0');
+  }
+  s.remove_prefix(digits);
+  return true;
+}
+
+bool consume_day_name(std::string_view &s, bool full) {
+  return std::ranges::any_of(DAY_NAMES, [&](std::string_view name) {
+    return consume(s, full ? name : name.substr(0, 3));
+  });
+}
+
+bool consume_month(std::string_view &s, int &month) {
+  for (std::size_t i = 0; i < MONTH_NAMES.size(); ++i) {
+    if (consume(s, MONTH_NAMES[i])) {
+      month = static_cast<int>(i) + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool consume_time(std::string_view &s, std::chrono::seconds &time) {
+  int hours = 0;
+  int minutes = 0;
+  int seconds = 0;
+  if (!(consume_number(s, 2, hours) && consume(s, ":") &&
+        consume_number(s, 2, minutes) && consume(s, ":") &&
+        consume_number(s, 2, seconds)))
+    return false;
+  if (hours > 23 || minutes > 59 || seconds > 60)
+    return false;
+  time = std::chrono::hours(hours) + std::chrono::minutes(minutes) +
+         std::chrono::seconds(seconds);
+  return true;
+}
+
+std::optional<std::chrono::system_clock::time_point>
+to_time_point(int year, int month, int day, std::chrono::seconds time) {
+  const std::chrono::year_month_day date{std::chrono::year(year),
+                                         std::chrono::month(month),
+                                         std::chrono::day(day)};
+  if (!date.ok())
+    return {};
+  return std::chrono::sys_days(date) + time;
+}
+
+} // anonymous namespace
+
+std::string format_http_date(std::chrono::system_clock::time_point t) {
+  const std::time_t time = std::chrono::system_clock::to_time_t(t);
+  std::tm tm{};
+  gmtime_r(&time, &tm);
+
+  // strftime would use the names of the locale
+  return fmt::format("{}, {:02d} {} {:04d} {:02d}:{:02d}:{:02d} GMT",
+                     DAY_NAMES[tm.tm_wday].substr(0, 3), tm.tm_mday,
+                     MONTH_NAMES[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour,
+                     tm.tm_min, tm.tm_sec);
+}
+
+std::optional<std::chrono::system_clock::time_point> parse_http_date(const std::string &s) {
+
+  // strptime would expect the names of the locale, so the three formats
+  // are parsed by hand.
+  int year = 0;
+  int month = 0;
+  int day = 0;
+  std::chrono::seconds time{};
+
+  // IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+  if (std::string_view rest = s;
+      consume_day_name(rest, false) && consume(rest, ", ") &&
+      consume_number(rest, 2, day) && consume(rest, " ") &&
+      consume_month(rest, month) && consume(rest, " ") &&
+      consume_number(rest, 4, year) && consume(rest, " ") &&
+      consume_time(rest, time) && rest == " GMT") {
+    return to_time_point(year, month, day, time);
+  }
+
+  // obsolete RFC 850 format, e.g. "Sunday, 06-Nov-94 08:49:37 GMT". two
+  // digit years are read like strptime's %y does.
+  if (std::string_view rest = s;
+      consume_day_name(rest, true) && consume(rest, ", ") &&
+      consume_number(rest, 2, day) && consume(rest, "-") &&
+      consume_month(rest, month) && consume(rest, "-") &&
+      consume_number(rest, 2, year) && consume(rest, " ") &&
+      consume_time(rest, time) && rest == " GMT") {
+    return to_time_point(year + (year < 69 ? 2000 : 1900), month, day, time);
+  }
+
+  // asctime format, e.g. "Sun Nov  6 08:49:37 1994"
+  if (std::string_view rest = s;
+      consume_day_name(rest, false) && consume(rest, " ") &&
+      consume_month(rest, month) && consume(rest, " ") &&
+      (consume(rest, " ") ? consume_number(rest, 1, day)
+                          : consume_number(rest, 2, day)) &&
+      consume(rest, " ") && consume_time(rest, time) &&
+      consume(rest, " ") && consume_number(rest, 4, year) && rest.empty()) {
+    return to_time_point(year, month, day, time);
+  }
+
+  return {};
+}
+
 } // namespace http
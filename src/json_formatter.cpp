@@ -8,6 +8,7 @@
  */
 
 #include "cgimap/json_formatter.hpp"
+#include "cgimap/options.hpp"
 
 #include <chrono>
 
@@ -137,6 +138,26 @@ void json_formatter::write_node(const element_info &elem, double lon,
   writer->end_object();
 }
 
+void json_formatter::write_node(const element_info &elem,
+                                const fixed_lonlat &lonlat, const tags_t &tags) {
+  writer->start_object();
+
+  writer->property("type", "node");
+
+  write_id(elem);
+  if (elem.visible) {
+    const auto scale = global_settings::get_scale();
+    writer->object_key("lat");
+    writer->entry(lonlat.lat, scale);
+    writer->object_key("lon");
+    writer->entry(lonlat.lon, scale);
+  }
+  write_common(elem);
+  write_tags(tags);
+
+  writer->end_object();
+}
+
 void json_formatter::write_way(const element_info &elem, const nodes_t &nodes,
                                const tags_t &tags) {
   writer->start_object();
@@ -7,133 +7,228 @@
  * For a full list of authors see the git log.
  */
 
-
-#include <cstdio>
-#include <cstring>
-#include <array>
-#include <fmt/core.h>
-#include <fmt/compile.h>
-
 #include "cgimap/json_writer.hpp"
+#include "cgimap/fixed_point.hpp"
+
+namespace {
+
+// control characters, quotes and backslashes need to be escaped. all
+// other bytes are copied unchanged, so valid UTF-8 stays valid UTF-8.
+constexpr std::array<bool, 256> escape_table = [] {
+  std::array<bool, 256> table{};
+  for (int c = 0; c < 0x20; ++c)
+    table[c] = true;
+  table['"'] = true;
+  table['\\'] = true;
+  return table;
+}();
+
+void append_escaped(std::string &buffer, char c) {
+  switch (c) {
+  case '\r': buffer += "\\r"; break;
+  case '\n': buffer += "\\n"; break;
+  case '\\': buffer += "\\\\"; break;
+  case '"': buffer += "\\\""; break;
+  case '\f': buffer += "\\f"; break;
+  case '\b': buffer += "\\b"; break;
+  case '\t': buffer += "\\t"; break;
+  default: {
+    constexpr std::string_view hex = "0123456789ABCDEF";
+    const auto u = static_cast<unsigned char>(c);
+    buffer += "\\u00";
+    buffer += hex[u >> 4];
+    buffer += hex[u & 0x0f];
+  }
+  }
+}
 
+} // anonymous namespace
 
 json_writer::json_writer(output_buffer &out, bool indent)
-    : out(out) {
-
-  gen = yajl_gen_alloc(nullptr);
-
-  if (gen == nullptr) {
-    throw std::runtime_error("error creating json writer.");
-  }
+    : out(out), indent(indent) {
 
-  if (indent) {
-    yajl_gen_config(gen, yajl_gen_beautify, 1);
-    yajl_gen_config(gen, yajl_gen_indent_string, " ");
-  } else {
-    yajl_gen_config(gen, yajl_gen_beautify, 0);
-    yajl_gen_config(gen, yajl_gen_indent_string, "");
-  }
+  buffer.reserve(BUFFER_SIZE + 4096);
+  states.reserve(16);
+  states.push_back(state::start);
 }
 
 json_writer::~json_writer() noexcept {
 
   try {
-    // there should be nothing left to do, except clearing the yajl buffer
-    output_yajl_buffer(true);
+    // there should be nothing left to do, except writing the buffer
+    write_buffer();
   } catch (...) {
     // ignore
   }
 
-  yajl_gen_free(gen);
   out.close();
 }
 
-void json_writer::start_object() {
-  yajl_gen_map_open(gen);
+// invalid calls, such as a value where a key is expected or anything after
+// the document is complete, are ignored, as they were by yajl.
+bool json_writer::begin_value(bool is_string) {
+  const auto s = states.back();
+
+  if (s == state::complete)
+    return false;
+
+  if (!is_string && (s == state::map_start || s == state::map_key))
+    return false;
+
+  // separator
+  if (s == state::map_key || s == state::in_array) {
+    buffer += ',';
+    if (indent)
+      buffer += '\n';
+  } else if (s == state::map_val) {
+    buffer += ':';
+    if (indent)
+      buffer += ' ';
+  }
+
+  // indentation, one space per level
+  if (indent && s != state::map_val)
+    buffer.append(states.size() - 1, ' ');
+
+  return true;
 }
 
-void json_writer::object_key(std::string_view sv) {
-  entry(sv);
+void json_writer::end_value() {
+  auto &s = states.back();
+
+  switch (s) {
+  case state::start:
+    s = state::complete;
+    break;
+  case state::map_start:
+  case state::map_key:
+    s = state::map_val;
+    break;
+  case state::array_start:
+    s = state::in_array;
+    break;
+  case state::map_val:
+    s = state::map_key;
+    break;
+  default:
+    break;
+  }
+
+  // a complete document ends with a newline when indenting
+  if (indent && s == state::complete)
+    buffer += '\n';
 }
 
-void json_writer::end_object() {
-  yajl_gen_map_close(gen);
-  output_yajl_buffer(false);
+void json_writer::open(state s, char c) {
+  if (!begin_value(false))
+    return;
+
+  states.push_back(s);
+  buffer += c;
+  if (indent)
+    buffer += '\n';
 }
 
-void json_writer::entry(bool b) {
-  yajl_gen_bool(gen, b ? 1 : 0);
+void json_writer::close(char c) {
+  if (states.size() <= 1)
+    return;
+
+  states.pop_back();
+  if (indent) {
+    buffer += '\n';
+    buffer.append(states.size() - 1, ' ');
+  }
+  buffer += c;
+
+  // the closed container is a value of the enclosing one
+  end_value();
+
+  if (buffer.size() >= BUFFER_SIZE)
+    write_buffer();
 }
 
-void json_writer::entry(double d) {
-  const char* str = nullptr;
-  size_t len = 0;
-
-#if FMT_VERSION >= 90000
-  std::array<char, 384> buf;
-  constexpr size_t max_chars = buf.size() - 1;
-  auto [end, n_written] = fmt::format_to_n(buf.begin(), max_chars, FMT_COMPILE("{:.7f}"), d);
-  if (n_written > max_chars)
-    throw write_error("cannot convert double-precision attribute to string.");
-  *end = '\0'; // Null terminate string
-  str = buf.data();
-  len = n_written;
-#else
-  auto s = fmt::format("{:.7f}", d);
-  str = s.c_str();
-  len = s.length();
-#endif
-
-  yajl_gen_number(gen, str, len);
+void json_writer::start_object() {
+  open(state::map_start, '{');
+}
+
+void json_writer::object_key(std::string_view sv) {
+  write_string(sv);
+}
+
+void json_writer::end_object() {
+  close('}');
 }
 
 void json_writer::start_array() {
-  yajl_gen_array_open(gen);
+  open(state::array_start, '[');
 }
 
 void json_writer::end_array() {
-  yajl_gen_array_close(gen);
-  output_yajl_buffer(false);
+  close(']');
 }
 
-void json_writer::flush() {
-  output_yajl_buffer(true);
+void json_writer::entry(bool b) {
+  write_number(b ? "true" : "false");
 }
 
-void json_writer::error(const std::string &s) {
-  start_object();
-  property("error", s);
-  end_object();
+void json_writer::entry(double d) {
+  fixed_point_buffer buf;
+  write_number(format_fixed_point(buf, d));
+}
 
-  output_yajl_buffer(true);
+void json_writer::entry(int64_t value, int64_t scale) {
+  fixed_point_buffer buf;
+  write_number(format_fixed_point(buf, value, scale));
 }
 
-void json_writer::output_yajl_buffer(bool ignore_buffer_size)
-{
-  const unsigned char *yajl_buf = nullptr;
-  size_t yajl_buf_len = 0;
+void json_writer::write_number(std::string_view number) {
+  if (!begin_value(false))
+    return;
 
-  if (yajl_gen_get_buf(gen, &yajl_buf, &yajl_buf_len) != yajl_gen_status_ok)
-    throw output_writer::write_error("Expected yajl_gen_status_ok");
+  buffer += number;
+  end_value();
+}
 
-  // Keep adding more JSON elements, if the yajl buffer size hasn't
-  // reached our threshold value yet.
-  // Setting ignore_buffer_size to true will skip this check.
-  if (!ignore_buffer_size && yajl_buf_len < MAX_BUFFER)
+void json_writer::write_string(std::string_view s) {
+  if (!begin_value(true))
     return;
 
-  // empty yajl buffer -> don't send anything to out
-  if (yajl_buf_len != 0) {
+  buffer += '"';
 
-    // Write yajl buffer to output
-    int wrote_len = out.write((const char*) yajl_buf, yajl_buf_len);
-
-    if (wrote_len != int(yajl_buf_len)) {
-      throw output_writer::write_error(
-          "Output buffer wrote a different amount than was expected.");
+  auto run_start = s.begin();
+  for (auto it = s.begin(); it != s.end(); ++it) {
+    if (escape_table[static_cast<unsigned char>(*it)]) {
+      buffer.append(run_start, it);
+      append_escaped(buffer, *it);
+      run_start = it + 1;
     }
   }
+  buffer.append(run_start, s.end());
+
+  buffer += '"';
+  end_value();
+}
+
+void json_writer::write_buffer() {
+  if (buffer.empty())
+    return;
+
+  if (out.write(buffer.data(), buffer.size()) != int(buffer.size())) {
+    throw output_writer::write_error(
+        "Output buffer wrote a different amount than was expected.");
+  }
+
+  buffer.clear();
+}
+
+void json_writer::flush() {
+  write_buffer();
+}
+
+void json_writer::error(const std::string &s) {
+  start_object();
+  property("error", s);
+  end_object();
 
-  // clear YAJL internal buffer
-  yajl_gen_clear(gen);
+  write_buffer();
 }
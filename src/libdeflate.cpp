@@ -0,0 +1,103 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#if HAVE_LIBDEFLATE
+
+#include "cgimap/libdeflate.hpp"
+#include "cgimap/logger.hpp"
+
+#include <vector>
+
+#include <fmt/core.h>
+#include <libdeflate.h>
+
+libdeflate_output_buffer::libdeflate_output_buffer(output_buffer& o,
+                                                   zlib_output_buffer::mode m,
+                                                   int level, int zlib_level)
+    : out(o), mode(m), level(level), zlib_level(zlib_level) {}
+
+int libdeflate_output_buffer::write(const char *buffer, int len) noexcept {
+  if (len < 0)
+    return -1;
+
+  if (streaming) {
+    const int rc = streaming->write(buffer, len);
+    if (rc > 0)
+      bytes_in += rc;
+    return rc;
+  }
+
+  try {
+    pending.append(buffer, len);
+
+    if (pending.size() > BUFFER_LIMIT) {
+      streaming = std::make_unique<zlib_output_buffer>(out, mode, zlib_level);
+      if (streaming->write(pending) < 0)
+        return -1;
+      std::string().swap(pending);
+    }
+  } catch (const std::exception &e) {
+    logger::message(fmt::format("libdeflate buffering failed: {}", e.what()));
+    return -1;
+  }
+
+  bytes_in += len;
+  return len;
+}
+
+int libdeflate_output_buffer::written() const { return bytes_in; }
+
+int libdeflate_output_buffer::close() noexcept {
+  if (streaming)
+    return streaming->close();
+
+  auto *compressor = libdeflate_alloc_compressor(level);
+  if (compressor == nullptr) {
+    logger::message("libdeflate_alloc_compressor failed");
+    return -1;
+  }
+
+  std::size_t size = 0;
+
+  try {
+    const bool gzip = (mode == zlib_output_buffer::mode::gzip);
+
+    std::vector<char> compressed(
+        gzip ? libdeflate_gzip_compress_bound(compressor, pending.size())
+             : libdeflate_zlib_compress_bound(compressor, pending.size()));
+
+    size = gzip ? libdeflate_gzip_compress(compressor, pending.data(), pending.size(),
+                                           compressed.data(), compressed.size())
+                : libdeflate_zlib_compress(compressor, pending.data(), pending.size(),
+                                           compressed.data(), compressed.size());
+
+    if (size > 0 && out.write(compressed.data(), size) < 0)
+      size = 0;
+
+  } catch (const std::exception &e) {
+    logger::message(fmt::format("libdeflate compression failed: {}", e.what()));
+  }
+
+  libdeflate_free_compressor(compressor);
+
+  if (size == 0)
+    return -1;
+
+  return out.close();
+}
+
+int libdeflate_output_buffer::flush() noexcept {
+  // nothing can be written before the whole response is known
+  if (streaming)
+    return streaming->flush();
+
+  return 0;
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <unistd.h>
 #include <memory>
+#include <mutex>
 
 #include "cgimap/logger.hpp"
 
@@ -20,8 +21,11 @@ namespace logger {
 
 static std::unique_ptr<std::ostream> stream;
 static pid_t pid;
+// guards the stream, which is shared by all worker threads.
+static std::mutex stream_mutex;
 
 void initialise(const std::string &filename) {
+  std::scoped_lock lock(stream_mutex);
   if (filename.empty()) {
     stream.reset();
     return;
@@ -31,9 +35,11 @@ void initialise(const std::string &filename) {
 }
 
 void message(std::string_view m) noexcept {
+  std::scoped_lock lock(stream_mutex);
   if (stream) {
     time_t now = time(nullptr);
-    *stream << "[" << std::put_time( std::gmtime( &now ), "%FT%T") << " #" << pid << "] " << m
+    struct tm tm{};
+    *stream << "[" << std::put_time( gmtime_r( &now, &tm ), "%FT%T") << " #" << pid << "] " << m
             << std::endl;
   }
 }
@@ -21,12 +21,23 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <ctime>
 #include <atomic>
 
+#include <libxml/parser.h>
+
 using namespace std::chrono_literals;
 
 #include "cgimap/logger.hpp"
@@ -35,7 +46,9 @@ using namespace std::chrono_literals;
 #include "cgimap/backend.hpp"
 #include "cgimap/fcgi_request.hpp"
 #include "cgimap/options.hpp"
+#include "cgimap/parallel_compression.hpp"
 #include "cgimap/process_request.hpp"
+#include "cgimap/response_cache.hpp"
 #include "cgimap/backend/apidb/apidb.hpp"
 
 
@@ -52,7 +65,77 @@ static std::atomic<bool> reload_requested = false;
 static_assert(std::atomic<bool>::is_always_lock_free);
 
 constexpr auto MIN_CHILD_RUNTIME_MS = 1000ms;
-constexpr int SOCKET_BACKLOG = 5;
+constexpr auto WORKER_WAKEUP_INTERVAL = 100ms;
+constexpr int DEFAULT_SOCKET_BACKLOG = 5;
+
+// adaptive mode: how often the supervisor re-evaluates the number of
+// children, and how long a child must have been idle before it may be
+// retired.
+constexpr auto SUPERVISOR_INTERVAL = 200ms;
+constexpr auto CHILD_IDLE_TIMEOUT = 30s;
+
+// adaptive mode: bounds of the delay before spawning again after a child
+// failed, and how long a child spawned since must run before it's reset.
+constexpr auto SPAWN_BACKOFF_MIN = 1s;
+constexpr auto SPAWN_BACKOFF_MAX = 60s;
+constexpr auto SPAWN_BACKOFF_RESET = 10s;
+
+/**
+ * per-child state shared between a child and the supervisor in adaptive
+ * mode. the slots live in an anonymous shared mapping which is set up
+ * before any children are forked.
+ */
+struct child_slot {
+  std::atomic<pid_t> pid{0};
+  // number of requests currently being processed by the child
+  std::atomic<int> busy{0};
+  // steady clock time (in ms) the child last finished a request
+  std::atomic<int64_t> last_active{0};
+  // set by the supervisor once the child has been asked to exit
+  std::atomic<bool> retiring{false};
+  // steady clock time (in ms) the child was spawned, supervisor only
+  int64_t started{0};
+};
+
+static_assert(std::atomic<pid_t>::is_always_lock_free);
+static_assert(std::atomic<int>::is_always_lock_free);
+static_assert(std::atomic<int64_t>::is_always_lock_free);
+
+/**
+ * slot of the current child process, or nullptr if the supervisor
+ * isn't tracking it.
+ */
+static child_slot *current_slot = nullptr;
+
+int64_t steady_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * marks the current child as busy while a request is being processed.
+ */
+class busy_marker {
+public:
+  explicit busy_marker(child_slot *slot) : m_slot(slot) {
+    if (m_slot) {
+      ++m_slot->busy;
+    }
+  }
+
+  ~busy_marker() {
+    if (m_slot) {
+      m_slot->last_active = steady_now_ms();
+      --m_slot->busy;
+    }
+  }
+
+  busy_marker(const busy_marker &) = delete;
+  busy_marker& operator=(const busy_marker &) = delete;
+
+private:
+  child_slot *m_slot;
+};
 
 /**
  * SIGTERM handler.
@@ -70,6 +153,12 @@ void reload(int) {
   reload_requested = true;
 }
 
+/**
+ * SIGUSR1 handler. Doesn't do anything itself, it's only used to interrupt
+ * worker threads blocked in accept() when shutting down.
+ */
+void wakeup(int) {}
+
 #if __APPLE__
   #ifndef HOST_NAME_MAX
     #define HOST_NAME_MAX 255
@@ -131,15 +220,22 @@ void get_options(int argc, char **argv, po::variables_map &options) {
     ("help", "display this help and exit")
     ("daemon", "run as a daemon")
     ("instances", po::value<int>()->default_value(5), "number of daemon instances to run")
+    ("threads", po::value<int>()->default_value(1), "number of worker threads per instance")
+    ("compression-threads", po::value<int>()->default_value(0), "number of threads per instance for compressing large responses in parallel, 0 to disable")
+    ("min-instances", po::value<int>(), "minimum number of daemon instances in adaptive mode")
+    ("max-instances", po::value<int>(), "maximum number of daemon instances, enables adaptive mode")
     ("pidfile", po::value<std::string>(), "file to write pid to")
     ("logfile", po::value<std::string>(), "file to write log messages to")
     ("memcache", po::value<std::string>(), "memcache server specification")
+    ("response-cache-size", po::value<int>()->default_value(0), "size of the in-process cache of historic element responses (in MB), 0 to disable")
+    ("response-cache-memcache", "also keep historic element responses in memcached")
     ("ratelimit", po::value<long>(), "average number of bytes/s to allow each client")
     ("moderator-ratelimit", po::value<long>(), "average number of bytes/s to allow each moderator")
     ("maxdebt", po::value<long>(), "maximum debt (in Mb) to allow each client before rate limiting")
     ("moderator-maxdebt", po::value<long>(), "maximum debt (in Mb) to allow each moderator before rate limiting")
     ("port", po::value<int>(), "FCGI port number (e.g. 8000) to listen on. This option is for backwards compatibility, please use --socket for new configurations.")
     ("socket", po::value<std::string>(), "FCGI socket (e.g. :8000, or 127.0.0.1:8000) or UNIX domain socket to listen on")
+    ("backlog", po::value<int>()->default_value(DEFAULT_SOCKET_BACKLOG), "maximum length of the queue of pending connections on the FCGI socket")
     ("configfile", po::value<std::string>(), "Config file")
     ;
   // clang-format on
@@ -198,59 +294,266 @@ void get_options(int argc, char **argv, po::variables_map &options) {
 }
 
 /**
- * loop processing fasctgi requests until are asked to stop by
- * somebody sending us a TERM signal.
+ * everything a request processing loop needs which can't be shared
+ * between threads: each worker has its own FCGI request, rate limiter
+ * and response cache connections and database connections (and therefore
+ * its own set of prepared statements).
  */
-void process_requests(int socket, const po::variables_map &options) {
-  // generator string - identifies the cgimap instance.
-  auto generator = get_generator_string();
-  // open any log file
-  if (options.contains("logfile")) {
-    logger::initialise(options["logfile"].as<std::string>());
-  }
+struct request_worker {
+  request_worker(int socket, const po::variables_map &options)
+    : limiter(options),
+      cache(options),
+      req(socket, std::chrono::system_clock::time_point()),
+      factory(create_backend(options)),
+      update_factory(create_update_backend(options)) {}
 
   // create the rate limiter
-  memcached_rate_limiter limiter(options);
+  memcached_rate_limiter limiter;
+
+  // create the response cache, the in-memory part of which is shared
+  response_cache cache;
 
   // create the routes map (from URIs to handlers)
   routes route;
 
   // create the request object (persists over several calls)
-  fcgi_request req(socket, std::chrono::system_clock::time_point());
+  fcgi_request req;
 
   // create a factory for data selections - the mechanism for actually
   // getting at data.
-  auto factory = create_backend(options);
-  auto update_factory = create_update_backend(options);
+  std::unique_ptr<data_selection::factory> factory;
+  std::unique_ptr<data_update::factory> update_factory;
+
+  void process(const std::string &generator) {
+    const auto now(std::chrono::system_clock::now());
+    req.set_current_time(now);
+    const busy_marker marker(current_slot);
+    try {
+      process_request(req, limiter, generator, route, *factory, update_factory.get(),
+                      &cache);
+    } catch (...) {
+      // Attempt to properly finish up FCGI request (so that clients will see the error message)
+      req.dispose();
+      throw;
+    }
+  }
+};
+
+void reopen_logfile(const po::variables_map &options) {
+  if (options.contains("logfile")) {
+    logger::initialise(options["logfile"].as<std::string>());
+  }
+}
+
+/**
+ * loop processing fasctgi requests until are asked to stop by
+ * somebody sending us a TERM signal.
+ */
+void process_requests_single(int socket, const po::variables_map &options,
+                             const std::string &generator) {
+
+  request_worker worker(socket, options);
+
+  // SIGTERM and SIGHUP are only let through while waiting for a request:
+  // libfcgi doesn't retry interrupted reads and writes, so a signal
+  // arriving during a request would cut it short. one which arrives in
+  // the meantime is delivered as soon as they're unblocked again.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGHUP);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
 
   logger::message("Initialised");
 
-  // enter the main loop
-  while (!terminate_requested) {
+  // enter the main loop, until asked to stop or retired by the supervisor
+  while (!terminate_requested && !(current_slot && current_slot->retiring)) {
     // process any reload request
     if (reload_requested) {
-      if (options.contains("logfile")) {
-        logger::initialise(options["logfile"].as<std::string>());
-      }
+      reopen_logfile(options);
       reload_requested = false;
     }
 
     // get the next request
-    if (req.accept_r() >= 0) {
-      const auto now(std::chrono::system_clock::now());
-      req.set_current_time(now);
+    sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+    const int status = (terminate_requested || reload_requested) ? -1 : worker.req.accept_r();
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+
+    if (status >= 0) {
+      worker.process(generator);
+    }
+  }
+
+  // finish up - dispose of the resources
+  worker.req.dispose();
+}
+
+/**
+ * loop run by each worker thread. accept() calls are serialised, as
+ * some platforms don't allow several threads to accept on the same
+ * socket concurrently (see also libfcgi's threaded.c example).
+ * accepting is set while the worker waits for a new request, which is
+ * the only time it may be interrupted by SIGUSR1. it is cleared under
+ * wakeup_mutex, which the main thread holds while signalling, so no
+ * signal can be sent once the worker has started on a request.
+ */
+void worker_thread(request_worker &worker, const std::string &generator,
+                   std::mutex &accept_mutex, std::mutex &wakeup_mutex,
+                   std::atomic<bool> &accepting) {
+
+  // SIGUSR1 is blocked in the main thread, but needs to get through
+  // to interrupt a worker waiting for new requests.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+
+  while (!terminate_requested) {
+    int status = -1;
+    {
+      std::scoped_lock lock(accept_mutex);
+      if (terminate_requested) {
+        break;
+      }
+      accepting = true;
+      status = worker.req.accept_r();
+
+      std::scoped_lock wakeup_lock(wakeup_mutex);
+      accepting = false;
+    }
+
+    if (status >= 0) {
+      worker.process(generator);
+
+      // finish the request here rather than in the next accept_r(), which
+      // may have to wait for another worker to get a new request first.
+      worker.req.dispose();
+    }
+  }
+
+  worker.req.dispose();
+}
+
+/**
+ * run several worker threads in this process, each handling one
+ * request at a time. the main thread only waits for signals and
+ * handles log file reloads and shutdown.
+ */
+void process_requests_threaded(int socket, const po::variables_map &options,
+                               const std::string &generator, int threads) {
+
+  // libxml2 global state must be set up before any thread uses it.
+  xmlInitParser();
+
+  struct sigaction sa{};
+  sa.sa_handler = wakeup;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = 0;
+  if (sigaction(SIGUSR1, &sa, nullptr) < 0) {
+    throw std::runtime_error("sigaction failed");
+  }
+
+  // workers are created sequentially on the main thread, as neither
+  // FCGX_Init nor the backend setup are thread-safe.
+  std::vector<std::unique_ptr<request_worker>> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(std::make_unique<request_worker>(socket, options));
+  }
+
+  // block the signals here so that they're inherited by the worker
+  // threads and only get delivered to the main thread in sigsuspend().
+  sigset_t blocked;
+  sigset_t orig_mask;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGTERM);
+  sigaddset(&blocked, SIGHUP);
+  sigaddset(&blocked, SIGUSR1);
+  if (pthread_sigmask(SIG_BLOCK, &blocked, &orig_mask) != 0) {
+    throw std::runtime_error("pthread_sigmask failed");
+  }
+
+  logger::message(fmt::format("Initialised with {:d} worker threads", threads));
+
+  const pthread_t main_thread = pthread_self();
+  std::atomic<int> running = threads;
+  std::vector<std::atomic<bool>> accepting(threads);
+  std::mutex accept_mutex;
+  std::mutex wakeup_mutex;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  std::vector<std::thread> pool;
+  for (int i = 0; i < threads; ++i) {
+    pool.emplace_back([&, i, w = workers[i].get()]() {
       try {
-        process_request(req, limiter, generator, route, *factory, update_factory.get());
+        worker_thread(*w, generator, accept_mutex, wakeup_mutex, accepting[i]);
       } catch (...) {
-        // Attempt to properly finish up FCGI request (so that clients will see the error message)
-        req.dispose();
-        throw;
+        {
+          std::scoped_lock lock(error_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+        // bring the whole process down, same as an exception in the
+        // single threaded loop would.
+        terminate_requested = true;
+        pthread_kill(main_thread, SIGUSR1);
       }
+      --running;
+    });
+  }
+
+  while (!terminate_requested) {
+    sigsuspend(&orig_mask);
+
+    if (reload_requested) {
+      reopen_logfile(options);
+      reload_requested = false;
     }
   }
 
-  // finish up - dispose of the resources
-  req.dispose();
+  // keep poking the worker waiting in accept() until they have all left
+  // their loops: a single signal could arrive just before it enters
+  // accept(). workers busy with a request aren't interrupted, as libfcgi
+  // doesn't retry interrupted writes. holding wakeup_mutex ensures a
+  // worker can't leave accept() between the check and the signal.
+  while (running > 0) {
+    {
+      std::scoped_lock lock(wakeup_mutex);
+      for (int i = 0; i < threads; ++i) {
+        if (accepting[i]) {
+          pthread_kill(pool[i].native_handle(), SIGUSR1);
+        }
+      }
+    }
+    std::this_thread::sleep_for(WORKER_WAKEUP_INTERVAL);
+  }
+
+  for (auto &t : pool) {
+    t.join();
+  }
+
+  pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void process_requests(int socket, const po::variables_map &options) {
+  // generator string - identifies the cgimap instance.
+  auto generator = get_generator_string();
+  // open any log file
+  reopen_logfile(options);
+
+  // the pool is only started once needed, i.e. in the forked instance
+  set_compression_threads(options["compression-threads"].as<int>());
+
+  if (const int threads = options["threads"].as<int>(); threads > 1) {
+    process_requests_threaded(socket, options, generator, threads);
+  } else {
+    process_requests_single(socket, options, generator);
+  }
 }
 
 void install_signal_handlers() {
@@ -308,6 +611,33 @@ void validate_instances(const po::variables_map &options) {
   }
 }
 
+void validate_threads(const po::variables_map &options) {
+  int opt = options["threads"].as<int>();
+  if (opt <= 0) {
+      throw std::runtime_error("Number of threads must be strictly positive.");
+  }
+  else if (opt > 100) {
+      throw std::runtime_error("Number of threads must not exceed 100.");
+  }
+}
+
+void validate_compression_threads(const po::variables_map &options) {
+  int opt = options["compression-threads"].as<int>();
+  if (opt < 0) {
+      throw std::runtime_error("Number of compression threads must not be negative.");
+  }
+  else if (opt > 64) {
+      throw std::runtime_error("Number of compression threads must not exceed 64.");
+  }
+}
+
+void validate_response_cache_size(const po::variables_map &options) {
+  int opt = options["response-cache-size"].as<int>();
+  if (opt < 0) {
+      throw std::runtime_error("Response cache size must not be negative.");
+  }
+}
+
 void write_pidfile(const po::variables_map &options) {
   if (options.contains("pidfile")) {
       std::ofstream pidfile(options["pidfile"].as<std::string>().c_str());
@@ -366,8 +696,253 @@ void signal_children(const std::set<pid_t> &children, int signal) {
   }
 }
 
+/**
+ * returns the number of connections waiting to be accepted on a TCP
+ * listening socket, if the platform can tell us.
+ */
+std::optional<int> listen_queue_length(int socket) {
+#ifdef __linux__
+  struct tcp_info info{};
+  socklen_t len = sizeof(info);
+  // for listening sockets, tcpi_unacked is the current accept queue length
+  if (getsockopt(socket, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+      info.tcpi_state == TCP_LISTEN) {
+    return static_cast<int>(info.tcpi_unacked);
+  }
+#endif
+  return {};
+}
+
+void validate_adaptive_instances(int min_instances, int max_instances) {
+  if (min_instances <= 0) {
+      throw std::runtime_error("Minimum number of instances must be strictly positive.");
+  }
+  else if (max_instances > 100) {
+      throw std::runtime_error("Maximum number of instances must not exceed 100.");
+  }
+  else if (min_instances > max_instances) {
+      throw std::runtime_error("Minimum number of instances must not exceed maximum number of instances.");
+  }
+}
+
+/**
+ * anonymous shared memory holding one slot per potential child.
+ */
+class child_slots {
+public:
+  explicit child_slots(int count) : m_count(count) {
+    void *mem = mmap(nullptr, size(), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error("mmap failed.");
+    }
+    m_slots = static_cast<child_slot *>(mem);
+    for (int i = 0; i < m_count; ++i) {
+      new (&m_slots[i]) child_slot{};
+    }
+  }
+
+  ~child_slots() { munmap(m_slots, size()); }
+
+  child_slots(const child_slots &) = delete;
+  child_slots& operator=(const child_slots &) = delete;
+
+  child_slot *begin() const { return m_slots; }
+  child_slot *end() const { return m_slots + m_count; }
+
+  child_slot *find(pid_t pid) const {
+    auto it = std::find_if(begin(), end(), [pid](const child_slot &slot) { return slot.pid == pid; });
+    return it == end() ? nullptr : it;
+  }
+
+private:
+  size_t size() const { return sizeof(child_slot) * m_count; }
+
+  int m_count;
+  child_slot *m_slots;
+};
+
+/**
+ * delays spawning new children after one failed, doubling the delay on
+ * each failure, so that a child which keeps failing on startup isn't
+ * respawned on every supervisor tick. the delay is dropped once a child
+ * spawned after the last failure has kept running for a while.
+ */
+class spawn_backoff {
+public:
+  bool ready(int64_t now) const { return now >= m_next_spawn; }
+
+  void failed(int64_t now) {
+    m_delay = std::clamp(m_delay * 2, to_ms(SPAWN_BACKOFF_MIN), to_ms(SPAWN_BACKOFF_MAX));
+    m_next_spawn = now + m_delay;
+    m_last_failure = now;
+  }
+
+  void running(int64_t started, int64_t now) {
+    if (m_delay > 0 && started > m_last_failure &&
+        now - started >= to_ms(SPAWN_BACKOFF_RESET)) {
+      m_delay = 0;
+    }
+  }
+
+private:
+  template <typename T>
+  static int64_t to_ms(T d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  }
+
+  int64_t m_delay = 0;
+  int64_t m_next_spawn = 0;
+  int64_t m_last_failure = 0;
+};
+
+void spawn_tracked_child(int socket, const po::variables_map &options,
+                         std::set<pid_t> &children, const child_slots &slots) {
+  auto *slot = slots.find(0);
+  if (slot == nullptr) {
+    return;
+  }
+
+  slot->busy = 0;
+  slot->last_active = steady_now_ms();
+  slot->started = slot->last_active;
+  slot->retiring = false;
+
+  if (pid_t pid = fork(); pid < 0) {
+      throw std::runtime_error("fork failed.");
+  } else if (pid == 0) {
+      current_slot = slot;
+      handle_child_process(socket, options);
+  } else {
+      slot->pid = pid;
+      children.insert(pid);
+  }
+}
+
+void reap_tracked_children(std::set<pid_t> &children, const child_slots &slots,
+                           spawn_backoff &backoff) {
+  pid_t pid;
+  int status;
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    children.erase(pid);
+    if (auto *slot = slots.find(pid)) {
+      slot->pid = 0;
+    }
+    // retired or terminated children exit cleanly
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      backoff.failed(steady_now_ms());
+    }
+  }
+}
+
+/**
+ * fork a child when all workers are busy or connections are queueing
+ * up on the socket, and retire a child which has been idle for a while
+ * when there is enough spare capacity left without it.
+ *
+ * a retiring child exits by itself after its current request, and only
+ * lets SIGTERM through while it waits for the next one, so the signal
+ * is repeated on every tick until the child is gone: it may have been
+ * sent just before the child started waiting.
+ */
+void scale_children(int socket, const po::variables_map &options,
+                    std::set<pid_t> &children, const child_slots &slots,
+                    spawn_backoff &backoff,
+                    int min_instances, int max_instances, int threads) {
+
+  const auto now = steady_now_ms();
+  int active = 0;
+  int busy = 0;
+  child_slot *idlest = nullptr;
+
+  for (auto &slot : slots) {
+    if (slot.pid == 0) {
+      continue;
+    }
+    if (slot.retiring) {
+      kill(slot.pid, SIGTERM);
+      continue;
+    }
+    backoff.running(slot.started, now);
+    ++active;
+    busy += slot.busy;
+    if (slot.busy == 0 && (idlest == nullptr || slot.last_active < idlest->last_active)) {
+      idlest = &slot;
+    }
+  }
+
+  const int idle_workers = active * threads - busy;
+  const int queued = listen_queue_length(socket).value_or(0);
+
+  if (active < min_instances ||
+      (active < max_instances && (idle_workers <= 0 || queued > 0))) {
+    if (backoff.ready(now)) {
+      spawn_tracked_child(socket, options, children, slots);
+    }
+  }
+  else if (active > min_instances && queued == 0 &&
+           idle_workers > threads && idlest != nullptr &&
+           now - idlest->last_active >
+             std::chrono::duration_cast<std::chrono::milliseconds>(CHILD_IDLE_TIMEOUT).count()) {
+    idlest->retiring = true;
+    kill(idlest->pid, SIGTERM);
+  }
+}
+
+/**
+ * like daemon_mode, but the number of children follows the load between
+ * --min-instances and --max-instances.
+ */
+void adaptive_daemon_mode(const po::variables_map &options, int socket) {
+  const int max_instances = options["max-instances"].as<int>();
+  const int min_instances = options.contains("min-instances") ?
+                              options["min-instances"].as<int>() : 1;
+  const int threads = options["threads"].as<int>();
+
+  validate_adaptive_instances(min_instances, max_instances);
+  validate_threads(options);
+  validate_compression_threads(options);
+  validate_response_cache_size(options);
+
+  bool children_terminated = false;
+  std::set<pid_t> children;
+  child_slots slots(max_instances);
+  spawn_backoff backoff;
+
+  daemonise();
+  write_pidfile(options);
+
+  while (!terminate_requested) {
+      reap_tracked_children(children, slots, backoff);
+
+      if (reload_requested) {
+          signal_children(children, SIGHUP);
+          reload_requested = false;
+      }
+
+      scale_children(socket, options, children, slots, backoff, min_instances, max_instances, threads);
+
+      // interrupted early by SIGTERM or SIGHUP
+      struct timespec ts{0, std::chrono::duration_cast<std::chrono::nanoseconds>(SUPERVISOR_INTERVAL).count()};
+      nanosleep(&ts, nullptr);
+  }
+
+  while (!children.empty()) {
+      if (!children_terminated) {
+          signal_children(children, SIGTERM);
+          children_terminated = true;
+      }
+      wait_for_children(children);
+  }
+
+  remove_pidfile(options);
+}
+
 void daemon_mode(const po::variables_map &options, int socket) {
   validate_instances(options);
+  validate_threads(options);
+  validate_compression_threads(options);
+  validate_response_cache_size(options);
 
   const int instances = options["instances"].as<int>();
   bool children_terminated = false;
@@ -397,11 +972,16 @@ void daemon_mode(const po::variables_map &options, int socket) {
 
 void non_daemon_mode(const po::variables_map &options, int socket)
 {
-  if (options.contains("instances") && !options["instances"].defaulted()) {
-    std::cerr << "[WARN] The --instances parameter is ignored in non-daemon mode, running as single process only.\n"
+  if ((options.contains("instances") && !options["instances"].defaulted()) ||
+      options.contains("min-instances") || options.contains("max-instances")) {
+    std::cerr << "[WARN] The --instances, --min-instances and --max-instances parameters are ignored in non-daemon mode, running as single process only.\n"
                  "[WARN] If the process terminates, it must be restarted externally.\n";
   }
 
+  validate_threads(options);
+  validate_compression_threads(options);
+  validate_response_cache_size(options);
+
   install_signal_handlers();
 
   // record our pid if requested
@@ -416,8 +996,13 @@ void non_daemon_mode(const po::variables_map &options, int socket)
 
 int init_socket(const po::variables_map &options)
 {
+  const int backlog = options["backlog"].as<int>();
+  if (backlog <= 0) {
+    throw std::runtime_error("Socket backlog must be strictly positive.");
+  }
+
   if (options.contains("socket")) {
-    int socket = fcgi_request::open_socket(options["socket"].as<std::string>(), SOCKET_BACKLOG);
+    int socket = fcgi_request::open_socket(options["socket"].as<std::string>(), backlog);
     if (socket < 0) {
       throw std::runtime_error("Couldn't open FCGX socket.");
     }
@@ -427,7 +1012,7 @@ int init_socket(const po::variables_map &options)
   // fall back to the old --port option if socket isn't available.
   if (options.contains("port")) {
     auto sock_str = fmt::format(":{:d}", options["port"].as<int>());
-    int socket = fcgi_request::open_socket(sock_str, SOCKET_BACKLOG);
+    int socket = fcgi_request::open_socket(sock_str, backlog);
     if (socket < 0) {
       throw std::runtime_error("Couldn't open FCGX socket (from port).");
     }
@@ -457,7 +1042,9 @@ int main(int argc, char **argv) {
     auto socket = init_socket(options);
 
     // are we supposed to run as a daemon?
-    if (options.contains("daemon")) {
+    if (options.contains("daemon") && options.contains("max-instances")) {
+      adaptive_daemon_mode(options, socket);
+    } else if (options.contains("daemon")) {
       daemon_mode(options, socket);
     } else {
       non_daemon_mode(options, socket);
@@ -21,6 +21,8 @@ std::string to_string(type t) {
     return "application/xml";
   } else if (mime::type::application_json == t) {
     return "application/json";
+  } else if (mime::type::application_x_protobuf == t) {
+    return "application/x-protobuf";
   } else {
     throw std::runtime_error("No string conversion for unspecified MIME type.");
   }
@@ -42,6 +44,8 @@ type parse_from(std::string_view name) {
     return mime::type::application_xml;
   } else if (name == "application/json") {
     return mime::type::application_json;
+  } else if (name == "application/x-protobuf") {
+    return mime::type::application_x_protobuf;
   }
 
   return mime::type::unspecified_type;
@@ -57,24 +57,24 @@ namespace oauth2 {
     if (has_forbidden_char(bearer_token))
       return std::nullopt;
 
-    bool expired{true};
-    bool revoked{true};
+    // Check token as plain text and sha256-hashed token. This also fetches
+    // the user's roles and status, which are needed later on.
+    const auto details = selection.get_oauth2_user_details(bearer_token);
 
-    // Check token as plain text and sha256-hashed token
-    auto user_id = selection.get_user_id_for_oauth2_token(bearer_token, expired, revoked, allow_api_write);
-
-    if (!(user_id)) {
+    if (!(details.user_id)) {
       throw http::unauthorized("invalid_token");
     }
 
-    if (expired) {
+    if (details.expired) {
       throw http::unauthorized("token_expired");
     }
 
-    if (revoked) {
+    if (details.revoked) {
       throw http::unauthorized("token_revoked");
     }
 
-    return user_id;
+    allow_api_write = details.allow_api_write;
+
+    return details.user_id;
   }
 }
@@ -21,6 +21,19 @@ osm_current_responder::osm_current_responder(mime::type mt,
     : osm_responder(mt, b),
       sel(s) {}
 
+std::vector<mime::type> osm_current_responder::types_available() const {
+  return {mime::type::application_xml, mime::type::application_json,
+          mime::type::application_x_protobuf};
+}
+
+std::optional<data_selection::selection_version> osm_current_responder::version() const {
+  return sel.get_selection_version();
+}
+
+bool osm_current_responder::write_failed() const {
+  return failed;
+}
+
 
 void osm_current_responder::write(output_formatter& fmt,
                                   const std::string &generator,
@@ -28,6 +41,7 @@ void osm_current_responder::write(output_formatter& fmt,
 
 
   try {
+    fmt.set_historical(historical);
     fmt.start_document(generator, "osm");
     if (bounds) {
       fmt.write_bounds(*bounds);
@@ -41,6 +55,7 @@ void osm_current_responder::write(output_formatter& fmt,
   } catch (const std::exception &e) {
     logger::message(fmt::format("Caught error in osm_current_responder: {}",
                       e.what()));
+    failed = true;
     fmt.error(e);
   }
   fmt.end_element();
@@ -8,9 +8,11 @@
  */
 
 #include "cgimap/logger.hpp"
+#include "cgimap/options.hpp"
 #include "cgimap/osmchange_responder.hpp"
 
 #include <chrono>
+#include <cmath>
 #include <fmt/core.h>
 #include <algorithm>
 
@@ -18,17 +20,12 @@
 namespace {
 
 struct element {
-  struct lonlat {
-    double m_lon;
-    double m_lat;
-  };
-
   element_type m_type;
   element_info m_info;
   tags_t m_tags;
 
   // only one of these will be non-empty depending on m_type
-  lonlat m_lonlat;
+  fixed_lonlat m_lonlat;
   nodes_t m_nds;
   members_t m_members;
 };
@@ -103,10 +100,22 @@ struct sorting_formatter : public output_formatter {
     double lon, double lat,
     const tags_t &tags) override {
 
+    const auto scale = global_settings::get_scale();
+    write_node(elem,
+               fixed_lonlat{ .lon = std::llround(lon * scale),
+                             .lat = std::llround(lat * scale) },
+               tags);
+  }
+
+  void write_node(
+    const element_info &elem,
+    const fixed_lonlat &lonlat,
+    const tags_t &tags) override {
+
     element node{ .m_type = element_type::node,
                   .m_info = elem,
                   .m_tags = tags,
-                  .m_lonlat = element::lonlat{ .m_lon = lon, .m_lat = lat },
+                  .m_lonlat = lonlat,
                   .m_nds = nodes_t(),
                   .m_members = members_t() };
 
@@ -121,7 +130,7 @@ struct sorting_formatter : public output_formatter {
     element way{ .m_type = element_type::way,
                  .m_info = elem,
                  .m_tags = tags,
-                 .m_lonlat = element::lonlat{},
+                 .m_lonlat = fixed_lonlat{},
                  .m_nds = nodes,
                  .m_members = members_t() };
 
@@ -136,7 +145,7 @@ struct sorting_formatter : public output_formatter {
     element rel{ .m_type = element_type::relation,
                  .m_info = elem,
                  .m_tags = tags,
-                 .m_lonlat = element::lonlat{},
+                 .m_lonlat = fixed_lonlat{},
                  .m_nds = nodes_t(),
                  .m_members = members };
 
@@ -219,7 +228,7 @@ private:
   void write_element(const element &e, output_formatter &fmt) {
     switch (e.m_type) {
     case element_type::node:
-      fmt.write_node(e.m_info, e.m_lonlat.m_lon, e.m_lonlat.m_lat, e.m_tags);
+      fmt.write_node(e.m_info, e.m_lonlat, e.m_tags);
       break;
     case element_type::way:
       fmt.write_way(e.m_info, e.m_nds, e.m_tags);
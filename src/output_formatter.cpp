@@ -70,3 +70,9 @@ member_info::member_info(element_type type, osm_nwr_id_t ref, std::string role)
     ref(ref),
     role(std::move(role))
 {}
+
+void output_formatter::write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                                  const tags_t &tags) {
+  const auto scale = static_cast<double>(global_settings::get_scale());
+  write_node(elem, lonlat.lon / scale, lonlat.lat / scale, tags);
+}
@@ -0,0 +1,331 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/parallel_compression.hpp"
+#include "cgimap/logger.hpp"
+#include "cgimap/output_writer.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+#include <fmt/core.h>
+#include <zlib.h>
+
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+std::atomic<unsigned int> compression_threads{0};
+
+// deflate blocks are smaller, as they keep most of their ratio with the
+// dictionary from the previous block, while zstd frames are independent.
+constexpr std::size_t DEFLATE_BLOCK_SIZE = 128 * 1024;
+constexpr std::size_t ZSTD_BLOCK_SIZE = 512 * 1024;
+
+// size of the deflate window, and so the most a dictionary can be used of
+constexpr std::size_t DEFLATE_DICTIONARY_SIZE = 32 * 1024;
+
+using compressed_block = parallel_output_buffer::compressed_block;
+
+compressed_block compress_deflate_block(const std::string &input,
+                                        const std::string &dictionary,
+                                        int level, bool last, bool gzip) {
+  compressed_block result;
+  result.size = input.size();
+
+  const auto *data = reinterpret_cast<const Bytef *>(input.data());
+  result.check = gzip ? crc32(crc32(0, Z_NULL, 0), data, input.size())
+                      : adler32(adler32(0, Z_NULL, 0), data, input.size());
+
+  // a raw deflate stream, the gzip or zlib wrapper is added separately
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("deflateInit2 failed");
+  }
+
+  if (!dictionary.empty()) {
+    deflateSetDictionary(&stream, reinterpret_cast<const Bytef *>(dictionary.data()),
+                         dictionary.size());
+  }
+
+  // the bound is for Z_FINISH, a sync flush adds a few bytes more
+  result.data.resize(deflateBound(&stream, input.size()) + 64);
+
+  stream.next_in = const_cast<Bytef *>(data);
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef *>(result.data.data());
+  stream.avail_out = result.data.size();
+
+  const int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  const bool complete = last ? (status == Z_STREAM_END)
+                             : (status == Z_OK && stream.avail_in == 0 &&
+                                stream.avail_out > 0);
+  result.data.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (!complete) {
+    throw std::runtime_error("deflate failed");
+  }
+
+  return result;
+}
+
+#if HAVE_ZSTD
+compressed_block compress_zstd_block(const std::string &input, int level) {
+  struct cctx_deleter {
+    void operator()(ZSTD_CCtx *ctx) const { ZSTD_freeCCtx(ctx); }
+  };
+
+  // each thread keeps its context, as setting one up is expensive
+  thread_local std::unique_ptr<ZSTD_CCtx, cctx_deleter> ctx(ZSTD_createCCtx());
+  if (!ctx) {
+    throw std::bad_alloc();
+  }
+
+  compressed_block result;
+  result.size = input.size();
+  result.data.resize(ZSTD_compressBound(input.size()));
+
+  const auto size = ZSTD_compressCCtx(ctx.get(), result.data.data(), result.data.size(),
+                                      input.data(), input.size(), level);
+  if (ZSTD_isError(size)) {
+    throw std::runtime_error(fmt::format("Zstandard compression failed: {}",
+                                         ZSTD_getErrorName(size)));
+  }
+
+  result.data.resize(size);
+  return result;
+}
+#endif
+
+} // anonymous namespace
+
+void set_compression_threads(unsigned int threads) {
+  compression_threads = threads;
+}
+
+thread_pool *compression_thread_pool() {
+  static const std::unique_ptr<thread_pool> pool =
+      compression_threads > 0 ? std::make_unique<thread_pool>(compression_threads)
+                              : nullptr;
+  return pool.get();
+}
+
+parallel_output_buffer::parallel_output_buffer(output_buffer& o, thread_pool& pool,
+                                               format f, int level)
+    : out(o), pool(pool), type(f), level(level),
+      block_size(f == format::zstd ? ZSTD_BLOCK_SIZE : DEFLATE_BLOCK_SIZE),
+      check(f == format::gzip ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0)) {
+
+#if !HAVE_ZSTD
+  if (f == format::zstd) {
+    throw std::runtime_error("Zstandard support is not available");
+  }
+#endif
+
+  block.reserve(block_size);
+}
+
+// blocks still being compressed only refer to copies of their input, so
+// they can be left to finish on their own.
+parallel_output_buffer::~parallel_output_buffer() = default;
+
+int parallel_output_buffer::write(const char *buffer, int len) noexcept {
+  if (len < 0)
+    return -1;
+
+  try {
+    std::string_view data(buffer, len);
+
+    while (!data.empty()) {
+      const auto n = std::min(data.size(), block_size - block.size());
+      block.append(data.substr(0, n));
+      data.remove_prefix(n);
+
+      if (block.size() == block_size) {
+        submit_block(false);
+        write_blocks(false);
+      }
+    }
+  } catch (const std::exception &e) {
+    logger::message(fmt::format("Parallel compression failed: {}", e.what()));
+    return -1;
+  }
+
+  bytes_in += len;
+  return len;
+}
+
+int parallel_output_buffer::written() const { return bytes_in; }
+
+int parallel_output_buffer::close() noexcept {
+  try {
+    submit_block(true);
+    write_blocks(true);
+    write_trailer();
+  } catch (const std::exception &e) {
+    logger::message(fmt::format("Parallel compression failed: {}", e.what()));
+    return -1;
+  }
+
+  return out.close();
+}
+
+int parallel_output_buffer::flush() noexcept {
+  try {
+    if (!block.empty()) {
+      submit_block(false);
+    }
+    write_blocks(true);
+  } catch (const std::exception &e) {
+    logger::message(fmt::format("Parallel compression failed: {}", e.what()));
+    return -1;
+  }
+
+  return out.flush();
+}
+
+void parallel_output_buffer::submit_block(bool last) {
+
+  // an empty stream still needs a final deflate block or a zstd frame
+  if (last && block.empty() && type == format::zstd && frame_written) {
+    return;
+  }
+
+  std::string input;
+  input.swap(block);
+  block.reserve(block_size);
+
+  if (type == format::zstd) {
+#if HAVE_ZSTD
+    auto task = [input = std::move(input), level = level]() {
+      return compress_zstd_block(input, level);
+    };
+
+    if (last) {
+      pending.push_back(std::async(std::launch::deferred, std::move(task)));
+    } else {
+      pending.push_back(pool.submit(std::move(task)));
+    }
+#endif
+    frame_written = true;
+    return;
+  }
+
+  // the next block's dictionary is the end of what came before it
+  std::string next_dictionary;
+  if (!last) {
+    if (input.size() >= DEFLATE_DICTIONARY_SIZE) {
+      next_dictionary = input.substr(input.size() - DEFLATE_DICTIONARY_SIZE);
+    } else {
+      next_dictionary = dictionary + input;
+      if (next_dictionary.size() > DEFLATE_DICTIONARY_SIZE) {
+        next_dictionary.erase(0, next_dictionary.size() - DEFLATE_DICTIONARY_SIZE);
+      }
+    }
+  }
+
+  auto task = [input = std::move(input), dictionary = std::move(dictionary),
+               level = level, last, gzip = (type == format::gzip)]() {
+    return compress_deflate_block(input, dictionary, level, last, gzip);
+  };
+
+  dictionary = std::move(next_dictionary);
+
+  // the last block is compressed when it's written, on this thread
+  if (last) {
+    pending.push_back(std::async(std::launch::deferred, std::move(task)));
+  } else {
+    pending.push_back(pool.submit(std::move(task)));
+  }
+}
+
+// writes the compressed blocks at the front of the queue. unless all of
+// them are to be written, this only waits for blocks when there are too
+// many in flight.
+void parallel_output_buffer::write_blocks(bool all) {
+  const std::size_t max_pending = 2 * pool.size();
+
+  while (!pending.empty()) {
+    auto &front = pending.front();
+
+    const bool ready = all || pending.size() > max_pending ||
+        front.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    if (!ready) {
+      break;
+    }
+
+    const auto result = front.get();
+    pending.pop_front();
+
+    write_header();
+    write_data(result.data);
+
+    if (type == format::gzip) {
+      check = crc32_combine(check, result.check, result.size);
+    } else if (type == format::zlib) {
+      check = adler32_combine(check, result.check, result.size);
+    }
+  }
+}
+
+void parallel_output_buffer::write_header() {
+  if (header_written) {
+    return;
+  }
+  header_written = true;
+
+  if (type == format::gzip) {
+    // no file name or time, operating system unix
+    static constexpr std::array<char, 10> header = {
+      '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x03'};
+    write_data(std::string_view(header.data(), header.size()));
+
+  } else if (type == format::zlib) {
+    // 32 KiB window, default compression
+    static constexpr std::array<char, 2> header = {'\x78', '\x9c'};
+    write_data(std::string_view(header.data(), header.size()));
+  }
+}
+
+void parallel_output_buffer::write_trailer() {
+  std::array<char, 8> trailer;
+
+  if (type == format::gzip) {
+    // crc32 and size modulo 2^32, both little endian
+    const auto size = static_cast<uint32_t>(bytes_in);
+    for (int i = 0; i < 4; ++i) {
+      trailer[i] = static_cast<char>((check >> (8 * i)) & 0xff);
+      trailer[4 + i] = static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+    write_data(std::string_view(trailer.data(), 8));
+
+  } else if (type == format::zlib) {
+    // adler32, big endian
+    for (int i = 0; i < 4; ++i) {
+      trailer[i] = static_cast<char>((check >> (8 * (3 - i))) & 0xff);
+    }
+    write_data(std::string_view(trailer.data(), 4));
+  }
+}
+
+void parallel_output_buffer::write_data(std::string_view data) {
+  if (data.empty()) {
+    return;
+  }
+
+  if (out.write(data) != static_cast<int>(data.size())) {
+    throw output_writer::write_error(
+        "Output buffer wrote a different amount than was expected.");
+  }
+}
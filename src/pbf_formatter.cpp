@@ -0,0 +1,459 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/pbf_formatter.hpp"
+#include "cgimap/options.hpp"
+#include "cgimap/time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// field numbers from osmformat.proto
+namespace header_block {
+  constexpr uint32_t bbox = 1;
+  constexpr uint32_t required_features = 4;
+  constexpr uint32_t writingprogram = 16;
+}
+
+namespace header_bbox {
+  constexpr uint32_t left = 1;
+  constexpr uint32_t right = 2;
+  constexpr uint32_t top = 3;
+  constexpr uint32_t bottom = 4;
+}
+
+namespace primitive_block {
+  constexpr uint32_t stringtable = 1;
+  constexpr uint32_t primitivegroup = 2;
+}
+
+namespace string_table {
+  constexpr uint32_t s = 1;
+}
+
+namespace primitive_group {
+  constexpr uint32_t dense = 2;
+  constexpr uint32_t ways = 3;
+  constexpr uint32_t relations = 4;
+}
+
+namespace dense_nodes {
+  constexpr uint32_t id = 1;
+  constexpr uint32_t denseinfo = 5;
+  constexpr uint32_t lat = 8;
+  constexpr uint32_t lon = 9;
+  constexpr uint32_t keys_vals = 10;
+}
+
+namespace dense_info {
+  constexpr uint32_t version = 1;
+  constexpr uint32_t timestamp = 2;
+  constexpr uint32_t changeset = 3;
+  constexpr uint32_t uid = 4;
+  constexpr uint32_t user_sid = 5;
+  constexpr uint32_t visible = 6;
+}
+
+namespace info {
+  constexpr uint32_t version = 1;
+  constexpr uint32_t timestamp = 2;
+  constexpr uint32_t changeset = 3;
+  constexpr uint32_t uid = 4;
+  constexpr uint32_t user_sid = 5;
+  constexpr uint32_t visible = 6;
+}
+
+namespace way {
+  constexpr uint32_t id = 1;
+  constexpr uint32_t keys = 2;
+  constexpr uint32_t vals = 3;
+  constexpr uint32_t info = 4;
+  constexpr uint32_t refs = 8;
+}
+
+namespace relation {
+  constexpr uint32_t id = 1;
+  constexpr uint32_t keys = 2;
+  constexpr uint32_t vals = 3;
+  constexpr uint32_t info = 4;
+  constexpr uint32_t roles_sid = 8;
+  constexpr uint32_t memids = 9;
+  constexpr uint32_t types = 10;
+}
+
+// blocks use the default granularity of 100 nanodegrees and the default
+// date granularity of 1 second.
+int64_t to_granularity(double coord) {
+  return std::llround(coord * 10'000'000);
+}
+
+// with the default scale the database uses the same units as the blocks.
+int64_t to_granularity(int64_t coord, int64_t scale) {
+  if (scale == 10'000'000)
+    return coord;
+  return to_granularity(static_cast<double>(coord) / static_cast<double>(scale));
+}
+
+int64_t to_nanodegrees(double coord) {
+  return std::llround(coord * 1'000'000'000);
+}
+
+int64_t to_timestamp(const std::string &timestamp) {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+           parse_time(timestamp).time_since_epoch()).count();
+}
+
+uint32_t member_type(element_type type) {
+  switch (type) {
+  case element_type::node:
+    return 0;
+  case element_type::way:
+    return 1;
+  case element_type::relation:
+    return 2;
+  default:
+    throw std::runtime_error("Unsupported relation member type");
+  }
+}
+
+template <typename T>
+void delta_encode(const std::vector<T> &values, std::vector<int64_t> &deltas) {
+  deltas.clear();
+  int64_t last = 0;
+  for (auto value : values) {
+    deltas.push_back(static_cast<int64_t>(value) - last);
+    last = value;
+  }
+}
+
+} // anonymous namespace
+
+void pbf_formatter::dense_columns::clear() {
+  ids.clear();
+  lats.clear();
+  lons.clear();
+  versions.clear();
+  timestamps.clear();
+  changesets.clear();
+  uids.clear();
+  user_sids.clear();
+  visible.clear();
+  keys_vals.clear();
+}
+
+pbf_formatter::pbf_formatter(std::unique_ptr<pbf_writer> w) : writer(std::move(w)) {
+  // string 0 is reserved as delimiter
+  strings.emplace_back();
+}
+
+pbf_formatter::~pbf_formatter() = default;
+
+mime::type pbf_formatter::mime_type() const { return mime::type::application_x_protobuf; }
+
+void pbf_formatter::set_historical(bool h) {
+  historical = h;
+}
+
+void pbf_formatter::start_document(
+  const std::string &gen, const std::string &) {
+  // the header block is written together with the first data block, once
+  // the bounds are known.
+  generator = gen;
+}
+
+void pbf_formatter::end_document() {
+  write_block();
+  write_header();
+}
+
+void pbf_formatter::write_bounds(const bbox &b) {
+  bounds = b;
+}
+
+void pbf_formatter::start_element() {
+  // nothing needed here
+}
+
+void pbf_formatter::end_element() {
+  // nothing needed here
+}
+
+void pbf_formatter::start_changeset(bool) {
+  // nothing needed here
+}
+
+void pbf_formatter::end_changeset(bool) {
+  // nothing needed here
+}
+
+void pbf_formatter::start_action(action_type) {
+  // nothing needed here
+}
+
+void pbf_formatter::end_action(action_type) {
+  // nothing needed here
+}
+
+void pbf_formatter::error(const std::exception &e) {
+  error(std::string(e.what()));
+}
+
+void pbf_formatter::error(const std::string &s) {
+  failed = true;
+  writer->error(s);
+}
+
+uint32_t pbf_formatter::string_id(const std::string &s) {
+  auto [it, inserted] = string_ids.try_emplace(s, strings.size());
+  if (inserted)
+    strings.push_back(s);
+  return it->second;
+}
+
+void pbf_formatter::start_block(element_type type) {
+  // elements in a block are written grouped by type, nodes first, so a
+  // new block is needed if elements don't arrive in that order.
+  const auto block_bytes = ways.size() + relations.size() + nodes.ids.size() * 32;
+
+  if (block_elements >= MAX_BLOCK_ELEMENTS ||
+      block_bytes >= MAX_BLOCK_BYTES ||
+      type < block_type)
+    write_block();
+
+  block_type = type;
+  ++block_elements;
+}
+
+void pbf_formatter::write_info(pbf_message &msg, const element_info &elem) {
+  msg.add_uint(info::version, elem.version);
+  msg.add_uint(info::timestamp, to_timestamp(elem.timestamp));
+  msg.add_uint(info::changeset, elem.changeset);
+  if (elem.display_name && elem.uid) {
+    msg.add_uint(info::uid, *elem.uid);
+    msg.add_uint(info::user_sid, string_id(*elem.display_name));
+  }
+  // visible defaults to true
+  if (!elem.visible) {
+    msg.add_uint(info::visible, 0);
+    has_deleted = true;
+  }
+}
+
+void pbf_formatter::write_tags(pbf_message &msg, const tags_t &tags) {
+  keys.clear();
+  vals.clear();
+  for (const auto & [key, value] : tags) {
+    keys.push_back(string_id(key));
+    vals.push_back(string_id(value));
+  }
+  msg.add_packed_uint(way::keys, keys);
+  msg.add_packed_uint(way::vals, vals);
+}
+
+void pbf_formatter::write_node(const element_info &elem, double lon, double lat,
+                               const tags_t &tags) {
+  add_node(elem, to_granularity(lon), to_granularity(lat), tags);
+}
+
+void pbf_formatter::write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                               const tags_t &tags) {
+  const auto scale = global_settings::get_scale();
+  add_node(elem, to_granularity(lonlat.lon, scale), to_granularity(lonlat.lat, scale), tags);
+}
+
+void pbf_formatter::add_node(const element_info &elem, int64_t lon, int64_t lat,
+                             const tags_t &tags) {
+  start_block(element_type::node);
+
+  nodes.ids.push_back(elem.id);
+  // deleted nodes don't have a location
+  nodes.lats.push_back(elem.visible ? lat : 0);
+  nodes.lons.push_back(elem.visible ? lon : 0);
+  nodes.versions.push_back(elem.version);
+  nodes.timestamps.push_back(to_timestamp(elem.timestamp));
+  nodes.changesets.push_back(elem.changeset);
+  if (elem.display_name && elem.uid) {
+    nodes.uids.push_back(*elem.uid);
+    nodes.user_sids.push_back(string_id(*elem.display_name));
+  } else {
+    nodes.uids.push_back(0);
+    nodes.user_sids.push_back(0);
+  }
+  nodes.visible.push_back(elem.visible);
+  has_deleted |= !elem.visible;
+
+  for (const auto & [key, value] : tags) {
+    nodes.keys_vals.push_back(string_id(key));
+    nodes.keys_vals.push_back(string_id(value));
+  }
+  nodes.keys_vals.push_back(0);
+}
+
+void pbf_formatter::write_way(const element_info &elem, const nodes_t &way_nodes,
+                              const tags_t &tags) {
+  start_block(element_type::way);
+
+  element.clear();
+  element.add_uint(way::id, elem.id);
+  write_tags(element, tags);
+
+  metadata.clear();
+  write_info(metadata, elem);
+  element.add_message(way::info, metadata);
+
+  delta_encode(way_nodes, deltas);
+  element.add_packed_sint(way::refs, deltas);
+
+  ways.add_message(primitive_group::ways, element);
+}
+
+void pbf_formatter::write_relation(const element_info &elem,
+                                   const members_t &members,
+                                   const tags_t &tags) {
+  start_block(element_type::relation);
+
+  element.clear();
+  element.add_uint(relation::id, elem.id);
+  write_tags(element, tags);
+
+  metadata.clear();
+  write_info(metadata, elem);
+  element.add_message(relation::info, metadata);
+
+  roles.clear();
+  types.clear();
+  deltas.clear();
+  int64_t last = 0;
+  for (const auto & member : members) {
+    roles.push_back(string_id(member.role));
+    types.push_back(member_type(member.type));
+    deltas.push_back(static_cast<int64_t>(member.ref) - last);
+    last = member.ref;
+  }
+  element.add_packed_uint(relation::roles_sid, roles);
+  element.add_packed_sint(relation::memids, deltas);
+  element.add_packed_uint(relation::types, types);
+
+  relations.add_message(primitive_group::relations, element);
+}
+
+// LCOV_EXCL_START
+
+void pbf_formatter::write_changeset(const changeset_info &, const tags_t &,
+                                    bool, const comments_t &,
+                                    const std::chrono::system_clock::time_point &) {
+  throw std::runtime_error("Changesets cannot be written as PBF");
+}
+
+void pbf_formatter::write_diffresult_create_modify(const element_type,
+                                                   const osm_nwr_signed_id_t,
+                                                   const osm_nwr_id_t,
+                                                   const osm_version_t) {
+  throw std::runtime_error("Diff results cannot be written as PBF");
+}
+
+void pbf_formatter::write_diffresult_delete(const element_type,
+                                            const osm_nwr_signed_id_t) {
+  throw std::runtime_error("Diff results cannot be written as PBF");
+}
+
+// LCOV_EXCL_STOP
+
+void pbf_formatter::write_header() {
+  if (header_written || failed)
+    return;
+
+  pbf_message header;
+
+  if (bounds) {
+    pbf_message box;
+    box.add_sint(header_bbox::left, to_nanodegrees(bounds->minlon));
+    box.add_sint(header_bbox::right, to_nanodegrees(bounds->maxlon));
+    box.add_sint(header_bbox::top, to_nanodegrees(bounds->maxlat));
+    box.add_sint(header_bbox::bottom, to_nanodegrees(bounds->minlat));
+    header.add_message(header_block::bbox, box);
+  }
+
+  header.add_bytes(header_block::required_features, "OsmSchema-V0.6");
+  header.add_bytes(header_block::required_features, "DenseNodes");
+  if (historical || has_deleted)
+    header.add_bytes(header_block::required_features, "HistoricalInformation");
+  header.add_bytes(header_block::writingprogram, generator);
+
+  writer->write_block("OSMHeader", header);
+  header_written = true;
+}
+
+void pbf_formatter::write_block() {
+  if (block_elements == 0)
+    return;
+
+  if (!failed) {
+    write_header();
+
+    block.clear();
+
+    pbf_message stringtable;
+    for (const auto & s : strings)
+      stringtable.add_bytes(string_table::s, s);
+    block.add_message(primitive_block::stringtable, stringtable);
+
+    if (!nodes.empty()) {
+      pbf_message denseinfo;
+      denseinfo.add_packed_uint(dense_info::version, nodes.versions);
+      delta_encode(nodes.timestamps, deltas);
+      denseinfo.add_packed_sint(dense_info::timestamp, deltas);
+      delta_encode(nodes.changesets, deltas);
+      denseinfo.add_packed_sint(dense_info::changeset, deltas);
+      delta_encode(nodes.uids, deltas);
+      denseinfo.add_packed_sint(dense_info::uid, deltas);
+      delta_encode(nodes.user_sids, deltas);
+      denseinfo.add_packed_sint(dense_info::user_sid, deltas);
+      // all nodes are visible unless stated otherwise
+      if (std::ranges::find(nodes.visible, false) != nodes.visible.end())
+        denseinfo.add_packed_uint(dense_info::visible, nodes.visible);
+
+      pbf_message dense;
+      delta_encode(nodes.ids, deltas);
+      dense.add_packed_sint(dense_nodes::id, deltas);
+      dense.add_message(dense_nodes::denseinfo, denseinfo);
+      delta_encode(nodes.lats, deltas);
+      dense.add_packed_sint(dense_nodes::lat, deltas);
+      delta_encode(nodes.lons, deltas);
+      dense.add_packed_sint(dense_nodes::lon, deltas);
+      dense.add_packed_uint(dense_nodes::keys_vals, nodes.keys_vals);
+
+      pbf_message group;
+      group.add_message(primitive_group::dense, dense);
+      block.add_message(primitive_block::primitivegroup, group);
+    }
+
+    // ways and relations are already serialised as repeated fields of
+    // their primitive group.
+    if (!ways.empty())
+      block.add_message(primitive_block::primitivegroup, ways);
+
+    if (!relations.empty())
+      block.add_message(primitive_block::primitivegroup, relations);
+
+    writer->write_block("OSMData", block);
+  }
+
+  strings.resize(1);
+  string_ids.clear();
+  nodes.clear();
+  ways.clear();
+  relations.clear();
+  block_elements = 0;
+}
+
+void pbf_formatter::flush() { writer->flush(); }
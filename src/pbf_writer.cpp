@@ -0,0 +1,117 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/pbf_writer.hpp"
+
+#include <array>
+#include <new>
+
+#include <zlib.h>
+
+namespace {
+
+enum wire_type : uint32_t {
+  varint = 0,
+  length_delimited = 2
+};
+
+// Blob and BlobHeader fields, see fileformat.proto
+constexpr uint32_t blob_raw_size = 2;
+constexpr uint32_t blob_zlib_data = 3;
+constexpr uint32_t blob_header_type = 1;
+constexpr uint32_t blob_header_datasize = 3;
+
+uint64_t tag(uint32_t field, wire_type type) {
+  return (static_cast<uint64_t>(field) << 3) | type;
+}
+
+}
+
+void pbf_message::append_varint(std::string &out, uint64_t value) {
+  std::array<char, 10> tmp;
+  std::size_t len = 0;
+
+  while (value >= 0x80) {
+    tmp[len++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  tmp[len++] = static_cast<char>(value);
+
+  out.append(tmp.data(), len);
+}
+
+void pbf_message::add_uint(uint32_t field, uint64_t value) {
+  append_varint(buf, tag(field, varint));
+  append_varint(buf, value);
+}
+
+void pbf_message::add_sint(uint32_t field, int64_t value) {
+  add_uint(field, zigzag(value));
+}
+
+void pbf_message::add_bytes(uint32_t field, std::string_view value) {
+  append_varint(buf, tag(field, length_delimited));
+  append_varint(buf, value.size());
+  buf.append(value);
+}
+
+pbf_writer::pbf_writer(output_buffer &o) : out(o) {}
+
+pbf_writer::~pbf_writer() noexcept {
+  out.close();
+}
+
+void pbf_writer::write_block(std::string_view type, const pbf_message &block) {
+
+  if (failed)
+    return;
+
+  auto raw = block.data();
+
+  uLongf compressed_size = compressBound(raw.size());
+  compressed.resize(compressed_size);
+  int rc = compress2(reinterpret_cast<Bytef *>(compressed.data()), &compressed_size,
+                     reinterpret_cast<const Bytef *>(raw.data()), raw.size(),
+                     Z_DEFAULT_COMPRESSION);
+  if (rc == Z_MEM_ERROR)
+    throw std::bad_alloc();
+  if (rc != Z_OK)
+    throw write_error("cannot compress PBF block.");
+
+  blob.clear();
+  blob.add_uint(blob_raw_size, raw.size());
+  blob.add_bytes(blob_zlib_data, std::string_view(compressed.data(), compressed_size));
+
+  blob_header.clear();
+  blob_header.add_bytes(blob_header_type, type);
+  blob_header.add_uint(blob_header_datasize, blob.size());
+
+  // the blob header size is a 4 byte integer in network byte order
+  const auto header_size = static_cast<uint32_t>(blob_header.size());
+  const std::array<char, 4> size_prefix = {
+    static_cast<char>(header_size >> 24),
+    static_cast<char>(header_size >> 16),
+    static_cast<char>(header_size >> 8),
+    static_cast<char>(header_size)
+  };
+
+  if (out.write(size_prefix.data(), size_prefix.size()) < 0 ||
+      out.write(blob_header.data()) < 0 ||
+      out.write(blob.data()) < 0)
+    throw write_error("cannot write PBF block.");
+}
+
+void pbf_writer::flush() {
+  if (out.flush() < 0)
+    throw write_error("cannot flush output stream");
+}
+
+void pbf_writer::error(const std::string &) {
+  failed = true;
+}
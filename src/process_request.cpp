@@ -17,9 +17,15 @@
 #include "cgimap/output_writer.hpp"
 #include "cgimap/util.hpp"
 #include "cgimap/oauth2.hpp"
+#include "cgimap/response_cache.hpp"
+#include "cgimap/sha256.hpp"
 
 #include <chrono>
+#include <clocale>
+#include <ctime>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <tuple>
 
 #include <fmt/core.h>
@@ -27,6 +33,22 @@
 
 namespace {
 
+// CPU time used by the calling thread, which is working on the request.
+std::chrono::milliseconds thread_cpu_time() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
+
+// text formats are always UTF-8, binary ones don't have a charset
+std::string content_type(mime::type mt) {
+  if (mt == mime::type::application_x_protobuf)
+    return mime::to_string(mt);
+
+  return fmt::format("{}; charset=utf-8", mime::to_string(mt));
+}
+
 void validate_user_db_update_permission (
     const RequestContext& req_ctx,
     data_selection& selection)
@@ -174,41 +196,204 @@ void process_not_allowed(request &req, const http::method_not_allowed& e) {
      .finish();
 }
 
-std::size_t generate_response(request &req, responder &responder, const std::string &generator)
-{
-  // get encoding to use
-  auto encoding = get_encoding(req);
+// validators of a response, see RFC 9110 section 8.8
+struct response_validators {
+  std::string etag;
+  std::chrono::system_clock::time_point last_modified;
+};
+
+std::optional<response_validators> get_validators(const responder &responder,
+                                                  mime::type mt,
+                                                  const http::encoding &encoding,
+                                                  const std::string &generator) {
+  const auto version = responder.version();
+  if (!version)
+    return {};
+
+  // the response also depends on its format and encoding, and on the
+  // version of cgimap which writes it.
+  const auto digest = sha256_hex(fmt::format("{}\n{}\n{}\n{}", version->digest,
+                                             mime::to_string(mt), encoding.name(),
+                                             generator));
+
+  return response_validators{fmt::format("\"{}\"", digest.substr(0, 32)),
+                             version->last_modified};
+}
+
+// true if the client already has the current response, in which case
+// If-None-Match takes precedence over If-Modified-Since.
+bool is_not_modified(const request &req, const response_validators &validators) {
+  if (const char *if_none_match = req.get_param("HTTP_IF_NONE_MATCH")) {
+    return http::etag_matches(if_none_match, validators.etag);
+  }
+
+  // Last-Modified is the time of the newest element, but the digest in the
+  // entity tag also covers things without a timestamp: the display name and
+  // data_public flag of the changeset users, and redactions. clients which
+  // only send If-Modified-Since won't see those changes until one of the
+  // elements is edited, so they should use If-None-Match instead.
+  if (const char *if_modified_since = req.get_param("HTTP_IF_MODIFIED_SINCE")) {
+    const auto since = http::parse_http_date(if_modified_since);
+    return since && validators.last_modified <= *since;
+  }
+
+  return false;
+}
+
+void add_validator_headers(request &req, const response_validators &validators) {
+  req.add_header("ETag", validators.etag)
+     .add_header("Last-Modified", http::format_http_date(validators.last_modified));
+}
+
+void respond_304(request &req, const response_validators &validators) {
+  req.status(304);
+  add_validator_headers(req, validators);
+  req.add_header("Cache-Control", "private, max-age=0, must-revalidate");
+  req.finish();
+}
+
+// responses larger than this aren't kept in the response cache
+constexpr std::size_t MAX_CACHED_RESPONSE = 8 * 1024 * 1024;
+
+/**
+ * Passes everything on to another output buffer, keeping a copy of what
+ * was written for the response cache, as long as it's not too large.
+ */
+class recording_output_buffer : public output_buffer {
+public:
+  explicit recording_output_buffer(output_buffer &o) : out(o) {}
+
+  using output_buffer::write;
+
+  int write(const char *buffer, int len) noexcept override {
+    const int rc = out.write(buffer, len);
+    if (rc > 0)
+      record(std::string_view(buffer, rc));
+    return rc;
+  }
+
+  int write_chunks(std::span<const std::string_view> chunks) noexcept override {
+    const int rc = out.write_chunks(chunks);
+    if (rc < 0)
+      return rc;
+    for (const auto &chunk : chunks)
+      record(chunk);
+    return rc;
+  }
+
+  int written() const override { return out.written(); }
+  int close() noexcept override { return out.close(); }
+  int flush() noexcept override { return out.flush(); }
+
+  // everything which was written, unless it was too much to keep
+  std::optional<std::string> recorded() const {
+    if (overflow)
+      return {};
+    return data;
+  }
+
+private:
+  void record(std::string_view piece) noexcept {
+    if (overflow)
+      return;
+
+    if (data.size() + piece.size() > MAX_CACHED_RESPONSE) {
+      overflow = true;
+      std::string().swap(data);
+      return;
+    }
+
+    try {
+      data.append(piece);
+    } catch (...) {
+      overflow = true;
+    }
+  }
 
+  output_buffer &out;
+  std::string data;
+  bool overflow = false;
+};
+
+std::string response_cache_key(const request &req, const response_validators &validators) {
+  return fmt::format("{}?{}\n{}", get_request_path(req), get_query_string(req),
+                     validators.etag);
+}
+
+// conditional requests are only answered for GET and HEAD requests, where
+// the responder's version is checked before any data is extracted. the
+// same goes for the response cache.
+std::size_t generate_response(request &req, responder &responder, const std::string &generator,
+                              bool conditional = false, response_cache *cache = nullptr)
+{
   // figure out best mime type
   const mime::type best_mime_type = choose_best_mime_type(req, responder);
 
+  // get encoding to use
+  auto encoding = get_encoding(req, best_mime_type);
+
+  const auto validators = conditional
+      ? get_validators(responder, best_mime_type, *encoding, generator)
+      : std::nullopt;
+
+  if (validators && is_not_modified(req, *validators)) {
+    respond_304(req, *validators);
+    return 0;
+  }
+
   // TODO: use handler/responder to setup response headers.
   // write the response header
   req.status(200)
-     .add_header("Content-Type", fmt::format("{}; charset=utf-8",
-                                  mime::to_string(best_mime_type)))
+     .add_header("Content-Type", content_type(best_mime_type))
      .add_header("Content-Encoding", encoding->name())
      .add_header("Cache-Control", "private, max-age=0, must-revalidate");
 
+  if (validators) {
+    add_validator_headers(req, *validators);
+  }
+
+  std::optional<std::string> cache_key;
+  if (validators && cache && cache->enabled() && responder.cacheable()) {
+    cache_key = response_cache_key(req, *validators);
+
+    if (const auto cached = cache->get(*cache_key)) {
+      req.put(cached->body);
+      req.finish();
+      return cached->written;
+    }
+  }
+
+  // large responses, or all of them when the CPUs are busy, are compressed
+  // with less effort. large responses may also be compressed in parallel.
+  const auto compression = choose_compression(responder.expected_size(),
+                                              cpu_headroom());
+
+  // keep a copy of the encoded response if it's going to be cached
+  std::optional<recording_output_buffer> recorder;
+  if (cache_key) {
+    recorder.emplace(req.get_buffer());
+  }
+
   // create the XML/JSON/text writer with the FCGI streams as output
-  auto out = encoding->buffer(req.get_buffer());
+  auto out = encoding->buffer(recorder ? *recorder : req.get_buffer(), compression);
 
   // create the correct mime type output formatter.
   auto o_formatter = create_formatter(best_mime_type, *out);
 
+  bool complete = false;
+
   try {
     // call to write the response
     responder.write(*o_formatter, generator, req.get_current_time());
 
-    // ensure the request is finished
-    req.finish();
-
     // make sure all bytes have been written. note that the writer can
     // throw an exception here, leaving the xml document in a
     // half-written state...
     o_formatter->flush();
     out->flush();
 
+    complete = true;
+
   } catch (const output_writer::write_error &e) {
     // don't do anything - just go on to the next request.
     logger::message(fmt::format("Caught write error, aborting request: {}", e.what()));
@@ -220,6 +405,20 @@ std::size_t generate_response(request &req, responder &responder, const std::str
     o_formatter->error(e.what());
   }
 
+  // the encoded response is only complete once the writer is closed
+  o_formatter.reset();
+
+  if (recorder) {
+    if (auto body = recorder->recorded(); body && complete && responder.cacheable()) {
+      cache->put(*cache_key, cached_response{std::move(*body),
+                                             static_cast<std::size_t>(out->written())});
+    }
+  }
+
+  // ensure the request is finished, which sends anything still buffered.
+  // nothing can be written after this.
+  req.finish();
+
   return out->written();
 }
 
@@ -229,7 +428,8 @@ std::size_t generate_response(request &req, responder &responder, const std::str
 std::tuple<std::string, size_t>
 process_get_request(request& req, const handler& handler,
                     data_selection& selection,
-                    const std::string &ip, const std::string &generator) {
+                    const std::string &ip, const std::string &generator,
+                    response_cache *cache) {
   // request start logging
   const std::string request_name = handler.log_name();
   logger::message(fmt::format("Started request for {} from {}", request_name, ip));
@@ -237,8 +437,9 @@ process_get_request(request& req, const handler& handler,
   // Collect all object ids (nodes/ways/relations/...) for the respective endpoint
   responder_ptr_t responder = handler.responder(selection);
 
-  // Generate full XML/JSON/text response message for previously collected object ids
-  std::size_t bytes_written = generate_response(req, *responder, generator);
+  // Generate full XML/JSON/text response message for previously collected object ids,
+  // unless the client already has it
+  std::size_t bytes_written = generate_response(req, *responder, generator, true, cache);
 
   return {request_name, bytes_written};
 }
@@ -265,7 +466,10 @@ process_post_put_request(RequestContext& req_ctx,
 
     // Process request, perform database update
     {
-      const auto payload = req_ctx.req.get_payload();
+      // the payload is read completely before the transaction is started,
+      // so a slow client can't keep it and any locks open while sending.
+      const auto payload = pe_handler.streams_payload() ? req_ctx.req.read_raw_payload()
+                                                        : req_ctx.req.get_payload();
       auto rw_transaction = update_factory.get_default_transaction();
       auto data_update = update_factory.make_data_update(*rw_transaction);
       check_db_readonly_mode(*data_update);
@@ -313,7 +517,7 @@ process_post_put_request(RequestContext& req_ctx,
 std::tuple<std::string, size_t>
 process_head_request(request& req, const handler& handler,
                      data_selection& selection,
-                     const std::string &ip) {
+                     const std::string &ip, const std::string &generator) {
   // request start logging
   const std::string request_name = handler.log_name();
   logger::message(fmt::format("Started HEAD request for {} from {}", request_name, ip));
@@ -327,20 +531,31 @@ process_head_request(request& req, const handler& handler,
   // constructor of responder handles dynamic validation (i.e: with db access).
   responder_ptr_t responder = handler.responder(selection);
 
-  // get encoding to use
-  auto encoding = get_encoding(req);
-
   // figure out best mime type
   const mime::type best_mime_type = choose_best_mime_type(req, *responder);
 
+  // get encoding to use
+  auto encoding = get_encoding(req, best_mime_type);
+
+  // the same validators as for a GET request
+  const auto validators = get_validators(*responder, best_mime_type, *encoding, generator);
+
+  if (validators && is_not_modified(req, *validators)) {
+    respond_304(req, *validators);
+    return {request_name, 0};
+  }
+
   // TODO: use handler/responder to setup response headers.
   // write the response header
   req.status(200)
-     .add_header("Content-Type", fmt::format("{}; charset=utf-8",
-                                  mime::to_string(best_mime_type)))
+     .add_header("Content-Type", content_type(best_mime_type))
      .add_header("Content-Encoding", encoding->name())
      .add_header("Cache-Control", "no-cache");
 
+  if (validators) {
+    add_validator_headers(req, *validators);
+  }
+
   // ensure the request is finished
   req.finish();
 
@@ -416,13 +631,16 @@ std::pair<std::optional<osm_user_id_t>, bool> determine_user_id(const request& r
 void process_request(request &req, rate_limiter &limiter,
                      const std::string &generator, const routes &route,
                      data_selection::factory& factory,
-                     data_update::factory* update_factory) {
+                     data_update::factory* update_factory,
+                     response_cache *cache) {
 
   try {
 
     RequestContext req_ctx{.req=req};
 
-    std::setlocale(LC_ALL, "C.UTF-8");
+    // setlocale isn't thread-safe, only do this once per process.
+    static std::once_flag locale_flag;
+    std::call_once(locale_flag, [] { std::setlocale(LC_ALL, "C.UTF-8"); });
 
     // get the client IP address
     const auto ip = fcgi_get_env(req, "REMOTE_ADDR");
@@ -479,6 +697,7 @@ void process_request(request &req, rate_limiter &limiter,
     }
 
     const auto start_time = std::chrono::high_resolution_clock::now();
+    const auto start_cpu_time = thread_cpu_time();
 
     if (is_moderator && show_redactions_requested(req)) {
       selection->set_redactions_visible(true);
@@ -493,12 +712,12 @@ void process_request(request &req, rate_limiter &limiter,
 
     case http::method::GET:
       std::tie(request_name, bytes_written) =
-          process_get_request(req, *handler, *selection, ip, generator);
+          process_get_request(req, *handler, *selection, ip, generator, cache);
       break;
 
     case http::method::HEAD:
       std::tie(request_name, bytes_written) =
-          process_head_request(req, *handler, *selection, ip);
+          process_head_request(req, *handler, *selection, ip, generator);
       break;
 
     case http::method::POST:
@@ -533,10 +752,19 @@ void process_request(request &req, rate_limiter &limiter,
     // logging twice when an error is thrown.)
     const auto end_time = std::chrono::high_resolution_clock::now();
     const auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-    logger::message(fmt::format("Completed request for {} from {} in {:d} ms returning {:d} bytes",
+    const auto cpu_time = (thread_cpu_time() - start_cpu_time).count();
+    const auto stats = req.get_output_stats();
+    const double ratio = stats.body_bytes > 0 ? double(bytes_written) / stats.body_bytes : 1.0;
+    logger::message(fmt::format("Completed request for {} from {} in {:d} ms ({:d} ms CPU) returning {:d} bytes "
+                                "({:d} sent, ratio {:.2f}) in {:d} writes and {:d} syscalls",
                     request_name, ip,
                     delta,
-                    bytes_written));
+                    cpu_time,
+                    bytes_written,
+                    stats.body_bytes,
+                    ratio,
+                    stats.writes,
+                    stats.syscalls));
 
   } catch (const http::not_found &e) {
     // most errors are passed back giving the client a choice of whether to
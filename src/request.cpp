@@ -8,8 +8,10 @@
  */
 
 #include "cgimap/request.hpp"
+#include "cgimap/options.hpp"
 #include "cgimap/output_buffer.hpp"
 
+#include <new>
 #include <stdexcept>
 
 #include <fmt/core.h>
@@ -25,9 +27,78 @@ void set_default_headers(request &req) {
        .add_header("Access-Control-Max-Age", "1728000");
   }
 }
+
+// size of the pieces of the raw payload which are decompressed at a time
+constexpr std::size_t PAYLOAD_DECODE_CHUNK = 65536;
 } // anonymous namespace
 
 
+std::string request::get_payload() {
+  std::string result;
+
+  decode_payload(read_raw_payload(), [&result](std::string_view chunk) { result += chunk; });
+
+  return result;
+}
+
+std::string request::read_raw_payload() {
+
+  // fetch and parse the content length
+  const char *content_length_str = get_param("CONTENT_LENGTH");
+
+  unsigned long content_length = 0;
+
+  if (content_length_str)
+    content_length = http::parse_content_length(content_length_str);
+
+  std::string raw;
+  raw.reserve(content_length);
+
+  for (auto content = read_body(); !content.empty(); content = read_body()) {
+    raw += content;
+
+    // the size limit applies to the decompressed payload, which won't be
+    // any smaller than this.
+    if (raw.length() > global_settings::get_payload_max_size())
+      throw http::payload_too_large(fmt::format("Payload exceeds limit of {:d} bytes", global_settings::get_payload_max_size()));
+  }
+
+  if (content_length > 0 && raw.length() != content_length)
+    throw http::server_error("HTTP Header field 'Content-Length' differs from actual payload length");
+
+  return raw;
+}
+
+void request::decode_payload(std::string_view raw,
+                             const std::function<void(std::string_view)> &consumer) const {
+
+  const char *content_encoding = get_param("HTTP_CONTENT_ENCODING");
+
+  auto content_encoding_handler = http::get_content_encoding_handler(
+         std::string_view(content_encoding == nullptr ? "" : content_encoding));
+
+  unsigned long payload_length = 0;
+
+  for (std::size_t offset = 0; offset < raw.length(); offset += PAYLOAD_DECODE_CHUNK) {
+
+    // Decompression according to Content-Encoding header (null op, if header is not set)
+    try {
+      content_encoding_handler->decompress(raw.substr(offset, PAYLOAD_DECODE_CHUNK), [&](std::string_view decompressed) {
+        payload_length += decompressed.length();
+
+        if (payload_length > global_settings::get_payload_max_size())
+          throw http::payload_too_large(fmt::format("Payload exceeds limit of {:d} bytes", global_settings::get_payload_max_size()));
+
+        consumer(decompressed);
+      });
+    } catch (std::bad_alloc&) {
+      throw http::server_error("Decompression failed due to memory issue");
+    } catch (decompression_error&) {
+      throw http::bad_request("Payload cannot be decompressed according to Content-Encoding");
+    }
+  }
+}
+
 request& request::status(int code) {
   check_workflow(status_HEADERS);
   m_status = code;
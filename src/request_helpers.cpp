@@ -88,12 +88,13 @@ std::string get_request_path(const request &req) {
 }
 
 /**
- * get encoding to use for response.
+ * get encoding to use for a response of the given mime type.
  */
-std::unique_ptr<http::encoding> get_encoding(const request &req) {
+std::unique_ptr<http::encoding> get_encoding(const request &req, mime::type mt) {
   const char *accept_encoding = req.get_param("HTTP_ACCEPT_ENCODING");
 
-  if (accept_encoding) {
+  // compressing the zlib-compressed PBF blobs again only costs CPU time
+  if (accept_encoding && mt != mime::type::application_x_protobuf) {
     return http::choose_encoding(std::string(accept_encoding));
   } else {
     return std::make_unique<http::identity>();
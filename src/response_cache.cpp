@@ -0,0 +1,244 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/response_cache.hpp"
+#include "cgimap/logger.hpp"
+#include "cgimap/sha256.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+namespace {
+
+// memcached's default item size limit is 1 MiB, including the key and
+// item header.
+constexpr std::size_t MEMCACHED_MAX_BODY = 1000 * 1000;
+
+// entries don't need to expire, but unused ones shouldn't linger forever
+constexpr time_t MEMCACHED_EXPIRATION = 60L * 60L * 24L * 7L;
+
+// log the hit rates every so many lookups
+constexpr uint64_t STATISTICS_INTERVAL = 10000;
+
+std::atomic<uint64_t> memory_hits{0};
+std::atomic<uint64_t> shared_hits{0};
+std::atomic<uint64_t> misses{0};
+std::atomic<uint64_t> stores{0};
+
+void log_statistics() {
+  const auto stats = response_cache::get_statistics();
+  const auto lookups = stats.memory_hits + stats.shared_hits + stats.misses;
+
+  if (lookups % STATISTICS_INTERVAL != 0)
+    return;
+
+  logger::message(fmt::format(
+      "Response cache: {} lookups, {} memory hits, {} memcached hits, {} stores",
+      lookups, stats.memory_hits, stats.shared_hits, stats.stores));
+}
+
+} // anonymous namespace
+
+memory_response_cache::memory_response_cache(std::size_t capacity)
+    : m_capacity(capacity) {}
+
+std::optional<cached_response> memory_response_cache::get(const std::string &key) {
+  std::scoped_lock lock(m_mutex);
+
+  auto itr = m_index.find(key);
+  if (itr == m_index.end())
+    return {};
+
+  m_entries.splice(m_entries.begin(), m_entries, itr->second);
+  return itr->second->response;
+}
+
+void memory_response_cache::put(const std::string &key,
+                                const cached_response &response) {
+  const std::size_t size = key.size() + response.body.size();
+  if (size > m_capacity / 8)
+    return;
+
+  std::scoped_lock lock(m_mutex);
+
+  if (auto itr = m_index.find(key); itr != m_index.end()) {
+    m_bytes -= itr->second->key.size() + itr->second->response.body.size();
+    m_entries.erase(itr->second);
+    m_index.erase(itr);
+  }
+
+  m_entries.push_front(entry{key, response});
+  m_index.emplace(key, m_entries.begin());
+  m_bytes += size;
+
+  while (m_bytes > m_capacity) {
+    const auto &last = m_entries.back();
+    m_bytes -= last.key.size() + last.response.body.size();
+    m_index.erase(last.key);
+    m_entries.pop_back();
+  }
+}
+
+std::size_t memory_response_cache::bytes() const {
+  std::scoped_lock lock(m_mutex);
+  return m_bytes;
+}
+
+std::size_t memory_response_cache::size() const {
+  std::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+std::shared_ptr<memory_response_cache>
+memory_response_cache::shared(std::size_t capacity) {
+  static std::mutex mutex;
+  static std::shared_ptr<memory_response_cache> cache;
+
+  if (capacity == 0)
+    return {};
+
+  std::scoped_lock lock(mutex);
+
+  if (!cache)
+    cache = std::make_shared<memory_response_cache>(capacity);
+
+  return cache;
+}
+
+namespace {
+
+std::shared_ptr<memory_response_cache>
+memory_cache_from_options(const boost::program_options::variables_map &options) {
+  if (!options.contains("response-cache-size"))
+    return {};
+
+  const auto size = options["response-cache-size"].as<int>();
+  if (size < 0)
+    throw std::runtime_error("Response cache size must not be negative.");
+
+  return memory_response_cache::shared(std::size_t(size) * 1024 * 1024);
+}
+
+std::string memcache_servers_from_options(
+    const boost::program_options::variables_map &options) {
+  if (!options.contains("response-cache-memcache") ||
+      !options.contains("memcache"))
+    return {};
+
+  return options["memcache"].as<std::string>();
+}
+
+} // anonymous namespace
+
+response_cache::response_cache(const boost::program_options::variables_map &options)
+    : response_cache(memory_cache_from_options(options),
+                     memcache_servers_from_options(options)) {}
+
+response_cache::response_cache(std::shared_ptr<memory_response_cache> memory,
+                               const std::string &memcache_servers)
+    : m_memory(std::move(memory)) {
+
+  if (memcache_servers.empty())
+    return;
+
+  if ((m_memcached = memcached_create(nullptr)) != nullptr) {
+
+    memcached_behavior_set(m_memcached, MEMCACHED_BEHAVIOR_NO_BLOCK, 1);
+    memcached_behavior_set(m_memcached, MEMCACHED_BEHAVIOR_BINARY_PROTOCOL, 1);
+
+    memcached_server_st *server_list = memcached_servers_parse(memcache_servers.c_str());
+    memcached_server_push(m_memcached, server_list);
+    memcached_server_list_free(server_list);
+  }
+}
+
+response_cache::~response_cache() {
+  if (m_memcached)
+    memcached_free(m_memcached);
+}
+
+bool response_cache::enabled() const {
+  return m_memory || m_memcached;
+}
+
+std::optional<cached_response> response_cache::get(const std::string &key) {
+  if (!enabled())
+    return {};
+
+  std::optional<cached_response> result;
+
+  if (m_memory && (result = m_memory->get(key))) {
+    ++memory_hits;
+  } else if ((result = get_shared(key))) {
+    ++shared_hits;
+    if (m_memory)
+      m_memory->put(key, *result);
+  } else {
+    ++misses;
+  }
+
+  log_statistics();
+  return result;
+}
+
+void response_cache::put(const std::string &key, const cached_response &response) {
+  if (!enabled())
+    return;
+
+  ++stores;
+
+  if (m_memory)
+    m_memory->put(key, response);
+
+  put_shared(key, response);
+}
+
+response_cache::statistics response_cache::get_statistics() {
+  return { memory_hits, shared_hits, misses, stores };
+}
+
+std::optional<cached_response> response_cache::get_shared(const std::string &key) {
+  if (!m_memcached)
+    return {};
+
+  // keys can be longer than memcached allows, so they're hashed
+  const auto mc_key = "cgimap:response:" + sha256_hex(key);
+
+  size_t length = 0;
+  uint32_t flags = 0;
+  memcached_return_t error{};
+
+  char *value = memcached_get(m_memcached, mc_key.data(), mc_key.size(),
+                              &length, &flags, &error);
+  if (value == nullptr)
+    return {};
+
+  cached_response result{std::string(value, length), flags};
+  free(value);
+
+  return result;
+}
+
+void response_cache::put_shared(const std::string &key, const cached_response &response) {
+  if (!m_memcached ||
+      response.body.size() > MEMCACHED_MAX_BODY ||
+      response.written > std::numeric_limits<uint32_t>::max())
+    return;
+
+  const auto mc_key = "cgimap:response:" + sha256_hex(key);
+
+  // the size before compression is kept in the flags
+  memcached_set(m_memcached, mc_key.data(), mc_key.size(),
+                response.body.data(), response.body.size(),
+                MEMCACHED_EXPIRATION, static_cast<uint32_t>(response.written));
+}
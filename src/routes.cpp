@@ -296,6 +296,10 @@ namespace {
       return {path.substr(0, path.length() - 4), application_xml};
   }
 
+  if (path.ends_with(".pbf")) {
+      return {path.substr(0, path.length() - 4), application_x_protobuf};
+  }
+
   return {path, unspecified_type};
 }
 
@@ -0,0 +1,33 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/sha256.hpp"
+
+#include <array>
+#include <iterator>
+#include <stdexcept>
+
+#include <fmt/core.h>
+#include <openssl/evp.h>
+
+std::string sha256_hex(std::string_view data) {
+  std::array<unsigned char, EVP_MAX_MD_SIZE> digest{};
+  unsigned int size = 0;
+
+  if (EVP_Digest(data.data(), data.size(), digest.data(), &size,
+                 EVP_sha256(), nullptr) != 1)
+    throw std::runtime_error("Failed to compute SHA-256 digest");
+
+  std::string hex;
+  hex.reserve(size * 2);
+  for (unsigned int i = 0; i < size; i++)
+    fmt::format_to(std::back_inserter(hex), "{:02x}", digest[i]);
+
+  return hex;
+}
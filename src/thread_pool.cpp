@@ -0,0 +1,85 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/thread_pool.hpp"
+
+#include <csignal>
+#include <stdexcept>
+
+#include <pthread.h>
+
+thread_pool::thread_pool(unsigned int threads) {
+
+  // threads inherit the signal mask of the thread creating them
+  sigset_t all;
+  sigset_t orig_mask;
+  sigfillset(&all);
+  if (pthread_sigmask(SIG_BLOCK, &all, &orig_mask) != 0) {
+    throw std::runtime_error("pthread_sigmask failed");
+  }
+
+  try {
+    for (unsigned int i = 0; i < threads; ++i) {
+      m_threads.emplace_back([this]() { run(); });
+    }
+  } catch (...) {
+    pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+    {
+      std::scoped_lock lock(m_mutex);
+      m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto &thread : m_threads) {
+      thread.join();
+    }
+    throw;
+  }
+
+  pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+void thread_pool::enqueue(std::function<void()> task) {
+  {
+    std::scoped_lock lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+}
+
+void thread_pool::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    // packaged tasks pass any exception on to their future
+    task();
+  }
+}
@@ -8,6 +8,7 @@
  */
 
 #include "cgimap/xml_formatter.hpp"
+#include "cgimap/options.hpp"
 
 #include <string>
 #include <utility>
@@ -125,6 +126,20 @@ void xml_formatter::write_node(const element_info &elem, double lon, double lat,
   writer->end();
 }
 
+void xml_formatter::write_node(const element_info &elem, const fixed_lonlat &lonlat,
+                               const tags_t &tags) {
+  writer->start("node");
+  write_common(elem);
+  if (elem.visible) {
+    const auto scale = global_settings::get_scale();
+    writer->attribute("lat", lonlat.lat, scale);
+    writer->attribute("lon", lonlat.lon, scale);
+  }
+  write_tags(tags);
+
+  writer->end();
+}
+
 void xml_formatter::write_way(const element_info &elem, const nodes_t &nodes,
                               const tags_t &tags) {
   writer->start("way");
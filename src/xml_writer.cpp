@@ -8,150 +8,213 @@
  */
 
 #include "cgimap/xml_writer.hpp"
+#include "cgimap/fixed_point.hpp"
+
+#include <cstdint>
+
+namespace {
+
+enum escape_flags : uint8_t {
+  escape_text = 1,
+  escape_attribute = 2
+};
+
+// characters which have to be replaced by an entity, in the same way as
+// libxml2 does it: attribute values also escape whitespace other than
+// spaces, so that it survives attribute value normalisation.
+constexpr std::array<uint8_t, 256> escape_table = [] {
+  std::array<uint8_t, 256> table{};
+  table['&'] = escape_text | escape_attribute;
+  table['<'] = escape_text | escape_attribute;
+  table['>'] = escape_text | escape_attribute;
+  table['"'] = escape_text | escape_attribute;
+  table['\r'] = escape_text | escape_attribute;
+  table['\n'] = escape_attribute;
+  table['\t'] = escape_attribute;
+  return table;
+}();
+
+std::string_view entity(char c) {
+  switch (c) {
+  case '&': return "&amp;";
+  case '<': return "&lt;";
+  case '>': return "&gt;";
+  case '"': return "&quot;";
+  case '\r': return "&#13;";
+  case '\n': return "&#10;";
+  case '\t': return "&#9;";
+  default: return {};
+  }
+}
 
-#include <array>
-#include <stdexcept>
-
-#include <fmt/core.h>
-#include <fmt/compile.h>
+} // anonymous namespace
 
-// C-style callback functions are called from xmlOutputBufferCreateIO.
-// Functions cannot throw, return -1 if an error occurred.
-static int wrap_write(void *context, const char *buffer, int len) noexcept {
-  auto *out = static_cast<output_buffer *>(context);
+// create a new XML writer using writer callback functions
+xml_writer::xml_writer(output_buffer &o, bool indent_)
+  : out(o), indent(indent_) {
 
-  if (out == nullptr) {
-    return -1;
-  }
+  buffer.reserve(BUFFER_SIZE + 4096);
 
-  return out->write(buffer, len);
+  // start the document
+  buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 }
 
-static int wrap_close(void *context) noexcept {
-  auto *out = static_cast<output_buffer *>(context);
+xml_writer::~xml_writer() noexcept {
+  // close and flush the xml writer object. note - if this fails then
+  // there isn't much we can do, as this object is going to be deleted
+  // anyway.
+  try {
+    while (!elements.empty())
+      end();
 
-  if (out == nullptr) {
-    return -1;
-  }
+    if (!indent)
+      buffer += '\n';
 
-  return out->close();
+    write_buffer();
+  } catch (...) {
+    // nothing to do here
+  }
+  out.close();
 }
 
-static void callback_generic_error(void* ctx, const char* msg, ...)
-{
-  // we can't do much with the error here, in particular we don't want to write it to stderr.
-  // xml_writer methods still get an rc=-1 from libxml2 functions and throw an exception.
-  // so nothing to do here...
+void xml_writer::close_start_tag() {
+  if (!elements.empty() && elements.back().in_start_tag) {
+    buffer += '>';
+    elements.back().in_start_tag = false;
+  }
 }
 
-// create a new XML writer using writer callback functions
-xml_writer::xml_writer(output_buffer &out, bool indent) {
-  xmlOutputBufferPtr output_buffer =
-      xmlOutputBufferCreateIO(wrap_write, wrap_close, &out, nullptr);
-
-  // set our own error handler (xmlpp::parser.cpp also calls this function, and we may be
-  // left with a non-functioning xmlpp error handler if we don't define our own here)
-  xmlSetGenericErrorFunc(output_buffer->context, &callback_generic_error);
-
-  // allocate a writer using the output buffer object
-  writer = xmlNewTextWriter(output_buffer);
-
-  // check the return value
-  if (writer == nullptr) {
-    // free the output buffer
-    free(output_buffer);
+void xml_writer::write_indent() {
+  // one space per level, the root element isn't indented
+  buffer.append(elements.size() - 1, ' ');
+}
 
-    throw std::runtime_error("error creating xml writer.");
+void xml_writer::start(const char *name) {
+  if (!elements.empty() && elements.back().in_start_tag) {
+    close_start_tag();
+    if (indent)
+      buffer += '\n';
   }
 
-  // maybe enable indenting
-  if (indent) {
-    xmlTextWriterSetIndent(writer, 1);
-  }
+  elements.push_back({name, true});
 
-  // start the document
-  if (xmlTextWriterStartDocument(writer, nullptr, "UTF-8", nullptr) < 0) {
-    throw write_error("error creating document element.");
-  }
-}
+  if (indent)
+    write_indent();
 
+  buffer += '<';
+  buffer += name;
+}
 
-xml_writer::~xml_writer() noexcept {
-  // close and flush the xml writer object. note - if this fails then
-  // there isn't much we can do, as this object is going to be deleted
-  // anyway.
+void xml_writer::write_attribute_raw(const char *name, std::string_view value) {
+  if (elements.empty() || !elements.back().in_start_tag)
+    throw write_error("cannot write attribute.");
 
-  xmlTextWriterEndDocument(writer);
-  xmlFreeTextWriter(writer);
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  buffer += value;
+  buffer += '"';
 }
 
-void xml_writer::start(const char *name) {
-  if (xmlTextWriterStartElement(writer, reinterpret_cast<const xmlChar *>(name)) < 0) {
-    throw write_error("cannot start element.");
+void xml_writer::write_escaped(std::string_view s, bool attribute) {
+  const uint8_t mask = attribute ? escape_attribute : escape_text;
+
+  auto run_start = s.begin();
+  for (auto it = s.begin(); it != s.end(); ++it) {
+    if (escape_table[static_cast<unsigned char>(*it)] & mask) {
+      buffer.append(run_start, it);
+      buffer += entity(*it);
+      run_start = it + 1;
+    }
   }
+  buffer.append(run_start, s.end());
 }
 
 void xml_writer::attribute(const char *name, const std::string &value) {
-  int rc = writeAttribute(name, value.c_str());
-  if (rc < 0) {
+  if (elements.empty() || !elements.back().in_start_tag)
     throw write_error("cannot write attribute.");
-  }
+
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  write_escaped(value, true);
+  buffer += '"';
 }
 
 void xml_writer::attribute(const char *name, const char *value) {
-  const char *c_str = value ? value : "";
-  int rc = writeAttribute(name, c_str);
-  if (rc < 0) {
+  if (elements.empty() || !elements.back().in_start_tag)
     throw write_error("cannot write attribute.");
-  }
+
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  if (value)
+    write_escaped(value, true);
+  buffer += '"';
 }
 
 void xml_writer::attribute(const char *name, double value) {
-  const char* str = nullptr;
-
-#if FMT_VERSION >= 90000
-  std::array<char, 384> buf;
-  constexpr size_t max_chars = buf.size() - 1;
-  auto [end, n_written] = fmt::format_to_n(buf.begin(), max_chars, FMT_COMPILE("{:.7f}"), value);
-  if (n_written > max_chars)
-    throw write_error("cannot convert double-precision attribute to string.");
-  *end = '\0'; // Null terminate string
-  str = buf.data();
-#else
-  auto s = fmt::format("{:.7f}", value);
-  str = s.c_str();
-#endif
-
-  int rc = writeAttribute(name, str);
-  if (rc < 0) {
-    throw write_error("cannot write double-precision attribute.");
-  }
+  fixed_point_buffer buf;
+  write_attribute_raw(name, format_fixed_point(buf, value));
+}
+
+void xml_writer::attribute(const char *name, int64_t value, int64_t scale) {
+  fixed_point_buffer buf;
+  write_attribute_raw(name, format_fixed_point(buf, value, scale));
 }
 
 void xml_writer::attribute(const char *name, bool value) {
-  const char *str = value ? "true" : "false";
-  int rc = writeAttribute(name, str);
-  if (rc < 0) {
-    throw write_error("cannot write boolean attribute.");
-  }
+  write_attribute_raw(name, value ? "true" : "false");
 }
 
 void xml_writer::text(const char* t) {
-  if (xmlTextWriterWriteString(writer, reinterpret_cast<const xmlChar *>(t)) < 0) {
-    throw write_error("cannot write text string.");
-  }
+  close_start_tag();
+  write_escaped(t, false);
+
+  if (indent)
+    indent_end_tag = false;
 }
 
 void xml_writer::end() {
-  if (xmlTextWriterEndElement(writer) < 0) {
+  if (elements.empty())
     throw write_error("cannot end element.");
+
+  auto &element = elements.back();
+
+  if (element.in_start_tag) {
+    buffer += "/>";
+  } else {
+    if (indent && indent_end_tag)
+      write_indent();
+
+    buffer += "</";
+    buffer += element.name;
+    buffer += '>';
+  }
+
+  if (indent) {
+    buffer += '\n';
+    indent_end_tag = true;
   }
+
+  elements.pop_back();
+
+  if (buffer.size() >= BUFFER_SIZE)
+    write_buffer();
+}
+
+void xml_writer::write_buffer() {
+  if (buffer.empty())
+    return;
+
+  if (out.write(buffer.data(), buffer.size()) < 0)
+    throw write_error("cannot write to output stream");
+
+  buffer.clear();
 }
 
 void xml_writer::flush() {
-  if (xmlTextWriterFlush(writer) < 0) {
-    throw write_error("cannot flush output stream");
-  }
+  write_buffer();
 }
 
 void xml_writer::error(const std::string &s) {
@@ -159,12 +222,3 @@ void xml_writer::error(const std::string &s) {
   text(s);
   end();
 }
-
-int xml_writer::writeAttribute(const char* name, const char* value) {
-  int rc = xmlTextWriterWriteAttribute(
-    writer,
-    reinterpret_cast<const xmlChar *>(name),
-    reinterpret_cast<const xmlChar *>(value));
-  return rc;
-}
-
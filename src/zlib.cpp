@@ -8,15 +8,15 @@
  */
 
 #include <cassert>
-#include <algorithm>
-#include <cstring>
+#include <new>
 
 #include "cgimap/zlib.hpp"
 #include "cgimap/logger.hpp"
 #include "cgimap/output_writer.hpp"
 
 zlib_output_buffer::zlib_output_buffer(output_buffer& o,
-                                       zlib_output_buffer::mode m)
+                                       zlib_output_buffer::mode m,
+                                       int level)
     : out(o), bytes_in(0) {
   int windowBits;
 
@@ -33,7 +33,7 @@ zlib_output_buffer::zlib_output_buffer(output_buffer& o,
   stream.zfree = Z_NULL;
   stream.opaque = Z_NULL;
 
-  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8,
+  if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8,
                    Z_DEFAULT_STRATEGY) != Z_OK) {
     throw output_writer::write_error("deflateInit2 failed");
   }
@@ -126,64 +126,42 @@ ZLibBaseDecompressor::ZLibBaseDecompressor(int windowBits) {
   if (inflateInit2(&stream, windowBits) != Z_OK) {
     throw std::bad_alloc();
   }
-  use_decompression = true;
 }
 
 ZLibBaseDecompressor::~ZLibBaseDecompressor() {
-  if (use_decompression)
-    inflateEnd(&stream);
+  inflateEnd(&stream);
 }
 
-std::string ZLibBaseDecompressor::decompress(const std::string& input) {
-
-  std::string result;
-
-  if (!use_decompression)
-    return input;
-
-  for (std::size_t offset = 0; offset < input.length(); offset += ZLIB_COMPLETE_CHUNK) {
-
-    unsigned int bytes_left = input.length() - offset;
-    unsigned int bytes_wanted = std::min(ZLIB_COMPLETE_CHUNK, bytes_left);
-
-    std::memcpy(inbuf, input.data() + offset, bytes_wanted);
-
-    stream.avail_in = bytes_wanted;
-    stream.next_in = (Bytef *) inbuf;
-
-    if (stream.avail_in == 0) {
-      break;
+void ZLibBaseDecompressor::decompress(std::string_view input, const sink_t &sink) {
+
+  if (input.empty())
+    return;
+
+  // zlib never writes to the input, next_in isn't const for historic reasons only
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+  stream.avail_in = input.size();
+
+  do {
+    stream.avail_out = ZLIB_COMPLETE_CHUNK;
+    stream.next_out = reinterpret_cast<Bytef *>(outbuf);
+    int ret = inflate(&stream, Z_NO_FLUSH);
+    assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+    switch (ret) {
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+        throw decompression_error("Zlib decompression failed");
     }
 
-    do {
-      stream.avail_out = ZLIB_COMPLETE_CHUNK;
-      stream.next_out = (Bytef *) outbuf;
-      int ret = inflate(&stream, Z_NO_FLUSH);
-      assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-      switch (ret) {
-      case Z_NEED_DICT:
-          ret = Z_DATA_ERROR;
-          [[fallthrough]];
-          /* no break */
-      case Z_DATA_ERROR:
-      case Z_MEM_ERROR:
-          inflateEnd(&stream);
-          throw std::runtime_error("Zlib decompression failed");
-      }
-
-      unsigned int have = ZLIB_COMPLETE_CHUNK - stream.avail_out;
-      result += std::string(outbuf, have);
-    } while (stream.avail_out == 0);
-  }
-  return result;
+    unsigned int have = ZLIB_COMPLETE_CHUNK - stream.avail_out;
+    if (have > 0)
+      sink(std::string_view(outbuf, have));
+  } while (stream.avail_out == 0);
+
+  stream.next_in = Z_NULL;
+  stream.avail_in = 0;
 }
 
 GZipDecompressor::GZipDecompressor() : ZLibBaseDecompressor(15+16) { }
 
 ZLibDecompressor::ZLibDecompressor() : ZLibBaseDecompressor(15) { }
-
-IdentityDecompressor::IdentityDecompressor() : ZLibBaseDecompressor() { }
-
-
-
-
@@ -0,0 +1,131 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#if HAVE_ZSTD
+
+#include "cgimap/zstd.hpp"
+#include "cgimap/logger.hpp"
+
+#include <new>
+
+#include <fmt/core.h>
+
+namespace {
+
+// RFC 9659 limits the window size of the zstd Content-Encoding to 8 MB,
+// which also bounds the memory a single request may use for decoding.
+constexpr int zstd_window_log_max = 23;
+
+}
+
+zstd_output_buffer::zstd_output_buffer(output_buffer& o, int level)
+    : out(o), ctx(ZSTD_createCCtx()) {
+
+  if (ctx == nullptr)
+    throw std::bad_alloc();
+
+  ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level);
+
+  // levels above 19 use larger windows than clients have to support
+  if (level > 19)
+    ZSTD_CCtx_setParameter(ctx, ZSTD_c_windowLog, zstd_window_log_max);
+}
+
+zstd_output_buffer::~zstd_output_buffer() {
+  ZSTD_freeCCtx(ctx);
+}
+
+int zstd_output_buffer::compress(const char *data, std::size_t len,
+                                 ZSTD_EndDirective mode) noexcept {
+
+  ZSTD_inBuffer in{ data, len, 0 };
+
+  while (true) {
+    ZSTD_outBuffer o{ outbuf, sizeof(outbuf), 0 };
+
+    const auto remaining = ZSTD_compressStream2(ctx, &o, &in, mode);
+    if (ZSTD_isError(remaining)) {
+      logger::message(fmt::format("Zstandard compression failed: {}",
+                                  ZSTD_getErrorName(remaining)));
+      return -1;
+    }
+
+    if (o.pos > 0 && out.write(outbuf, o.pos) < 0)
+      return -1;
+
+    // when flushing or ending the frame, zstd may have more output
+    // buffered than fits in outbuf.
+    if (mode == ZSTD_e_continue ? in.pos == in.size : remaining == 0)
+      break;
+  }
+
+  return static_cast<int>(len);
+}
+
+int zstd_output_buffer::write(const char *buffer, int len) noexcept {
+  if (len < 0)
+    return -1;
+
+  const int rc = compress(buffer, len, ZSTD_e_continue);
+  if (rc > 0)
+    bytes_in += rc;
+
+  return rc;
+}
+
+int zstd_output_buffer::written() const { return bytes_in; }
+
+int zstd_output_buffer::close() noexcept {
+  if (compress(nullptr, 0, ZSTD_e_end) < 0)
+    return -1;
+
+  return out.close();
+}
+
+int zstd_output_buffer::flush() noexcept {
+  if (compress(nullptr, 0, ZSTD_e_flush) < 0)
+    return -1;
+
+  return out.flush();
+}
+
+ZstdDecompressor::ZstdDecompressor() : ctx(ZSTD_createDCtx()) {
+
+  if (ctx == nullptr)
+    throw std::bad_alloc();
+
+  ZSTD_DCtx_setParameter(ctx, ZSTD_d_windowLogMax, zstd_window_log_max);
+}
+
+ZstdDecompressor::~ZstdDecompressor() {
+  ZSTD_freeDCtx(ctx);
+}
+
+void ZstdDecompressor::decompress(std::string_view input, const sink_t &sink) {
+
+  ZSTD_inBuffer in{ input.data(), input.size(), 0 };
+
+  // a full output buffer may leave data buffered inside the context,
+  // keep going until zstd returns with spare output space.
+  ZSTD_outBuffer out{ outbuf, sizeof(outbuf), sizeof(outbuf) };
+
+  while (in.pos < in.size || out.pos == out.size) {
+    out.pos = 0;
+
+    auto ret = ZSTD_decompressStream(ctx, &out, &in);
+    if (ZSTD_isError(ret))
+      throw decompression_error(fmt::format("Zstandard decompression failed: {}",
+                                            ZSTD_getErrorName(ret)));
+
+    if (out.pos > 0)
+      sink(std::string_view(outbuf, out.pos));
+  }
+}
+
+#endif
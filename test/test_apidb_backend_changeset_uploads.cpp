@@ -2043,6 +2043,100 @@ TEST_CASE_METHOD( DatabaseTestsFixture, "test_changeset_update", "[changeset][up
   }
 }
 
+TEST_CASE_METHOD( DatabaseTestsFixture, "test_deferred_statements", "[changeset][upload][db]" ) {
+
+  // a fresh connection, so that none of the statements are prepared yet
+  auto factory = tdb.get_new_data_update_factory();
+  auto txn = factory->get_default_transaction();
+  Transaction_Manager m(*txn);
+
+  m.exec("CREATE TEMPORARY TABLE deferred_test (id bigint PRIMARY KEY, value text) ON COMMIT DROP");
+  m.exec("INSERT INTO deferred_test (id, value) VALUES (1, 'initial')");
+
+  m.prepare("deferred_test_insert", "INSERT INTO deferred_test (id, value) VALUES ($1, $2)");
+  m.prepare("deferred_test_update", "UPDATE deferred_test SET value = $2 WHERE id = $1");
+  m.prepare("deferred_test_delete", "DELETE FROM deferred_test WHERE id = $1");
+  m.prepare("deferred_test_select", "SELECT value FROM deferred_test WHERE id = $1");
+
+  const auto one_row = [](const pqxx::result &r) {
+    if (r.affected_rows() != 1)
+      throw http::conflict("deferred_test row not found");
+  };
+
+  SECTION("Deferred statements run before a later prepared statement") {
+    m.exec_prepared_deferred("deferred_test_update", one_row, 1, "updated");
+    m.exec_prepared_deferred("deferred_test_insert", {}, 2, "inserted");
+
+    auto r1 = m.exec_prepared("deferred_test_select", 1);
+    REQUIRE(r1.size() == 1);
+    REQUIRE(r1[0][0].as<std::string>() == "updated");
+
+    auto r2 = m.exec_prepared("deferred_test_select", 2);
+    REQUIRE(r2.size() == 1);
+    REQUIRE(r2[0][0].as<std::string>() == "inserted");
+  }
+
+  SECTION("Deferred statements run before a later query") {
+    m.exec_prepared_deferred("deferred_test_delete", one_row, 1);
+
+    auto r = m.exec("SELECT count(*) FROM deferred_test");
+    REQUIRE(r[0][0].as<int>() == 0);
+  }
+
+#if PQXX_VERSION_MAJOR >= 7
+  SECTION("Deferred statements run before a later stream") {
+    // the row copied below would violate the primary key if it was
+    // still there.
+    m.exec_prepared_deferred("deferred_test_delete", one_row, 1);
+
+    {
+      auto stream = m.to_stream("deferred_test", "id, value");
+      stream.write_values(1, "streamed");
+      stream.complete();
+    }
+
+    auto r = m.exec_prepared("deferred_test_select", 1);
+    REQUIRE(r.size() == 1);
+    REQUIRE(r[0][0].as<std::string>() == "streamed");
+  }
+#endif
+
+  SECTION("Failing checks are raised when the statements are flushed") {
+    REQUIRE_NOTHROW(m.exec_prepared_deferred("deferred_test_update", one_row, 42, "missing"));
+    REQUIRE_THROWS_AS(m.flush(), http::conflict);
+  }
+
+  SECTION("Failing checks are raised with the result of a later statement") {
+    m.exec_prepared_deferred("deferred_test_delete", one_row, 42);
+    REQUIRE_THROWS_AS(m.exec_prepared("deferred_test_select", 1), http::conflict);
+  }
+
+  SECTION("Planner settings are applied to deferred statements") {
+    m.prepare("deferred_test_insert_setting",
+              "INSERT INTO deferred_test (id, value) VALUES ($1, current_setting('enable_mergejoin'))",
+              {{"enable_mergejoin", "off"}});
+
+    m.exec_prepared_deferred("deferred_test_insert_setting", {}, 2);
+    m.flush();
+
+    auto r = m.exec_prepared("deferred_test_select", 2);
+    REQUIRE(r.size() == 1);
+    REQUIRE(r[0][0].as<std::string>() == "off");
+  }
+
+  SECTION("Planner settings are reset for statements which don't declare them") {
+    m.prepare("deferred_test_mergejoin_off", "SELECT current_setting('enable_mergejoin')",
+              {{"enable_mergejoin", "off"}});
+    m.prepare("deferred_test_mergejoin", "SELECT current_setting('enable_mergejoin')");
+
+    REQUIRE(m.exec_prepared("deferred_test_mergejoin_off")[0][0].as<std::string>() == "off");
+    REQUIRE(m.exec_prepared("deferred_test_mergejoin")[0][0].as<std::string>() == "on");
+
+    REQUIRE(m.exec_prepared("deferred_test_mergejoin_off")[0][0].as<std::string>() == "off");
+    REQUIRE(m.exec("SELECT current_setting('enable_mergejoin')")[0][0].as<std::string>() == "on");
+  }
+}
+
 TEST_CASE_METHOD( DatabaseTestsFixture, "test_osmchange_message", "[changeset][upload][db]" ) {
 
   SECTION("Initialize test data") {
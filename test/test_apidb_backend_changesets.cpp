@@ -17,6 +17,7 @@
 #include <cstdio>
 
 #include "cgimap/time.hpp"
+#include "cgimap/backend/apidb/changeset_cache.hpp"
 #include "cgimap/rate_limiter.hpp"
 #include "cgimap/routes.hpp"
 #include "cgimap/process_request.hpp"
@@ -70,6 +71,52 @@ CATCH_REGISTER_LISTENER( CGImapListener )
 
 
 
+TEST_CASE( "changeset_cache", "[changeset][nodb]" ) {
+
+  using namespace std::chrono_literals;
+
+  changeset_cache cache(2, 60s);
+  const auto now = changeset_cache::clock::now();
+  std::map<osm_changeset_id_t, changeset> cc;
+
+  cache.insert(1, changeset{true, "user_1", 1}, now);
+  cache.insert(2, changeset{false, "user_2", 2}, now);
+
+  SECTION("Lookup returns cached entries and missing ids") {
+    auto missing = cache.lookup({1, 2, 3}, cc, now);
+    CHECK(missing == std::vector<osm_changeset_id_t>{3});
+    REQUIRE(cc.size() == 2);
+    CHECK(cc[1].display_name == "user_1");
+    CHECK(cc[2].data_public == false);
+  }
+
+  SECTION("Least recently used entry is evicted") {
+    // touch 1, so that 2 is evicted when inserting 3
+    cache.lookup({1}, cc, now);
+    cache.insert(3, changeset{true, "user_3", 3}, now);
+    CHECK(cache.size() == 2);
+    CHECK(cache.lookup({1, 2, 3}, cc, now) == std::vector<osm_changeset_id_t>{2});
+  }
+
+  SECTION("Entries expire") {
+    CHECK(cache.lookup({1, 2}, cc, now + 59s).empty());
+    CHECK(cache.lookup({1, 2}, cc, now + 60s) == std::vector<osm_changeset_id_t>{1, 2});
+    CHECK(cache.size() == 0);
+  }
+
+  SECTION("Clear") {
+    cache.clear();
+    CHECK(cache.size() == 0);
+  }
+
+  SECTION("Insert replaces existing entries") {
+    cache.insert(1, changeset{true, "renamed", 1}, now);
+    cache.lookup({1}, cc, now);
+    CHECK(cc[1].display_name == "renamed");
+    CHECK(cache.size() == 2);
+  }
+}
+
 TEST_CASE_METHOD( DatabaseTestsFixture, "test_negative_changeset_ids", "[changeset][db]" ) {
 
   auto sel = tdb.get_data_selection();
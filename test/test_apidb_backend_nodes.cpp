@@ -7,18 +7,29 @@
  * For a full list of authors see the git log.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <stdexcept>
+#include <tuple>
 #include <fmt/core.h>
 
 #include <sys/time.h>
 #include <cstdio>
 
+#include "cgimap/backend/apidb/id_set.hpp"
+#include "cgimap/backend/apidb/map_tile_cache.hpp"
+#include "cgimap/backend/apidb/quad_tile.hpp"
+#include "cgimap/backend/apidb/readonly_pgsql_selection.hpp"
 #include "cgimap/backend/apidb/utils.hpp"
+#include "cgimap/bbox.hpp"
+#include "cgimap/time.hpp"
 
 #include "test_formatter.hpp"
 #include "test_database.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/reporters/catch_reporter_event_listener.hpp>
 #include <catch2/reporters/catch_reporter_registrars.hpp>
 #include <catch2/catch_session.hpp>
@@ -183,6 +194,266 @@ TEST_CASE_METHOD( DatabaseTestsFixture, "test_dup_nodes", "[nodes][db]" ) {
   }
 }
 
+TEST_CASE_METHOD( DatabaseTestsFixture, "test_selection_version", "[nodes][db]" ) {
+
+  auto sel = tdb.get_data_selection();
+
+  SECTION("Initialize test data") {
+    tdb.run_sql(
+      "INSERT INTO users (id, email, pass_crypt, creation_time, display_name, data_public) "
+      "VALUES "
+      "  (1, 'user_1@example.com', '', '2013-11-14T02:10:00Z', 'user_1', true); "
+
+      "INSERT INTO changesets (id, user_id, created_at, closed_at) "
+      "VALUES "
+      "  (1, 1, '2013-11-14T02:10:00Z', '2013-11-14T03:10:00Z');"
+
+      "INSERT INTO current_nodes (id, latitude, longitude, changeset_id, visible, \"timestamp\", tile, version) "
+      " VALUES "
+      "  (1,       0,       0, 1, true,  '2013-11-14T02:10:00Z', 3221225472, 1), "
+      "  (2, 1000000, 1000000, 1, true,  '2013-11-14T02:10:01Z', 3221227032, 2);"
+
+      "INSERT INTO nodes (node_id, latitude, longitude, changeset_id, visible, \"timestamp\", tile, version) "
+      " VALUES "
+      "  (2,       0,       0, 1, true,  '2013-11-14T02:10:00Z', 3221225472, 1), "
+      "  (2, 1000000, 1000000, 1, true,  '2013-11-14T02:10:01Z', 3221227032, 2);"
+      );
+  }
+
+  SECTION("Check selection versions") {
+
+    // nothing selected, nothing to compare
+    REQUIRE_FALSE(sel->get_selection_version());
+
+    REQUIRE(sel->select_nodes({1}) == 1);
+    const auto first = sel->get_selection_version();
+    REQUIRE(first);
+    CHECK(first->last_modified == parse_time("2013-11-14T02:10:00Z"));
+    CHECK(sel->get_selection_version()->digest == first->digest);
+
+    REQUIRE(sel->select_nodes({2}) == 1);
+    const auto second = sel->get_selection_version();
+    REQUIRE(second);
+    CHECK(second->digest != first->digest);
+    CHECK(second->last_modified == parse_time("2013-11-14T02:10:01Z"));
+
+    // the names of the users are written out, so renaming them counts
+    tdb.run_sql("UPDATE users SET display_name = 'user_renamed' WHERE id = 1");
+    CHECK(sel->get_selection_version()->digest != second->digest);
+  }
+
+  SECTION("Check historic selection versions") {
+
+    REQUIRE(sel->select_historical_nodes({{2, 1}}) == 1);
+    const auto old = sel->get_selection_version();
+    REQUIRE(old);
+    CHECK(old->last_modified == parse_time("2013-11-14T02:10:00Z"));
+
+    REQUIRE(sel->select_historical_nodes({{2, 2}}) == 1);
+    CHECK(sel->get_selection_version()->digest != old->digest);
+  }
+}
+
+TEST_CASE_METHOD( DatabaseTestsFixture, "test_map_closure", "[nodes][db]" ) {
+
+  auto sel = tdb.get_data_selection();
+  auto sel_ref = tdb.get_data_selection();
+
+  SECTION("Initialize test data") {
+    tdb.run_sql(R"(
+      INSERT INTO users (id, email, pass_crypt, creation_time, display_name, data_public)
+      VALUES (1, 'user_1@example.com', '', '2013-11-14T02:10:00Z', 'user_1', true);
+
+      INSERT INTO changesets (id, user_id, created_at, closed_at)
+      VALUES (1, 1, '2013-11-14T02:10:00Z', '2013-11-14T03:10:00Z');
+
+      INSERT INTO current_nodes (id, latitude, longitude, changeset_id, visible, "timestamp", tile, version)
+      VALUES (1,        0,        0, 1, true, '2013-11-14T02:10:00Z', 3221225472, 1),
+             (2, 10000000, 10000000, 1, true, '2013-11-14T02:10:00Z', 3229120149, 1),
+             (3, 20000000, 20000000, 1, true, '2013-11-14T02:10:00Z', 3254451616, 1);
+
+      INSERT INTO current_ways (id, changeset_id, "timestamp", visible, version)
+      VALUES (1, 1, '2013-11-14T02:10:00Z', true, 1),
+             (2, 1, '2013-11-14T02:10:00Z', true, 1);
+
+      INSERT INTO current_way_nodes (way_id, node_id, sequence_id)
+      VALUES (1, 1, 1), (1, 2, 2), (2, 2, 1), (2, 3, 2);
+
+      INSERT INTO current_relations (id, changeset_id, "timestamp", visible, version)
+      VALUES (1, 1, '2013-11-14T02:10:00Z', true, 1),
+             (2, 1, '2013-11-14T02:10:00Z', true, 1),
+             (3, 1, '2013-11-14T02:10:00Z', true, 1),
+             (4, 1, '2013-11-14T02:10:00Z', true, 1);
+
+      INSERT INTO current_relation_members (relation_id, member_type, member_id, member_role, sequence_id)
+      VALUES (1, 'Node', 2, '', 1),
+             (2, 'Relation', 1, '', 1),
+             (3, 'Way', 1, '', 1),
+             (4, 'Node', 3, '', 1);
+      )"
+    );
+  }
+
+  SECTION("Closure matches individual selections") {
+
+    const bbox b(-0.1, -0.1, 0.1, 0.1);
+
+    REQUIRE(sel->select_map_closure(b, 100) == 1);
+    REQUIRE(sel_ref->data_selection::select_map_closure(b, 100) == 1);
+
+    test_formatter f;
+    sel->write_nodes(f);
+    sel->write_ways(f);
+    sel->write_relations(f);
+
+    test_formatter f_ref;
+    sel_ref->write_nodes(f_ref);
+    sel_ref->write_ways(f_ref);
+    sel_ref->write_relations(f_ref);
+
+    REQUIRE(f.m_nodes.size() == 2);
+    REQUIRE(f.m_ways.size() == 1);
+    REQUIRE(f.m_relations.size() == 3);
+
+    REQUIRE(f.m_nodes == f_ref.m_nodes);
+    REQUIRE(f.m_ways == f_ref.m_ways);
+    REQUIRE(f.m_relations == f_ref.m_relations);
+  }
+
+  SECTION("No closure when exceeding the node limit") {
+
+    const bbox b(-0.1, -0.1, 0.1, 0.1);
+
+    REQUIRE(sel->select_map_closure(b, 0) == 1);
+
+    test_formatter f;
+    sel->write_ways(f);
+    sel->write_relations(f);
+
+    REQUIRE(f.m_ways.empty());
+    REQUIRE(f.m_relations.empty());
+  }
+}
+
+TEST_CASE_METHOD( DatabaseTestsFixture, "test_map_tile_cache", "[nodes][db]" ) {
+
+  auto cache = std::make_shared<map_tile_cache>(100, std::chrono::seconds(600),
+                                                std::chrono::seconds(600));
+  auto factory = tdb.get_data_selection_factory();
+
+  // selects the closure of the bbox in a new transaction, so that changes
+  // made in the meantime are visible.
+  auto select = [&](test_formatter &f) {
+    auto txn = factory->get_default_transaction();
+    readonly_pgsql_selection sel(*txn, {}, {}, cache);
+
+    const int num_nodes = sel.select_map_closure(bbox(-0.1, -0.1, 0.1, 0.1), 100);
+    sel.write_nodes(f);
+    sel.write_ways(f);
+    sel.write_relations(f);
+    return num_nodes;
+  };
+
+  tdb.run_sql(R"(
+    INSERT INTO users (id, email, pass_crypt, creation_time, display_name, data_public)
+    VALUES (1, 'user_1@example.com', '', '2013-11-14T02:10:00Z', 'user_1', true);
+
+    INSERT INTO changesets (id, user_id, created_at, closed_at)
+    VALUES (1, 1, '2013-11-14T02:10:00Z', '2013-11-14T03:10:00Z');
+
+    INSERT INTO current_nodes (id, latitude, longitude, changeset_id, visible, "timestamp", tile, version)
+    VALUES (1,        0,        0, 1, true, '2013-11-14T02:10:00Z', 3221225472, 1),
+           (2, 10000000, 10000000, 1, true, '2013-11-14T02:10:00Z', 3229120149, 1),
+           (3, 20000000, 20000000, 1, true, '2013-11-14T02:10:00Z', 3254451616, 1);
+
+    INSERT INTO current_ways (id, changeset_id, "timestamp", visible, version)
+    VALUES (1, 1, '2013-11-14T02:10:00Z', true, 1),
+           (2, 1, '2013-11-14T02:10:00Z', true, 1);
+
+    INSERT INTO current_way_nodes (way_id, node_id, sequence_id)
+    VALUES (1, 1, 1), (1, 2, 2), (2, 2, 1), (2, 3, 2);
+
+    INSERT INTO current_relations (id, changeset_id, "timestamp", visible, version)
+    VALUES (1, 1, '2013-11-14T02:10:00Z', true, 1),
+           (2, 1, '2013-11-14T02:10:00Z', true, 1),
+           (3, 1, '2013-11-14T02:10:00Z', true, 1),
+           (4, 1, '2013-11-14T02:10:00Z', true, 1);
+
+    INSERT INTO current_relation_members (relation_id, member_type, member_id, member_role, sequence_id)
+    VALUES (1, 'Node', 2, '', 1),
+           (2, 'Relation', 1, '', 1),
+           (3, 'Way', 1, '', 1),
+           (4, 'Node', 3, '', 1);
+    )"
+  );
+
+  // node 1 is in a block well inside the bbox
+  REQUIRE_FALSE(tile_blocks_for_area(-0.1, -0.1, 0.1, 0.1, 2, 5, 2).empty());
+
+  for (int i = 0; i < 2; ++i) {
+    test_formatter f;
+    REQUIRE(select(f) == 1);
+    REQUIRE(f.m_nodes.size() == 2);
+    REQUIRE(f.m_ways.size() == 1);
+    REQUIRE(f.m_relations.size() == 3);
+  }
+  REQUIRE(cache->size() > 0);
+
+  // a node added without touching any changeset's bbox isn't noticed, which
+  // shows that the closure came from the cache.
+  tdb.run_sql(fmt::format(R"(
+    INSERT INTO current_nodes (id, latitude, longitude, changeset_id, visible, "timestamp", tile, version)
+    VALUES (4, 100000, 100000, 1, true, '2013-11-14T02:10:00Z', {}, 1);
+    )", xy2tile(lon2x(0.01), lat2y(0.01))));
+
+  {
+    test_formatter f;
+    REQUIRE(select(f) == 1);
+    REQUIRE(f.m_nodes.size() == 2);
+  }
+
+  // an open changeset which was last edited before the closure was selected
+  // doesn't count as edited, even though it hasn't been closed yet.
+  tdb.run_sql(R"(
+    INSERT INTO changesets (id, user_id, created_at, closed_at, min_lat, max_lat, min_lon, max_lon)
+    VALUES (3, 1, now() at time zone 'utc' - interval '1 hour',
+            now() at time zone 'utc' + interval '30 minutes',
+            100000, 100000, 100000, 100000);
+    )"
+  );
+
+  {
+    test_formatter f;
+    REQUIRE(select(f) == 1);
+    REQUIRE(f.m_nodes.size() == 2);
+  }
+
+  // once a changeset overlapping the block has been edited, the closure is
+  // selected again.
+  tdb.run_sql(R"(
+    INSERT INTO changesets (id, user_id, created_at, closed_at, min_lat, max_lat, min_lon, max_lon)
+    VALUES (2, 1, now() at time zone 'utc', now() at time zone 'utc' + interval '1 hour',
+            100000, 100000, 100000, 100000);
+    )"
+  );
+
+  {
+    test_formatter f;
+    REQUIRE(select(f) == 2);
+    REQUIRE(f.m_nodes.size() == 3);
+    REQUIRE(f.m_ways.size() == 1);
+    REQUIRE(f.m_relations.size() == 3);
+  }
+
+  SECTION("Node limit includes cached blocks") {
+    test_formatter f;
+    auto txn = factory->get_default_transaction();
+    readonly_pgsql_selection sel(*txn, {}, {}, cache);
+
+    REQUIRE(sel.select_map_closure(bbox(-0.1, -0.1, 0.1, 0.1), 1) == 2);
+  }
+}
+
 TEST_CASE("test_psql_array_to_vector", "[nodb]") {
 
   std::string test;
@@ -233,6 +504,145 @@ TEST_CASE("test_psql_array_to_vector", "[nodb]") {
   }
 }
 
+TEST_CASE("test_psql_array_to_views", "[nodb]") {
+
+  std::string test;
+  std::string unescaped;
+  std::vector<std::string_view> actual_values;
+  std::vector<std::string_view> values;
+
+  SECTION("NULL") {
+    test = "{NULL}";
+    values = psql_array_to_views(test, unescaped);
+    REQUIRE (values == actual_values);
+  }
+
+  SECTION("Empty") {
+    test = "{}";
+    values = psql_array_to_views(test, unescaped);
+    REQUIRE (values == actual_values);
+  }
+
+  SECTION("Two strings") {
+    test = "{\"TEST\",TEST123}";
+    values = psql_array_to_views(test, unescaped);
+    actual_values = { "TEST", "TEST123" };
+    REQUIRE (values == actual_values);
+    // neither value needs unescaping, so both point into the input
+    REQUIRE (values[0].data() == test.data() + 2);
+    REQUIRE (values[1].data() == test.data() + 8);
+    REQUIRE (unescaped.empty());
+  }
+
+  SECTION("Complex pattern") {
+    test = R"({"},\"",",{}}\\"})";
+    values = psql_array_to_views(test, unescaped);
+    actual_values = { "},\"", ",{}}\\" };
+    REQUIRE (values == actual_values);
+    REQUIRE (unescaped == "},\",{}}\\");
+  }
+
+  SECTION("Long values") {
+    test = R"({abcdefghijklmnopqrstuvwxyz0123456789,"Rijksweg Noord, left|through;right","quoted \"value\" with a long tail",x})";
+    values = psql_array_to_views(test, unescaped);
+    actual_values = { "abcdefghijklmnopqrstuvwxyz0123456789",
+                      "Rijksweg Noord, left|through;right",
+                      "quoted \"value\" with a long tail",
+                      "x" };
+    REQUIRE (values == actual_values);
+  }
+
+  SECTION("Unterminated quoted value") {
+    test = R"({"abc,def})";
+    REQUIRE_THROWS_AS(psql_array_to_views(test, unescaped), std::runtime_error);
+  }
+}
+
+namespace {
+
+// copy of the psql_array_to_vector implementation which built a new
+// string for every value, as a reference for the benchmark below.
+std::vector<std::string> baseline_psql_array_to_vector(std::string_view str, int size_hint = 0) {
+  std::vector<std::string> strs;
+  std::string value;
+  bool quotedValue = false;
+  bool escaped = false;
+  bool write = false;
+
+  if (size_hint > 0)
+    strs.reserve(size_hint);
+
+  if (str == "{NULL}" || str.empty())
+    return strs;
+
+  const auto str_size = str.size();
+  for (unsigned int i = 1; i < str_size; i++) {
+    if (str[i] == ',') {
+      if (quotedValue) {
+        value += ',';
+      } else {
+        write = true;
+      }
+    } else if (str[i] == '"') {
+      if (escaped) {
+        value += '"';
+        escaped = false;
+      } else if (quotedValue) {
+        quotedValue = false;
+      } else {
+        quotedValue = true;
+      }
+    } else if (str[i] == '\\') {
+      if (escaped) {
+        value += '\\';
+        escaped = false;
+      } else {
+        escaped = true;
+      }
+    } else if (str[i] == '}') {
+      if (quotedValue) {
+        value += '}';
+      } else {
+        write = true;
+      }
+    } else {
+      value += str[i];
+    }
+
+    if (write) {
+      strs.emplace_back(std::move(value));
+      value.clear();
+      write = false;
+    }
+  }
+  return strs;
+}
+
+} // anonymous namespace
+
+TEST_CASE("psql_array_to_views benchmark", "[nodb][!benchmark]") {
+
+  std::string test = "{";
+  for (int i = 0; i < 100; i++) {
+    if (i > 0)
+      test += ',';
+    test += fmt::format("\"name:lang{}\",highway,\"Rijksweg \\\"Noord\\\"\",{}", i, i);
+  }
+  test += '}';
+
+  // both parsers must agree for the comparison to mean anything
+  REQUIRE(baseline_psql_array_to_vector(test) == psql_array_to_vector(test));
+
+  BENCHMARK("baseline_psql_array_to_vector") {
+    return baseline_psql_array_to_vector(test);
+  };
+
+  BENCHMARK("psql_array_to_views") {
+    std::string unescaped;
+    return psql_array_to_views(test, unescaped).size();
+  };
+}
+
 TEST_CASE("psql_array_ids_to_vector", "[nodb]") {
 
   std::string test;
@@ -271,6 +681,226 @@ TEST_CASE("psql_array_ids_to_vector", "[nodb]") {
   }
 }
 
+TEST_CASE("id_set", "[nodb]") {
+
+  id_set<osm_nwr_id_t> ids;
+
+  SECTION("Batch insert sorts and removes duplicates") {
+    REQUIRE(ids.insert_batch({5, 3, 5, 1}) == 3);
+    REQUIRE(ids.values() == std::vector<osm_nwr_id_t>{1, 3, 5});
+  }
+
+  SECTION("Batch insert counts only new ids") {
+    ids.insert_batch({1, 3, 5});
+    REQUIRE(ids.insert_batch({4, 3, 2}) == 2);
+    REQUIRE(ids.insert_batch({6, 7}) == 2);
+    REQUIRE(ids.insert_batch({}) == 0);
+    REQUIRE(ids.values() == std::vector<osm_nwr_id_t>{1, 2, 3, 4, 5, 6, 7});
+  }
+
+  SECTION("Single insert") {
+    REQUIRE(ids.insert(2));
+    REQUIRE(ids.insert(1));
+    REQUIRE_FALSE(ids.insert(2));
+    REQUIRE(ids.values() == std::vector<osm_nwr_id_t>{1, 2});
+    REQUIRE(ids.contains(1));
+    REQUIRE_FALSE(ids.contains(3));
+  }
+
+  SECTION("Merge and erase") {
+    ids.insert_batch({1, 2, 3, 4});
+    const id_set<osm_nwr_id_t> other{3, 4, 5, 6};
+    REQUIRE(ids.merge(other) == 2);
+    REQUIRE(ids.erase(id_set<osm_nwr_id_t>{0, 2, 4, 6, 8}) == 3);
+    REQUIRE(ids == id_set<osm_nwr_id_t>{1, 3, 5});
+  }
+
+  SECTION("Editions") {
+    id_set<osm_edition_t> eds;
+    REQUIRE(eds.insert_batch({{2, 1}, {1, 2}, {1, 1}, {2, 1}}) == 3);
+    REQUIRE(eds.values() == std::vector<osm_edition_t>{{1, 1}, {1, 2}, {2, 1}});
+  }
+}
+
+TEST_CASE("tile_ranges_for_area", "[nodb]") {
+
+  auto expand = [](const std::vector<tile_range_t> &ranges) {
+    std::vector<tile_id_t> tiles;
+    for (const auto &[first, last] : ranges) {
+      for (uint64_t tile = first; tile <= last; tile++)
+        tiles.emplace_back(tile_id_t(tile));
+    }
+    return tiles;
+  };
+
+  SECTION("Single tile") {
+    const auto ranges = tile_ranges_for_area(51.5, -0.1, 51.5, -0.1);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(ranges[0].first == ranges[0].second);
+    REQUIRE(expand(ranges) == tiles_for_area(51.5, -0.1, 51.5, -0.1));
+  }
+
+  SECTION("Whole world") {
+    const auto ranges = tile_ranges_for_area(-90, -180, 90, 180);
+    REQUIRE(ranges == std::vector<tile_range_t>{{0, 0xffffffff}});
+  }
+
+  SECTION("Same tiles as tiles_for_area") {
+    for (const auto &[minlat, minlon, maxlat, maxlon] :
+         std::vector<std::tuple<double, double, double, double>>{
+           {51.0, 0.0, 51.5, 0.5},
+           {-0.3, -0.3, 0.3, 0.3},
+           {89.7, 179.6, 90.0, 180.0},
+           {-33.9, 151.1, -33.8, 151.3}}) {
+      const auto ranges = tile_ranges_for_area(minlat, minlon, maxlat, maxlon);
+      REQUIRE(expand(ranges) == tiles_for_area(minlat, minlon, maxlat, maxlon));
+
+      // ranges are ordered and never adjacent
+      for (std::size_t i = 1; i < ranges.size(); i++)
+        REQUIRE(uint64_t(ranges[i - 1].second) + 1 < ranges[i].first);
+    }
+  }
+
+  SECTION("Far fewer ranges than tiles") {
+    REQUIRE(tiles_for_area(51.0, 0.0, 51.5, 0.5).size() > 10000);
+    REQUIRE(tile_ranges_for_area(51.0, 0.0, 51.5, 0.5).size() < 200);
+  }
+}
+
+TEST_CASE("tile_blocks_for_area", "[nodb]") {
+
+  auto expand = [](const std::vector<tile_range_t> &ranges) {
+    std::vector<tile_id_t> tiles;
+    for (const auto &[first, last] : ranges) {
+      for (uint64_t tile = first; tile <= last; tile++)
+        tiles.emplace_back(tile_id_t(tile));
+    }
+    return tiles;
+  };
+
+  SECTION("No blocks in small areas") {
+    REQUIRE(tile_blocks_for_area(51.5, -0.1, 51.5, -0.1, 2, 5, 2).empty());
+    REQUIRE(tile_blocks_for_area(51.5, -0.1, 51.52, -0.08, 2, 5, 2).empty());
+  }
+
+  SECTION("Blocks and remaining ranges cover the area") {
+    for (const auto &[minlat, minlon, maxlat, maxlon] :
+         std::vector<std::tuple<double, double, double, double>>{
+           {51.0, 0.0, 51.5, 0.5},
+           {-0.3, -0.3, 0.3, 0.3},
+           {-33.9, 151.1, -33.8, 151.3}}) {
+      const auto ranges = tile_ranges_for_area(minlat, minlon, maxlat, maxlon);
+      const auto blocks = tile_blocks_for_area(minlat, minlon, maxlat, maxlon, 2, 5, 2);
+      REQUIRE_FALSE(blocks.empty());
+
+      std::vector<tile_range_t> block_ranges;
+      for (std::size_t i = 0; i < blocks.size(); i++) {
+        const auto &block = blocks[i];
+        const uint64_t size = uint64_t(block.tiles.second) - block.tiles.first + 1;
+
+        // aligned squares of 4x4 to 32x32 tiles, in order
+        REQUIRE(size >= 16);
+        REQUIRE(size <= 1024);
+        REQUIRE(block.tiles.first % size == 0);
+        REQUIRE(uint64_t(block.maxx - block.minx + 1) * (block.maxy - block.miny + 1) == size);
+        REQUIRE(xy2tile(block.minx, block.miny) == block.tiles.first);
+        REQUIRE(xy2tile(block.maxx, block.maxy) == block.tiles.second);
+        if (i > 0)
+          REQUIRE(blocks[i - 1].tiles.second < block.tiles.first);
+
+        // at least margin tiles inside the area
+        REQUIRE(block.minx >= lon2x(minlon) + 2);
+        REQUIRE(block.maxx + 2 <= lon2x(maxlon));
+        REQUIRE(block.miny >= lat2y(minlat) + 2);
+        REQUIRE(block.maxy + 2 <= lat2y(maxlat));
+
+        block_ranges.emplace_back(block.tiles);
+      }
+
+      const auto remaining = subtract_tile_blocks(ranges, blocks);
+
+      auto tiles = expand(remaining);
+      const auto block_tiles = expand(block_ranges);
+      tiles.insert(tiles.end(), block_tiles.begin(), block_tiles.end());
+      std::sort(tiles.begin(), tiles.end());
+
+      REQUIRE(tiles == expand(ranges));
+      REQUIRE(std::adjacent_find(tiles.begin(), tiles.end()) == tiles.end());
+    }
+  }
+}
+
+TEST_CASE("map_tile_cache", "[nodb]") {
+
+  using clock = map_tile_cache::clock;
+
+  map_tile_cache cache(2, std::chrono::seconds(60), std::chrono::seconds(600));
+  const auto now = clock::now();
+
+  const auto blocks = tile_blocks_for_area(51.0, 0.0, 51.5, 0.5, 2, 5, 2);
+  REQUIRE(blocks.size() >= 3);
+
+  auto closure = std::make_shared<map_tile_closure>();
+  closure->num_nodes = 1;
+  closure->nodes = {1, 2};
+
+  REQUIRE(cache.get(blocks[0], now) == nullptr);
+
+  cache.insert(blocks[0], closure, now);
+  REQUIRE(cache.get(blocks[0], now) == closure);
+  REQUIRE(cache.get(blocks[1], now) == nullptr);
+
+  // expired entries aren't returned
+  REQUIRE(cache.get(blocks[0], now + std::chrono::seconds(61)) == nullptr);
+
+  cache.insert(blocks[0], closure, now);
+  cache.invalidate(blocks[0]);
+  REQUIRE(cache.get(blocks[0], now) == nullptr);
+
+  // least recently used entries are evicted
+  cache.insert(blocks[0], closure, now);
+  cache.insert(blocks[1], closure, now);
+  cache.insert(blocks[2], closure, now);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.get(blocks[0], now) == nullptr);
+  REQUIRE(cache.get(blocks[2], now) == closure);
+
+  cache.clear();
+  REQUIRE(cache.size() == 0);
+
+  REQUIRE(map_tile_cache::shared(0, std::chrono::seconds(60), std::chrono::seconds(600)) == nullptr);
+}
+
+TEST_CASE("tile_ranges_for_area benchmark", "[nodb][!benchmark]") {
+
+  BENCHMARK("tiles_for_area") {
+    return tiles_for_area(51.0, 0.0, 51.5, 0.5).size();
+  };
+
+  BENCHMARK("tile_ranges_for_area") {
+    return tile_ranges_for_area(51.0, 0.0, 51.5, 0.5).size();
+  };
+}
+
+TEST_CASE("format_pg_timestamp", "[nodb]") {
+
+  SECTION("Seconds precision") {
+    REQUIRE(format_pg_timestamp("2013-11-14 02:10:00") == "2013-11-14T02:10:00Z");
+  }
+
+  SECTION("Fractional seconds are truncated") {
+    REQUIRE(format_pg_timestamp("2015-03-02 18:27:59.999999") == "2015-03-02T18:27:59Z");
+    REQUIRE(format_pg_timestamp("2015-03-02 18:27:00.5") == "2015-03-02T18:27:00Z");
+  }
+
+  SECTION("Invalid formats") {
+    REQUIRE_THROWS_AS(format_pg_timestamp(""), std::runtime_error);
+    REQUIRE_THROWS_AS(format_pg_timestamp("2013-11-14"), std::runtime_error);
+    REQUIRE_THROWS_AS(format_pg_timestamp("2013-11-14T02:10:00Z"), std::runtime_error);
+    REQUIRE_THROWS_AS(format_pg_timestamp("11/14/2013 02:10:00"), std::runtime_error);
+  }
+}
+
 TEST_CASE("escape_pg_value", "[nodb]") {
 
   SECTION("Empty string") {
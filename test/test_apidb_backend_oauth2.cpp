@@ -11,6 +11,7 @@
 #include <sys/time.h>
 #include <cstdio>
 
+#include "cgimap/backend/apidb/auth_cache.hpp"
 #include "cgimap/rate_limiter.hpp"
 #include "cgimap/routes.hpp"
 #include "cgimap/process_request.hpp"
@@ -276,6 +277,73 @@ TEST_CASE_METHOD(DatabaseTestsFixture, "test_user_id_for_oauth2_token", "[oauth2
 }
 
 
+TEST_CASE_METHOD(DatabaseTestsFixture, "test_oauth2_user_details", "[oauth2][db]" ) {
+
+  auto sel = tdb.get_data_selection();
+
+  SECTION("Initialize test data") {
+
+    tdb.run_sql(R"(
+
+      INSERT INTO users (id, email, pass_crypt, creation_time, display_name, data_public, status)
+      VALUES
+        (1, 'user_1@example.com', '', '2013-11-14T02:10:00Z', 'user_1', true, 'confirmed'),
+        (2, 'user_2@example.com', '', '2021-03-12T01:33:43Z', 'user_2', true, 'pending');
+
+      INSERT INTO user_roles (id, user_id, role, granter_id)
+      VALUES
+        (1, 1, 'administrator', 1),
+        (2, 1, 'moderator', 1);
+
+      INSERT INTO user_blocks (user_id, creator_id, reason, ends_at, needs_view)
+      VALUES (2, 1, '', now() at time zone 'utc' - ('1 hour' ::interval), true);
+
+     INSERT INTO oauth_applications (id, owner_type, owner_id, name, uid, secret, redirect_uri, scopes, confidential, created_at, updated_at)
+         VALUES (3, 'User', 1, 'App 1', 'dHKmvGkmuoMjqhCNmTJkf-EcnA61Up34O1vOHwTSvU8', '965136b8fb8d00e2faa2faaaed99c0ec10225518d0c8d9fb1d2af701e87eb68c',
+                'http://demo.localhost:3000', 'write_api read_gpx', false, '2021-04-12 17:53:30', '2021-04-12 17:53:30');
+
+     INSERT INTO public.oauth_access_tokens (id, resource_owner_id, application_id, token, refresh_token, expires_in, revoked_at, created_at, scopes, previous_refresh_token)
+         VALUES (67, 1, 3, 'deb2029737bcfaaf9e937aea6b5d585a1bf93be9d21672d0f98c479c52592130', NULL, NULL, NULL, '2021-04-14 19:38:21', 'write_api', '');
+
+     INSERT INTO public.oauth_access_tokens (id, resource_owner_id, application_id, token, refresh_token, expires_in, revoked_at, created_at, scopes, previous_refresh_token)
+         VALUES (68, 2, 3, 'nFRBLFyNXPKY1fiTHAIfVsjQYkCD2KoRuH66upvueaQ', NULL, NULL, NULL, '2021-04-14 19:38:21', 'read_prefs', '');
+    )");
+  }
+
+  using enum osm_user_role_t;
+
+  SECTION("Hashed token of active user with roles") {
+    const auto details = sel->get_oauth2_user_details("6GGXRGoDog0i6mRyrBonFmJORQhWZMhZH5WNWLd0qcs");
+    CHECK(details.user_id == 1);
+    CHECK(details.allow_api_write);
+    CHECK_FALSE(details.expired);
+    CHECK_FALSE(details.revoked);
+    CHECK(details.roles == std::set<osm_user_role_t>{administrator, moderator});
+    CHECK_FALSE(details.blocked);
+    CHECK(details.active);
+
+    // the individual functions answer from the same result
+    CHECK(sel->get_roles_for_user(1) == details.roles);
+    CHECK_FALSE(sel->is_user_blocked(1));
+    CHECK(sel->is_user_active(1));
+  }
+
+  SECTION("Plain token of blocked, pending user") {
+    const auto details = sel->get_oauth2_user_details("nFRBLFyNXPKY1fiTHAIfVsjQYkCD2KoRuH66upvueaQ");
+    CHECK(details.user_id == 2);
+    CHECK_FALSE(details.allow_api_write);
+    CHECK(details.roles.empty());
+    CHECK(details.blocked);
+    CHECK_FALSE(details.active);
+  }
+
+  SECTION("Unknown token") {
+    const auto details = sel->get_oauth2_user_details("a6ee343e3417915c87f492aac2a7b638647ef576e2a03256bbf1854c7e06c163");
+    CHECK_FALSE(details.user_id.has_value());
+    CHECK(details.roles.empty());
+  }
+}
+
 TEST_CASE_METHOD(DatabaseTestsFixture, "test_oauth2_end_to_end", "[oauth2][db]" ) {
 
   // tokens 1yi2RI2W... and 2Kx... are stored in plain text in oauth_access_tokens table, all others as sha256-hash value
@@ -335,6 +403,54 @@ TEST_CASE_METHOD(DatabaseTestsFixture, "test_oauth2_end_to_end", "[oauth2][db]"
 }
 
 
+TEST_CASE("cached_oauth2_token", "[oauth2][nodb]" ) {
+
+  using namespace std::chrono_literals;
+
+  const auto now = std::chrono::steady_clock::now();
+
+  cached_oauth2_token token;
+  token.details.user_id = 1;
+
+  SECTION("Valid token") {
+    const auto details = token.at(now);
+    CHECK(details.user_id == 1);
+    CHECK_FALSE(details.expired);
+    CHECK_FALSE(details.revoked);
+  }
+
+  SECTION("Token expiring while cached") {
+    token.expires_at = now + 1h;
+    CHECK_FALSE(token.at(now).expired);
+    CHECK(token.at(now + 2h).expired);
+  }
+
+  SECTION("Token revoked in the future") {
+    token.revoked_at = now + 1h;
+    CHECK_FALSE(token.at(now).revoked);
+    CHECK(token.at(now + 2h).revoked);
+  }
+}
+
+TEST_CASE("auth_cache keeps unknown tokens apart", "[oauth2][nodb]" ) {
+
+  using namespace std::chrono_literals;
+
+  auth_cache cache(2, 1, 60s);
+
+  cached_oauth2_token token;
+  token.details.user_id = 1;
+  cache.tokens.put("valid", token);
+
+  // a flood of unknown tokens only evicts other unknown tokens
+  cache.unknown_tokens.put("unknown_1", {});
+  cache.unknown_tokens.put("unknown_2", {});
+
+  CHECK(cache.tokens.get("valid"));
+  CHECK_FALSE(cache.unknown_tokens.get("unknown_1"));
+  CHECK(cache.unknown_tokens.get("unknown_2"));
+}
+
 int main(int argc, char *argv[]) {
   Catch::Session session;
 
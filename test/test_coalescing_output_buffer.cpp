@@ -0,0 +1,141 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/coalescing_output_buffer.hpp"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+// records each call to write_chunks as one string per chunk
+struct recording_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    calls.push_back({std::string(buffer, len)});
+    return len;
+  }
+  int write_chunks(std::span<const std::string_view> chunks) noexcept override {
+    std::vector<std::string> call;
+    int total = 0;
+    for (const auto &chunk : chunks) {
+      call.emplace_back(chunk);
+      total += chunk.size();
+    }
+    calls.push_back(call);
+    return fail ? -1 : total;
+  }
+  int written() const override { return 0; }
+  int close() noexcept override { ++closed; return 0; }
+  int flush() noexcept override { ++flushed; return 0; }
+
+  std::vector<std::vector<std::string>> calls;
+  int closed = 0;
+  int flushed = 0;
+  bool fail = false;
+};
+
+using chunks = std::vector<std::string>;
+
+} // anonymous namespace
+
+TEST_CASE("coalescing_output_buffer collects small writes", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  CHECK(buffer.write("ab", 2) == 2);
+  CHECK(buffer.write("cd") == 2);
+  CHECK(out.calls.empty());
+  CHECK(buffer.written() == 4);
+
+  CHECK(buffer.flush() == 0);
+  REQUIRE(out.calls.size() == 1);
+  CHECK(out.calls[0] == chunks{"abcd"});
+  CHECK(out.flushed == 1);
+
+  // nothing left to hand on
+  CHECK(buffer.close() == 0);
+  CHECK(out.calls.size() == 1);
+  CHECK(out.closed == 1);
+
+  CHECK(buffer.writes() == 2);
+  CHECK(buffer.chunks() == 1);
+}
+
+TEST_CASE("coalescing_output_buffer hands on a full buffer", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  buffer.write("abc");
+  buffer.write("def");
+  buffer.write("ghi");
+  buffer.write("jkl");
+  buffer.write("mn");
+  CHECK(out.calls.empty());
+  buffer.write("op");
+  REQUIRE(out.calls.size() == 1);
+  CHECK(out.calls[0] == chunks{"abcdefghijklmnop"});
+}
+
+TEST_CASE("coalescing_output_buffer doesn't copy large writes", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  buffer.write("a");
+  buffer.write("0123");
+  REQUIRE(out.calls.size() == 1);
+  CHECK(out.calls[0] == chunks{"a", "0123"});
+
+  buffer.write("0123456789abcdef0123");
+  REQUIRE(out.calls.size() == 2);
+  CHECK(out.calls[1] == chunks{"0123456789abcdef0123"});
+}
+
+TEST_CASE("coalescing_output_buffer hands on what doesn't fit", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  for (int i = 0; i < 5; ++i)
+    buffer.write("abc");
+  CHECK(out.calls.empty());
+
+  // below the threshold, but too large for the space left
+  CHECK(buffer.write("xyz") == 3);
+  REQUIRE(out.calls.size() == 1);
+  CHECK(out.calls[0] == chunks{"abcabcabcabcabc", "xyz"});
+  CHECK(buffer.written() == 18);
+}
+
+TEST_CASE("coalescing_output_buffer reports errors", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  buffer.write("abc");
+  out.fail = true;
+  CHECK(buffer.write("0123456789") == -1);
+  CHECK(buffer.flush() == 0);
+  CHECK(out.calls.size() == 1);
+}
+
+TEST_CASE("coalescing_output_buffer reset", "[output_buffer]") {
+  recording_output_buffer out;
+  coalescing_output_buffer buffer(out, 16);
+
+  buffer.write("abc");
+  buffer.reset();
+  CHECK(buffer.written() == 0);
+  CHECK(buffer.writes() == 0);
+
+  buffer.write("def");
+  buffer.close();
+  REQUIRE(out.calls.size() == 1);
+  CHECK(out.calls[0] == chunks{"def"});
+}
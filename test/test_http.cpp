@@ -9,9 +9,18 @@
 
 /* -*- coding: utf-8 -*- */
 #include "cgimap/http.hpp"
+#include "cgimap/time.hpp"
 #include "cgimap/choose_formatter.hpp"
+#include "cgimap/request_helpers.hpp"
+#include "test_request.hpp"
+
+#include <cstddef>
+#include <string>
+
+#include <fmt/core.h>
 
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 struct test_responder : responder {
 
@@ -70,16 +79,92 @@ TEST_CASE("http_check_choose_encoding", "[http]") {
   CHECK(http::choose_encoding("identity;q=0.8, gzip;q=1.0, *;q=0.1")->name() == "gzip");
   CHECK(http::choose_encoding("gzip")->name() == "gzip");
   CHECK(http::choose_encoding("identity")->name() == "identity");
-  CHECK(http::choose_encoding("*")->name() == "br");
   CHECK(http::choose_encoding("deflate")->name() == "deflate");
+#if HAVE_ZSTD
+  CHECK(http::choose_encoding("*")->name() == "zstd");
+  CHECK(http::choose_encoding("zstd")->name() == "zstd");
+  CHECK(http::choose_encoding("gzip, deflate, br, zstd")->name() == "zstd");
+  CHECK(http::choose_encoding("zstd;q=0.5, gzip")->name() == "gzip");
+#else
+  CHECK(http::choose_encoding("*")->name() == "br");
+  // test unsupported encoding
+  CHECK_THROWS_AS(http::choose_encoding("zstd"), http::not_acceptable);
+#endif
 #if HAVE_BROTLI
   CHECK(http::choose_encoding("gzip, deflate, br")->name() == "br");
-  CHECK(http::choose_encoding("zstd;q=1.0, deflate;q=0.8, br;q=0.9")->name() == "br");
-  CHECK(http::choose_encoding("zstd;q=1.0, unknown;q=0.8, br;q=0.9")->name() == "br");
+  CHECK(http::choose_encoding("zstd;q=0.8, deflate;q=0.8, br;q=0.9")->name() == "br");
+  CHECK(http::choose_encoding("zstd;q=0.8, unknown;q=0.8, br;q=0.9")->name() == "br");
   CHECK(http::choose_encoding("gzip, deflate, br")->name() == "br");
 #endif
   // test unsupported encoding
-  CHECK_THROWS_AS(http::choose_encoding("zstd"), http::not_acceptable);
+  CHECK_THROWS_AS(http::choose_encoding("compress"), http::not_acceptable);
+}
+
+TEST_CASE("http_check_etag_matches", "[http]") {
+  CHECK(http::etag_matches("\"abc\"", "\"abc\""));
+  CHECK(http::etag_matches("*", "\"abc\""));
+  CHECK(http::etag_matches("\"xyz\", \"abc\"", "\"abc\""));
+  CHECK(http::etag_matches(" \"xyz\" ,\t\"abc\" ", "\"abc\""));
+
+  // weak comparison
+  CHECK(http::etag_matches("W/\"abc\"", "\"abc\""));
+  CHECK(http::etag_matches("\"abc\"", "W/\"abc\""));
+
+  CHECK_FALSE(http::etag_matches("", "\"abc\""));
+  CHECK_FALSE(http::etag_matches("\"abcd\"", "\"abc\""));
+  CHECK_FALSE(http::etag_matches("abc", "\"abc\""));
+  CHECK_FALSE(http::etag_matches("\"xyz\", , W/\"ab\"", "\"abc\""));
+}
+
+TEST_CASE("http_check_http_date", "[http]") {
+  const auto t = parse_time("1994-11-06T08:49:37Z");
+
+  CHECK(http::format_http_date(t) == "Sun, 06 Nov 1994 08:49:37 GMT");
+  CHECK(http::format_http_date(parse_time("2025-01-31T23:00:05Z")) ==
+        "Fri, 31 Jan 2025 23:00:05 GMT");
+
+  CHECK(http::parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT") == t);
+  CHECK(http::parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT") == t);
+  CHECK(http::parse_http_date("Sun Nov  6 08:49:37 1994") == t);
+
+  CHECK_FALSE(http::parse_http_date(""));
+  CHECK_FALSE(http::parse_http_date("yesterday"));
+  CHECK_FALSE(http::parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT; length=12"));
+  CHECK_FALSE(http::parse_http_date("Sun, 31 Nov 1994 08:49:37 GMT"));
+  CHECK_FALSE(http::parse_http_date("Sun, 06 Nov 1994 24:49:37 GMT"));
+  CHECK_FALSE(http::parse_http_date("Son, 06 Nov 1994 08:49:37 GMT"));
+  CHECK_FALSE(http::parse_http_date("Sun, 06 Noviembre 1994 08:49:37 GMT"));
+
+  CHECK(http::parse_http_date("Tue, 28 Feb 2006 23:59:60 GMT") ==
+        parse_time("2006-03-01T00:00:00Z"));
+  CHECK(http::parse_http_date("Saturday, 31-Jan-15 23:00:05 GMT") ==
+        parse_time("2015-01-31T23:00:05Z"));
+  CHECK(http::parse_http_date("Fri Jan 31 23:00:05 2025") ==
+        parse_time("2025-01-31T23:00:05Z"));
+}
+
+TEST_CASE("http_check_compression_effort", "[http]") {
+  CHECK(choose_compression_effort({}, 1.0) == compression_effort::high);
+  CHECK(choose_compression_effort(10000, 1.0) == compression_effort::high);
+  CHECK(choose_compression_effort(1024 * 1024, 1.0) == compression_effort::medium);
+  CHECK(choose_compression_effort(20 * 1024 * 1024, 1.0) == compression_effort::fast);
+
+  // less effort when the CPUs are busy
+  CHECK(choose_compression_effort({}, 0.2) == compression_effort::medium);
+  CHECK(choose_compression_effort(1024 * 1024, 0.2) == compression_effort::fast);
+  CHECK(choose_compression_effort({}, 0.0) == compression_effort::fast);
+
+  // only large responses are compressed in parallel, and only when there
+  // are idle CPUs
+  CHECK_FALSE(choose_compression({}, 1.0).parallel);
+  CHECK_FALSE(choose_compression(10000, 1.0).parallel);
+  CHECK(choose_compression(20 * 1024 * 1024, 1.0).parallel);
+  CHECK(choose_compression(20 * 1024 * 1024, 1.0).effort == compression_effort::fast);
+  CHECK_FALSE(choose_compression(20 * 1024 * 1024, 0.3).parallel);
+
+  const double headroom = cpu_headroom();
+  CHECK(headroom >= 0.0);
+  CHECK(headroom <= 1.0);
 }
 
 TEST_CASE("http_check_accept_header_parsing", "[http]") {
@@ -175,9 +260,240 @@ TEST_CASE("http_check_accept_header_parsing", "[http]") {
     CHECK(http::get_content_encoding_handler("identity"));
     CHECK(http::get_content_encoding_handler("gzip"));
     CHECK(http::get_content_encoding_handler("deflate"));
+#if HAVE_BROTLI
+    CHECK(http::get_content_encoding_handler("br"));
+#else
     CHECK_THROWS_AS(http::get_content_encoding_handler("br"), http::unsupported_media_type);
+#endif
+#if HAVE_ZSTD
+    CHECK(http::get_content_encoding_handler("zstd"));
+#else
+    CHECK_THROWS_AS(http::get_content_encoding_handler("zstd"), http::unsupported_media_type);
+#endif
     CHECK_THROWS_AS(http::get_content_encoding_handler("unknown"), http::unsupported_media_type);
   }
 }
 
+namespace {
+
+std::string osmchange_payload(std::size_t size) {
+  std::string result = "<osmChange version=\"0.6\">\n<create>\n";
+  for (int i = 1; result.size() < size; ++i) {
+    result += fmt::format(
+        "  <node id=\"-{0}\" lat=\"{1}.1234567\" lon=\"{2}.7654321\" changeset=\"1\">\n"
+        "    <tag k=\"name\" v=\"Node {0}\"/>\n"
+        "  </node>\n", i, i % 90, i % 180);
+  }
+  result += "</create>\n</osmChange>\n";
+  return result;
+}
+
+#ifdef HAVE_LIBZ
+std::string zlib_compress(const std::string &input, int windowBits) {
+  z_stream stream{};
+  REQUIRE(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits,
+                       8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+  std::string result(deflateBound(&stream, input.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef *>(result.data());
+  stream.avail_out = result.size();
+
+  REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  result.resize(stream.total_out);
+  deflateEnd(&stream);
+  return result;
+}
+#endif
+
+#if HAVE_BROTLI
+std::string brotli_compress(const std::string &input) {
+  std::string result(BrotliEncoderMaxCompressedSize(input.size()), '\0');
+  size_t size = result.size();
+  REQUIRE(BrotliEncoderCompress(BROTLI_DEFAULT_QUALITY, BROTLI_DEFAULT_WINDOW,
+                                BROTLI_DEFAULT_MODE, input.size(),
+                                reinterpret_cast<const uint8_t *>(input.data()),
+                                &size, reinterpret_cast<uint8_t *>(result.data())));
+  result.resize(size);
+  return result;
+}
+#endif
+
+#if HAVE_ZSTD
+std::string zstd_compress(const std::string &input) {
+  std::string result(ZSTD_compressBound(input.size()), '\0');
+  auto size = ZSTD_compress(result.data(), result.size(), input.data(), input.size(), 3);
+  REQUIRE(!ZSTD_isError(size));
+  result.resize(size);
+  return result;
+}
+#endif
+
+// feeds input to the decompressor in pieces of chunk_size bytes, the same
+// way a request body arrives.
+std::string decompress(Decompressor &decompressor, std::string_view input,
+                       std::size_t chunk_size) {
+  std::string result;
+  for (std::size_t offset = 0; offset < input.size(); offset += chunk_size) {
+    decompressor.decompress(input.substr(offset, chunk_size),
+                            [&result](std::string_view out) { result += out; });
+  }
+  return result;
+}
+
+} // anonymous namespace
+
+TEST_CASE("http_check_decompression", "[http]") {
+  const auto payload = osmchange_payload(200000);
+
+  SECTION("identity") {
+    auto d = http::get_content_encoding_handler("identity");
+    CHECK(decompress(*d, payload, 4096) == payload);
+  }
 
+#ifdef HAVE_LIBZ
+  SECTION("gzip") {
+    const auto compressed = zlib_compress(payload, 15 + 16);
+    for (std::size_t chunk_size : {1, 1000, 16384, 1 << 20}) {
+      auto d = http::get_content_encoding_handler("gzip");
+      CHECK(decompress(*d, compressed, chunk_size) == payload);
+    }
+  }
+
+  SECTION("deflate") {
+    const auto compressed = zlib_compress(payload, 15);
+    for (std::size_t chunk_size : {1, 1000, 16384, 1 << 20}) {
+      auto d = http::get_content_encoding_handler("deflate");
+      CHECK(decompress(*d, compressed, chunk_size) == payload);
+    }
+  }
+
+  SECTION("invalid gzip data") {
+    auto d = http::get_content_encoding_handler("gzip");
+    CHECK_THROWS_AS(decompress(*d, payload, 4096), decompression_error);
+  }
+#endif
+
+#if HAVE_BROTLI
+  SECTION("br") {
+    const auto compressed = brotli_compress(payload);
+    for (std::size_t chunk_size : {1, 1000, 16384, 1 << 20}) {
+      auto d = http::get_content_encoding_handler("br");
+      CHECK(decompress(*d, compressed, chunk_size) == payload);
+    }
+  }
+
+  SECTION("invalid br data") {
+    auto d = http::get_content_encoding_handler("br");
+    CHECK_THROWS_AS(decompress(*d, payload, 4096), decompression_error);
+  }
+#endif
+
+#if HAVE_ZSTD
+  SECTION("zstd") {
+    const auto compressed = zstd_compress(payload);
+    for (std::size_t chunk_size : {1, 1000, 16384, 1 << 20}) {
+      auto d = http::get_content_encoding_handler("zstd");
+      CHECK(decompress(*d, compressed, chunk_size) == payload);
+    }
+  }
+
+  SECTION("invalid zstd data") {
+    auto d = http::get_content_encoding_handler("zstd");
+    CHECK_THROWS_AS(decompress(*d, payload, 4096), decompression_error);
+  }
+#endif
+}
+
+namespace {
+
+struct string_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    data.append(buffer, len);
+    return len;
+  }
+  int written() const override { return data.size(); }
+  int close() noexcept override { return 0; }
+  int flush() noexcept override { return 0; }
+
+  std::string data;
+};
+
+// compresses input with the named encoding, writing it in pieces the way
+// the output writers do, then decompresses it again.
+std::string round_trip(const std::string &name, compression_effort effort,
+                       const std::string &input) {
+  string_output_buffer out;
+  auto encoding = http::choose_encoding(name);
+  REQUIRE(encoding->name() == name);
+  {
+    auto buffer = encoding->buffer(out, compression_settings{effort});
+    for (std::size_t offset = 0; offset < input.size(); offset += 70000) {
+      const auto piece = std::string_view(input).substr(offset, 70000);
+      REQUIRE(buffer->write(piece) == int(piece.size()));
+    }
+    CHECK(buffer->written() == int(input.size()));
+    REQUIRE(buffer->flush() >= 0);
+    REQUIRE(buffer->close() >= 0);
+  }
+
+  auto d = http::get_content_encoding_handler(name);
+  return decompress(*d, out.data, 16384);
+}
+
+} // anonymous namespace
+
+TEST_CASE("http_check_compression", "[http]") {
+  // the larger payload is too large for buffering with libdeflate
+  for (std::size_t size : {0, 200000, 3 * 1024 * 1024}) {
+    const auto payload = osmchange_payload(size);
+
+    for (auto effort : {compression_effort::fast, compression_effort::medium,
+                        compression_effort::high}) {
+      CHECK(round_trip("identity", effort, payload) == payload);
+#ifdef HAVE_LIBZ
+      CHECK(round_trip("gzip", effort, payload) == payload);
+      CHECK(round_trip("deflate", effort, payload) == payload);
+#endif
+#if HAVE_BROTLI
+      CHECK(round_trip("br", effort, payload) == payload);
+#endif
+#if HAVE_ZSTD
+      CHECK(round_trip("zstd", effort, payload) == payload);
+#endif
+    }
+  }
+}
+
+#ifdef HAVE_LIBZ
+TEST_CASE("http_check_response_encoding", "[http]") {
+  test_request req;
+  req.set_header("HTTP_ACCEPT_ENCODING", "gzip");
+
+  SECTION("Negotiated encoding is used for XML") {
+    CHECK(get_encoding(req, mime::type::application_xml)->name() == "gzip");
+  }
+
+  SECTION("PBF blobs aren't compressed a second time") {
+    CHECK(get_encoding(req, mime::type::application_x_protobuf)->name() == "identity");
+  }
+}
+
+TEST_CASE("gzip upload decompression benchmark", "[http][!benchmark]") {
+
+  const auto compressed = zlib_compress(osmchange_payload(50 * 1024 * 1024), 15 + 16);
+
+  BENCHMARK("decompress 50 MB gzip payload") {
+    auto d = http::get_content_encoding_handler("gzip");
+    std::size_t total = 0;
+    // same piece size as the FastCGI request body buffer
+    for (std::size_t offset = 0; offset < compressed.size(); offset += 512000) {
+      d->decompress(std::string_view(compressed).substr(offset, 512000),
+                    [&total](std::string_view out) { total += out.size(); });
+    }
+    return total;
+  };
+}
+#endif
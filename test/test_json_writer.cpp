@@ -0,0 +1,144 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/json_writer.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct string_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    data.append(buffer, len);
+    return len;
+  }
+  int written() const override { return data.size(); }
+  int close() noexcept override { ++closed; return 0; }
+  int flush() noexcept override { return 0; }
+
+  std::string data;
+  int closed = 0;
+};
+
+} // anonymous namespace
+
+// the expected output below is what yajl's generator produced, which
+// clients may have come to rely on.
+
+TEST_CASE("json_writer_compact", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, false);
+    writer.start_object();
+    writer.property("version", "0.6");
+    writer.property("id", int64_t(-1));
+    writer.property("uid", std::numeric_limits<uint64_t>::max());
+    writer.property("visible", true);
+    writer.object_key("nodes");
+    writer.start_array();
+    writer.entry(1);
+    writer.entry(2);
+    writer.end_array();
+    writer.object_key("tags");
+    writer.start_object();
+    writer.end_object();
+    writer.end_object();
+  }
+  CHECK(out.data == "{\"version\":\"0.6\",\"id\":-1,\"uid\":18446744073709551615,"
+                    "\"visible\":true,\"nodes\":[1,2],\"tags\":{}}");
+  CHECK(out.closed == 1);
+}
+
+TEST_CASE("json_writer_indented", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, true);
+    writer.start_object();
+    writer.property("version", "0.6");
+    writer.object_key("elements");
+    writer.start_array();
+    writer.start_object();
+    writer.property("id", 1);
+    writer.end_object();
+    writer.end_array();
+    writer.object_key("tags");
+    writer.start_object();
+    writer.end_object();
+    writer.end_object();
+  }
+  CHECK(out.data == "{\n"
+                    " \"version\": \"0.6\",\n"
+                    " \"elements\": [\n"
+                    "  {\n"
+                    "   \"id\": 1\n"
+                    "  }\n"
+                    " ],\n"
+                    " \"tags\": {\n"
+                    "\n"
+                    " }\n"
+                    "}\n");
+}
+
+TEST_CASE("json_writer_escaping", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, false);
+    writer.start_array();
+    writer.entry(std::string("\"a\\b\" / \r\n\t\b\f \x01\x1f\x7f"));
+    writer.entry(std::string("\xc3\xa4\xe2\x82\xac"));
+    writer.end_array();
+  }
+  CHECK(out.data == "[\"\\\"a\\\\b\\\" / \\r\\n\\t\\b\\f \\u0001\\u001F\x7f\","
+                    "\"\xc3\xa4\xe2\x82\xac\"]");
+}
+
+TEST_CASE("json_writer_doubles", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, false);
+    writer.start_array();
+    writer.entry(51.5);
+    writer.entry(-0.1234567);
+    writer.entry(-0.0);
+    writer.entry(1e10);
+    writer.end_array();
+  }
+  CHECK(out.data == "[51.5000000,-0.1234567,-0.0000000,10000000000.0000000]");
+}
+
+TEST_CASE("json_writer_error", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, false);
+    writer.start_array();
+    writer.entry(1);
+    writer.error("oops");
+    writer.end_array();
+  }
+  CHECK(out.data == "[1,{\"error\":\"oops\"}]");
+}
+
+TEST_CASE("json_writer_fixed_point", "[json]") {
+  string_output_buffer out;
+  {
+    json_writer writer(out, false);
+    writer.start_array();
+    writer.entry(int64_t(515000000), 10'000'000);
+    writer.entry(int64_t(-1), 10'000'000);
+    writer.entry(int64_t(-123), 100);
+    writer.entry(int64_t(1), 3);
+    writer.end_array();
+  }
+  CHECK(out.data == "[51.5000000,-0.0000001,-1.2300000,0.3333333]");
+}
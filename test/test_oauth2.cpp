@@ -11,6 +11,7 @@
 #include <string>
 
 #include "cgimap/oauth2.hpp"
+#include "cgimap/sha256.hpp"
 #include "test_request.hpp"
 #include "test_empty_selection.hpp"
 
@@ -189,3 +190,12 @@ TEST_CASE("test_validate_bearer_token", "[oauth2]") {
     CHECK(!allow_api_write);
   }
 }
+
+TEST_CASE("test_sha256_hex", "[oauth2]") {
+  CHECK(sha256_hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  CHECK(sha256_hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  // padding spills into a second block for 56+ byte messages
+  CHECK(sha256_hex(std::string(56, 'a')) == "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a");
+  CHECK(sha256_hex("6GGXRGoDog0i6mRyrBonFmJORQhWZMhZH5WNWLd0qcs") == "deb2029737bcfaaf9e937aea6b5d585a1bf93be9d21672d0f98c479c52592130");
+  CHECK(sha256_hex("H4TeKX-zE_VLH.UT33_n6x__yZ8~BA~aQL+wfxQN/cADu7BMMA=====") == "b708e84f9f2135b2ebd4a87529a6d0da976939e37958ac63f5790d8e3f4eb7db");
+}
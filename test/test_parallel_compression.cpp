@@ -0,0 +1,174 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/http.hpp"
+#include "cgimap/parallel_compression.hpp"
+#include "cgimap/thread_pool.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct string_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    data.append(buffer, len);
+    return len;
+  }
+  int written() const override { return data.size(); }
+  int close() noexcept override { ++closed; return 0; }
+  int flush() noexcept override { ++flushed; return 0; }
+
+  std::string data;
+  int closed = 0;
+  int flushed = 0;
+};
+
+// something like a map call response, repetitive but not entirely
+std::string payload(std::size_t size) {
+  std::string result;
+  for (int id = 0; result.size() < size; ++id) {
+    result += fmt::format(R"(<node id="{}" lat="{:.7f}" lon="{:.7f}" version="{}"/>)"
+                          "\n", id, 51.0 + id * 1e-5, -0.1 - id * 3e-5, id % 7 + 1);
+  }
+  result.resize(size);
+  return result;
+}
+
+std::string decompress(const std::string &encoding, const std::string &input) {
+  std::string result;
+  auto d = http::get_content_encoding_handler(encoding);
+  for (std::size_t offset = 0; offset < input.size(); offset += 16384) {
+    d->decompress(std::string_view(input).substr(offset, 16384),
+                  [&result](std::string_view out) { result += out; });
+  }
+  return result;
+}
+
+std::string compress(thread_pool &pool, parallel_output_buffer::format format,
+                     const std::string &input, std::size_t piece_size) {
+  string_output_buffer out;
+  parallel_output_buffer buffer(out, pool, format, 6);
+
+  for (std::size_t offset = 0; offset < input.size(); offset += piece_size) {
+    const auto piece = std::string_view(input).substr(offset, piece_size);
+    REQUIRE(buffer.write(piece) == int(piece.size()));
+  }
+  CHECK(buffer.written() == int(input.size()));
+  REQUIRE(buffer.close() == 0);
+  CHECK(out.closed == 1);
+
+  return out.data;
+}
+
+struct encoding_format {
+  std::string encoding;
+  parallel_output_buffer::format format;
+};
+
+std::vector<encoding_format> formats() {
+  return {
+    {"gzip", parallel_output_buffer::format::gzip},
+    {"deflate", parallel_output_buffer::format::zlib},
+#if HAVE_ZSTD
+    {"zstd", parallel_output_buffer::format::zstd},
+#endif
+  };
+}
+
+} // anonymous namespace
+
+TEST_CASE("thread_pool runs tasks", "[thread_pool]") {
+  thread_pool pool(3);
+  CHECK(pool.size() == 3);
+
+  std::atomic<int> count{0};
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.push_back(pool.submit([i, &count]() { ++count; return i * i; }));
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    CHECK(results[i].get() == i * i);
+  }
+  CHECK(count == 100);
+}
+
+TEST_CASE("thread_pool passes on exceptions", "[thread_pool]") {
+  thread_pool pool(1);
+  auto result = pool.submit([]() -> int { throw std::runtime_error("failed"); });
+  CHECK_THROWS_AS(result.get(), std::runtime_error);
+}
+
+TEST_CASE("parallel_output_buffer round trip", "[parallel_compression]") {
+  thread_pool pool(4);
+
+  // sizes around the block sizes, and large enough for many blocks
+  for (std::size_t size : {0, 1, 1000, 128 * 1024, 128 * 1024 + 1,
+                           512 * 1024, 3 * 1024 * 1024 + 17}) {
+    const auto input = payload(size);
+
+    for (const auto &f : formats()) {
+      for (std::size_t piece_size : {65536, 1000000}) {
+        INFO(f.encoding << " " << size << " bytes written in " << piece_size);
+        const auto compressed = compress(pool, f.format, input, piece_size);
+        CHECK(decompress(f.encoding, compressed) == input);
+
+        if (size > 100000) {
+          CHECK(compressed.size() < size / 3);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("parallel_output_buffer flush", "[parallel_compression]") {
+  thread_pool pool(2);
+  const auto input = payload(300000);
+
+  for (const auto &f : formats()) {
+    INFO(f.encoding);
+    string_output_buffer out;
+    parallel_output_buffer buffer(out, pool, f.format, 1);
+
+    REQUIRE(buffer.write(std::string_view(input).substr(0, 1000)) == 1000);
+    REQUIRE(buffer.flush() == 0);
+    CHECK(out.flushed == 1);
+
+    // everything written so far can be decompressed after a flush
+    CHECK(decompress(f.encoding, out.data) == input.substr(0, 1000));
+
+    REQUIRE(buffer.write(std::string_view(input).substr(1000)) == int(input.size() - 1000));
+    REQUIRE(buffer.close() == 0);
+    CHECK(decompress(f.encoding, out.data) == input);
+  }
+}
+
+TEST_CASE("parallel_output_buffer matches serial compression ratio", "[parallel_compression]") {
+  thread_pool pool(4);
+  const auto input = payload(2 * 1024 * 1024);
+
+  string_output_buffer serial;
+  {
+    zlib_output_buffer buffer(serial, zlib_output_buffer::mode::gzip, 6);
+    REQUIRE(buffer.write(input) == int(input.size()));
+    REQUIRE(buffer.close() == 0);
+  }
+
+  const auto parallel = compress(pool, parallel_output_buffer::format::gzip, input, 65536);
+
+  // the dictionaries keep the blocks nearly as small as a single stream
+  CHECK(parallel.size() < serial.data.size() * 105 / 100);
+}
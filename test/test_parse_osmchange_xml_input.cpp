@@ -30,14 +30,17 @@ public:
 
   void end_document() override { end_executed = true; }
 
-  void process_node(const api06::Node &, operation op, bool if_unused) override {}
+  void process_node(const api06::Node &, operation op, bool if_unused) override { ++nodes; }
 
-  void process_way(const api06::Way &, operation op, bool if_unused) override {}
+  void process_way(const api06::Way &, operation op, bool if_unused) override { ++ways; }
 
-  void process_relation(const api06::Relation &, operation op, bool if_unused) override {}
+  void process_relation(const api06::Relation &, operation op, bool if_unused) override { ++relations; }
 
   bool start_executed{false};
   bool end_executed{false};
+  int nodes{0};
+  int ways{0};
+  int relations{0};
 };
 
 class global_settings_test_class : public global_settings_default {
@@ -71,6 +74,17 @@ void process_testmsg(const std::string &payload) {
   parser.process_message(payload);
 }
 
+Test_Parser_Callback process_testmsg_chunked(const std::string &payload, std::size_t chunk_size) {
+
+  std::setlocale(LC_ALL, "C.UTF-8");
+  Test_Parser_Callback cb;
+  api06::OSMChangeXMLParser parser(cb);
+  for (std::size_t offset = 0; offset < payload.size(); offset += chunk_size)
+    parser.process_chunk(std::string_view(payload).substr(offset, chunk_size));
+  parser.finish_message();
+  return cb;
+}
+
 // OSMCHANGE STRUCTURE TESTS
 
 TEST_CASE("Invalid XML", "[osmchange][xml]") {
@@ -603,6 +617,40 @@ TEST_CASE("Very large XML message", "[osmchange][node][xml]") {
 }
 
 
+// CHUNKED MESSAGE TESTS
+
+TEST_CASE("XML message in chunks", "[osmchange][xml]") {
+  const std::string payload = R"(<?xml version="1.0" encoding="UTF-8"?>
+    <osmChange version="0.6">
+      <create>
+        <node changeset="1" lat="1" lon="2" id="-1"><tag k="name" v="Grüße"/></node>
+        <way changeset="1" id="-2"><nd ref="-1"/><nd ref="1"/></way>
+      </create>
+      <modify>
+        <relation changeset="1" version="1" id="3"><member type="way" role="outer" ref="-2"/></relation>
+      </modify>
+    </osmChange>)";
+
+  auto chunk_size = GENERATE(1, 3, 64, 4096);
+
+  auto cb = process_testmsg_chunked(payload, chunk_size);
+  REQUIRE(cb.start_executed);
+  REQUIRE(cb.end_executed);
+  REQUIRE(cb.nodes == 1);
+  REQUIRE(cb.ways == 1);
+  REQUIRE(cb.relations == 1);
+}
+
+TEST_CASE("Invalid XML message in chunks", "[osmchange][xml]") {
+  auto chunk_size = GENERATE(1, 7, 4096);
+
+  REQUIRE_THROWS_AS(process_testmsg_chunked(R"(<osmChange>)", chunk_size), http::bad_request);
+  REQUIRE_THROWS_AS(process_testmsg_chunked("", chunk_size), http::bad_request);
+  REQUIRE_THROWS_MATCHES(process_testmsg_chunked(R"(<osmChange><dummy/></osmChange>)", chunk_size), http::bad_request,
+    Catch::Matchers::Message("Unknown action dummy, choices are create, modify, delete at line 1, column 18"));
+}
+
+
 // OBJECT LIMIT TESTS
 
 TEST_CASE("Create node, tags < max tags", "[osmchange][node][xml]") {
@@ -0,0 +1,384 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/pbf_formatter.hpp"
+#include "cgimap/pbf_writer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct string_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    data.append(buffer, len);
+    return len;
+  }
+  int written() const override { return data.size(); }
+  int close() noexcept override { return 0; }
+  int flush() noexcept override { return 0; }
+
+  std::string data;
+};
+
+// just enough of a protobuf decoder to check the formatter's output
+struct pbf_field {
+  uint32_t number;
+  uint64_t value;
+  std::string_view bytes;
+};
+
+uint64_t read_varint(std::string_view &data) {
+  uint64_t result = 0;
+  for (int shift = 0; !data.empty(); shift += 7) {
+    auto byte = static_cast<uint8_t>(data.front());
+    data.remove_prefix(1);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return result;
+  }
+  FAIL("truncated varint");
+  return result;
+}
+
+std::vector<pbf_field> parse(std::string_view data) {
+  std::vector<pbf_field> result;
+  while (!data.empty()) {
+    auto key = read_varint(data);
+    pbf_field field{static_cast<uint32_t>(key >> 3), 0, {}};
+    if ((key & 7) == 0) {
+      field.value = read_varint(data);
+    } else {
+      REQUIRE((key & 7) == 2);
+      auto len = read_varint(data);
+      REQUIRE(len <= data.size());
+      field.bytes = data.substr(0, len);
+      data.remove_prefix(len);
+    }
+    result.push_back(field);
+  }
+  return result;
+}
+
+std::vector<pbf_field> get_all(std::string_view data, uint32_t number) {
+  std::vector<pbf_field> result;
+  for (const auto &field : parse(data))
+    if (field.number == number)
+      result.push_back(field);
+  return result;
+}
+
+pbf_field get(std::string_view data, uint32_t number) {
+  auto fields = get_all(data, number);
+  REQUIRE(fields.size() == 1);
+  return fields.front();
+}
+
+std::vector<uint64_t> packed(std::string_view data) {
+  std::vector<uint64_t> result;
+  while (!data.empty())
+    result.push_back(read_varint(data));
+  return result;
+}
+
+// decodes zigzag encoded, delta coded values
+std::vector<int64_t> packed_delta(std::string_view data) {
+  std::vector<int64_t> result;
+  int64_t last = 0;
+  for (auto v : packed(data)) {
+    last += static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    result.push_back(last);
+  }
+  return result;
+}
+
+struct file_block {
+  std::string type;
+  std::string data;
+};
+
+std::vector<file_block> read_blocks(std::string_view file) {
+  std::vector<file_block> result;
+  while (!file.empty()) {
+    REQUIRE(file.size() >= 4);
+    uint32_t header_size = (static_cast<uint8_t>(file[0]) << 24) |
+                           (static_cast<uint8_t>(file[1]) << 16) |
+                           (static_cast<uint8_t>(file[2]) << 8) |
+                            static_cast<uint8_t>(file[3]);
+    file.remove_prefix(4);
+
+    auto header = file.substr(0, header_size);
+    file.remove_prefix(header_size);
+    auto blob_size = get(header, 3).value;
+    auto blob = file.substr(0, blob_size);
+    file.remove_prefix(blob_size);
+
+    file_block block{std::string(get(header, 1).bytes), {}};
+    block.data.resize(get(blob, 2).value);
+    auto zlib_data = get(blob, 3).bytes;
+    uLongf size = block.data.size();
+    REQUIRE(uncompress(reinterpret_cast<Bytef *>(block.data.data()), &size,
+                       reinterpret_cast<const Bytef *>(zlib_data.data()),
+                       zlib_data.size()) == Z_OK);
+    REQUIRE(size == block.data.size());
+    result.push_back(block);
+  }
+  return result;
+}
+
+std::vector<std::string> string_table(std::string_view block) {
+  std::vector<std::string> result;
+  for (const auto &s : get_all(get(block, 1).bytes, 1))
+    result.emplace_back(s.bytes);
+  return result;
+}
+
+std::vector<std::string> strings(const std::vector<std::string> &table,
+                                 const std::vector<uint64_t> &ids) {
+  std::vector<std::string> result;
+  for (auto id : ids)
+    result.push_back(table.at(id));
+  return result;
+}
+
+} // anonymous namespace
+
+TEST_CASE("pbf_formatter writes nodes, ways and relations", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  fmt.start_document("cgimap test", "osm");
+  fmt.write_bounds(bbox(51.5, -0.25, 51.75, 0.125));
+  fmt.start_element();
+  fmt.write_node(element_info(10, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                 -0.1, 51.6, {{"amenity", "cafe"}, {"name", "Café"}});
+  fmt.write_node(element_info(12, 2, 6, "2024-01-01T00:00:10Z", {}, {}, true),
+                 -0.1000001, 51.6000002, {});
+  fmt.write_node(element_info(11, 3, 5, "2024-01-01T00:00:05Z", 7, "alice", true),
+                 0.1, 51.7, {{"name", "Tea"}});
+  fmt.write_way(element_info(20, 4, 8, "2024-02-01T00:00:00Z", 8, "bob", true),
+                {10, 12, 11, 10}, {{"highway", "footway"}});
+  fmt.write_relation(element_info(30, 1, 9, "2024-03-01T00:00:00Z", 7, "alice", true),
+                     {member_info(element_type::way, 20, "outer"),
+                      member_info(element_type::node, 10, "")},
+                     {{"type", "multipolygon"}});
+  fmt.end_element();
+  fmt.end_document();
+
+  auto blocks = read_blocks(buffer.data);
+  REQUIRE(blocks.size() == 2);
+
+  SECTION("header block") {
+    CHECK(blocks[0].type == "OSMHeader");
+    const auto &header = blocks[0].data;
+
+    std::vector<std::string> features;
+    for (const auto &f : get_all(header, 4))
+      features.emplace_back(f.bytes);
+    CHECK(features == std::vector<std::string>{"OsmSchema-V0.6", "DenseNodes"});
+    CHECK(get(header, 16).bytes == "cgimap test");
+
+    auto box = get(header, 1).bytes;
+    auto zigzag = [](uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); };
+    CHECK(zigzag(get(box, 1).value) == -250'000'000);
+    CHECK(zigzag(get(box, 2).value) == 125'000'000);
+    CHECK(zigzag(get(box, 3).value) == 51'750'000'000);
+    CHECK(zigzag(get(box, 4).value) == 51'500'000'000);
+  }
+
+  SECTION("data block") {
+    CHECK(blocks[1].type == "OSMData");
+    const auto &block = blocks[1].data;
+    auto table = string_table(block);
+    CHECK(table.at(0).empty());
+
+    auto groups = get_all(block, 2);
+    REQUIRE(groups.size() == 3);
+
+    // dense nodes
+    auto dense = get(groups[0].bytes, 2).bytes;
+    CHECK(packed_delta(get(dense, 1).bytes) == std::vector<int64_t>{10, 12, 11});
+    CHECK(packed_delta(get(dense, 8).bytes) == std::vector<int64_t>{516000000, 516000002, 517000000});
+    CHECK(packed_delta(get(dense, 9).bytes) == std::vector<int64_t>{-1000000, -1000001, 1000000});
+    CHECK(strings(table, packed(get(dense, 10).bytes)) ==
+          std::vector<std::string>{"amenity", "cafe", "name", "Café", "", "", "name", "Tea", ""});
+
+    auto info = get(dense, 5).bytes;
+    CHECK(packed(get(info, 1).bytes) == std::vector<uint64_t>{1, 2, 3});
+    CHECK(packed_delta(get(info, 2).bytes) == std::vector<int64_t>{1704067200, 1704067210, 1704067205});
+    CHECK(packed_delta(get(info, 3).bytes) == std::vector<int64_t>{5, 6, 5});
+    CHECK(packed_delta(get(info, 4).bytes) == std::vector<int64_t>{7, 0, 7});
+    auto user_sids = packed_delta(get(info, 5).bytes);
+    CHECK(strings(table, {user_sids.begin(), user_sids.end()}) ==
+          std::vector<std::string>{"alice", "", "alice"});
+    CHECK(get_all(info, 6).empty());
+
+    // ways
+    auto way = get(groups[1].bytes, 3).bytes;
+    CHECK(get(way, 1).value == 20);
+    CHECK(strings(table, packed(get(way, 2).bytes)) == std::vector<std::string>{"highway"});
+    CHECK(strings(table, packed(get(way, 3).bytes)) == std::vector<std::string>{"footway"});
+    CHECK(packed_delta(get(way, 8).bytes) == std::vector<int64_t>{10, 12, 11, 10});
+    auto way_info = get(way, 4).bytes;
+    CHECK(get(way_info, 1).value == 4);
+    CHECK(get(way_info, 2).value == 1706745600);
+    CHECK(get(way_info, 3).value == 8);
+    CHECK(get(way_info, 4).value == 8);
+    CHECK(table.at(get(way_info, 5).value) == "bob");
+    CHECK(get_all(way_info, 6).empty());
+
+    // relations
+    auto relation = get(groups[2].bytes, 4).bytes;
+    CHECK(get(relation, 1).value == 30);
+    CHECK(strings(table, packed(get(relation, 2).bytes)) == std::vector<std::string>{"type"});
+    CHECK(strings(table, packed(get(relation, 3).bytes)) == std::vector<std::string>{"multipolygon"});
+    CHECK(strings(table, packed(get(relation, 8).bytes)) == std::vector<std::string>{"outer", ""});
+    CHECK(packed_delta(get(relation, 9).bytes) == std::vector<int64_t>{20, 10});
+    CHECK(packed(get(relation, 10).bytes) == std::vector<uint64_t>{1, 0});
+  }
+}
+
+TEST_CASE("pbf_formatter writes deleted elements", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  fmt.start_document("cgimap test", "osm");
+  fmt.write_node(element_info(10, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                 -0.1, 51.6, {});
+  fmt.write_node(element_info(10, 2, 6, "2024-01-02T00:00:00Z", 7, "alice", false),
+                 0, 0, {});
+  fmt.write_way(element_info(20, 2, 8, "2024-02-01T00:00:00Z", 8, "bob", false),
+                {}, {});
+  fmt.end_document();
+
+  auto blocks = read_blocks(buffer.data);
+  REQUIRE(blocks.size() == 2);
+
+  std::vector<std::string> features;
+  for (const auto &f : get_all(blocks[0].data, 4))
+    features.emplace_back(f.bytes);
+  CHECK(features == std::vector<std::string>{"OsmSchema-V0.6", "DenseNodes", "HistoricalInformation"});
+
+  auto groups = get_all(blocks[1].data, 2);
+  REQUIRE(groups.size() == 2);
+
+  auto dense = get(groups[0].bytes, 2).bytes;
+  CHECK(packed(get(get(dense, 5).bytes, 6).bytes) == std::vector<uint64_t>{1, 0});
+
+  auto way = get(groups[1].bytes, 3).bytes;
+  CHECK(get_all(way, 8).empty());
+  CHECK(get(get(way, 4).bytes, 6).value == 0);
+}
+
+TEST_CASE("pbf_formatter declares historical information up front", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  auto features = [&]() {
+    const auto blocks = read_blocks(buffer.data);
+    std::vector<std::string> result;
+    for (const auto &f : get_all(blocks[0].data, 4))
+      result.emplace_back(f.bytes);
+    return result;
+  };
+
+  SECTION("Deleted element after the first block") {
+    fmt.set_historical(true);
+    fmt.start_document("cgimap test", "osm");
+    for (osm_nwr_id_t id = 1; id <= pbf_formatter::MAX_BLOCK_ELEMENTS; ++id)
+      fmt.write_node(element_info(id, 1, 1, "2024-01-01T00:00:00Z", 1, "alice", true),
+                     0.0, 0.0, {});
+    fmt.write_node(element_info(1, 2, 2, "2024-01-02T00:00:00Z", 1, "alice", false),
+                   0.0, 0.0, {});
+    fmt.end_document();
+
+    REQUIRE(read_blocks(buffer.data).size() == 3);
+    CHECK(features() == std::vector<std::string>{"OsmSchema-V0.6", "DenseNodes", "HistoricalInformation"});
+  }
+
+  SECTION("Current elements only") {
+    fmt.set_historical(false);
+    fmt.start_document("cgimap test", "osm");
+    fmt.write_node(element_info(10, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                   -0.1, 51.6, {});
+    fmt.end_document();
+
+    CHECK(features() == std::vector<std::string>{"OsmSchema-V0.6", "DenseNodes"});
+  }
+}
+
+TEST_CASE("pbf_formatter splits large responses into blocks", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  fmt.start_document("cgimap test", "osm");
+  for (osm_nwr_id_t id = 1; id <= pbf_formatter::MAX_BLOCK_ELEMENTS + 1; ++id)
+    fmt.write_node(element_info(id, 1, 1, "2024-01-01T00:00:00Z", 1, "alice", true),
+                   0.0, 0.0, {{"ref", std::to_string(id)}});
+  // a node after a way needs a new block, as groups are written by type
+  fmt.write_way(element_info(1, 1, 1, "2024-01-01T00:00:00Z", 1, "alice", true),
+                {1, 2}, {});
+  fmt.write_node(element_info(0, 1, 1, "2024-01-01T00:00:00Z", 1, "alice", true),
+                 0.0, 0.0, {});
+  fmt.end_document();
+
+  auto blocks = read_blocks(buffer.data);
+  REQUIRE(blocks.size() == 4);
+
+  auto node_ids = [](const std::string &block) {
+    auto group = get(block, 2).bytes;
+    return packed_delta(get(get(group, 2).bytes, 1).bytes);
+  };
+
+  CHECK(node_ids(blocks[1].data).size() == pbf_formatter::MAX_BLOCK_ELEMENTS);
+  CHECK(node_ids(blocks[3].data) == std::vector<int64_t>{0});
+
+  // each block has its own string table
+  CHECK(string_table(blocks[2].data) ==
+        std::vector<std::string>{"", "alice", "ref", std::to_string(pbf_formatter::MAX_BLOCK_ELEMENTS + 1)});
+}
+
+TEST_CASE("pbf_formatter stops writing after an error", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  fmt.start_document("cgimap test", "osm");
+  fmt.write_node(element_info(10, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                 -0.1, 51.6, {});
+  fmt.error(std::runtime_error("database went away"));
+  fmt.end_document();
+
+  CHECK(buffer.data.empty());
+}
+
+TEST_CASE("pbf_formatter writes stored coordinates unchanged", "[pbf]") {
+  string_output_buffer buffer;
+  pbf_formatter fmt(std::make_unique<pbf_writer>(buffer));
+
+  fmt.start_document("cgimap test", "osm");
+  fmt.write_node(element_info(10, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                 fixed_lonlat{ .lon = -1000001, .lat = 516000002 }, {});
+  fmt.write_node(element_info(11, 1, 5, "2024-01-01T00:00:00Z", 7, "alice", true),
+                 fixed_lonlat{ .lon = 1800000000, .lat = -900000000 }, {});
+  fmt.end_document();
+
+  auto blocks = read_blocks(buffer.data);
+  REQUIRE(blocks.size() == 2);
+
+  auto dense = get(get(blocks[1].data, 2).bytes, 2).bytes;
+  CHECK(packed_delta(get(dense, 8).bytes) == std::vector<int64_t>{516000002, -900000000});
+  CHECK(packed_delta(get(dense, 9).bytes) == std::vector<int64_t>{-1000001, 1800000000});
+}
@@ -44,49 +44,18 @@ const char *test_request::get_param(const char *key) const {
   }
 }
 
-std::string test_request::get_payload() {
+std::string_view test_request::read_body() {
+  // the whole payload is returned as a single chunk
+  if (m_payload_read)
+    return {};
 
-  // TODO: still a bit too much duplication from fcgi_request.cpp::get_payload
-
-  // fetch and parse the content length
-  const char *content_length_str = m_params.contains("CONTENT_LENGTH") ? m_params["CONTENT_LENGTH"].c_str() : nullptr;
-  const char *content_encoding = m_params.contains("HTTP_CONTENT_ENCODING") ? m_params["HTTP_CONTENT_ENCODING"].c_str() : nullptr;
-
-  auto content_encoding_handler = http::get_content_encoding_handler(
-         std::string_view(content_encoding == nullptr ? "" : content_encoding));
-
-  unsigned long content_length = 0;
-  unsigned long result_length = 0;
-
-  if (content_length_str)
-    content_length = http::parse_content_length(content_length_str);
-
-  std::string result;
-
-  std::string content(m_payload);
-  result_length += content.length();
-
-  // Decompression according to Content-Encoding header (null op, if header is not set)
-  try {
-    std::string content_decompressed = content_encoding_handler->decompress(content);
-    result += content_decompressed;
-  } catch (std::bad_alloc&) {
-      throw http::server_error("Decompression failed due to memory issue");
-  } catch (std::runtime_error&) {
-      throw http::bad_request("Payload cannot be decompressed according to Content-Encoding");
-  }
-
-  if (result.length() > global_settings::get_payload_max_size())
-     throw http::payload_too_large(fmt::format("Payload exceeds limit of {:d} bytes", global_settings::get_payload_max_size()));
-
-  if (content_length > 0 && result_length != content_length)
-    throw http::server_error("HTTP Header field 'Content-Length' differs from actual payload length");
-
-  return result;
+  m_payload_read = true;
+  return m_payload;
 }
 
 void test_request::set_payload(const std::string& payload) {
   m_payload = payload;
+  m_payload_read = false;
 }
 
 void test_request::dispose() {}
@@ -53,7 +53,6 @@ struct test_request : public request {
   /// implementation of request interface
   ~test_request() override = default;
   const char *get_param(const char *key) const override;
-  std::string get_payload() override;
   void set_payload(const std::string&);
 
   void dispose() override;
@@ -71,6 +70,7 @@ struct test_request : public request {
 
 protected:
   void write_header_info(int status, const http::headers_t &headers) override;
+  std::string_view read_body() override;
   output_buffer& get_buffer_internal() override;
   void finish_internal() override;
 
@@ -82,6 +82,7 @@ private:
   std::map<std::string, std::string> m_params;
   std::chrono::system_clock::time_point m_now;
   std::string m_payload;
+  bool m_payload_read{false};
   std::unique_ptr<test_output_buffer> test_ob_buffer;
 };
 
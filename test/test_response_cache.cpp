@@ -0,0 +1,121 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/response_cache.hpp"
+
+#include <memory>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+cached_response response(std::size_t size, char c = 'x') {
+  return cached_response{std::string(size, c), size * 10};
+}
+
+} // anonymous namespace
+
+TEST_CASE("memory_response_cache round trip", "[response_cache]") {
+  memory_response_cache cache(10000);
+
+  CHECK_FALSE(cache.get("a"));
+
+  cache.put("a", response(100, 'a'));
+  const auto result = cache.get("a");
+  REQUIRE(result);
+  CHECK(result->body == std::string(100, 'a'));
+  CHECK(result->written == 1000);
+
+  CHECK(cache.size() == 1);
+  CHECK(cache.bytes() == 101);
+
+  // replacing an entry doesn't count it twice
+  cache.put("a", response(200, 'b'));
+  CHECK(cache.size() == 1);
+  CHECK(cache.bytes() == 201);
+  CHECK(cache.get("a")->body == std::string(200, 'b'));
+}
+
+TEST_CASE("memory_response_cache evicts least recently used", "[response_cache]") {
+  memory_response_cache cache(1000);
+
+  cache.put("a", response(99));
+  cache.put("b", response(99));
+  cache.put("c", response(99));
+
+  // a is now more recently used than b
+  CHECK(cache.get("a"));
+
+  for (int i = 0; i < 8; ++i) {
+    cache.put("d" + std::to_string(i), response(98));
+  }
+
+  CHECK(cache.bytes() <= 1000);
+  CHECK(cache.get("a"));
+  CHECK_FALSE(cache.get("b"));
+  CHECK(cache.get("c"));
+  CHECK(cache.get("d7"));
+}
+
+TEST_CASE("memory_response_cache skips large responses", "[response_cache]") {
+  memory_response_cache cache(8000);
+
+  // an eighth of the capacity, including the key
+  cache.put("s", response(999));
+  cache.put("l", response(1000));
+
+  CHECK(cache.get("s"));
+  CHECK_FALSE(cache.get("l"));
+  CHECK(cache.size() == 1);
+}
+
+TEST_CASE("memory_response_cache shared", "[response_cache]") {
+  CHECK_FALSE(memory_response_cache::shared(0));
+
+  const auto cache = memory_response_cache::shared(1000000);
+  REQUIRE(cache);
+  CHECK(memory_response_cache::shared(1000000) == cache);
+}
+
+TEST_CASE("response_cache", "[response_cache]") {
+
+  SECTION("disabled") {
+    response_cache cache(nullptr, "");
+    CHECK_FALSE(cache.enabled());
+
+    cache.put("a", response(10));
+    CHECK_FALSE(cache.get("a"));
+  }
+
+  SECTION("in memory") {
+    auto memory = std::make_shared<memory_response_cache>(100000);
+    response_cache cache(memory, "");
+    CHECK(cache.enabled());
+
+    const auto before = response_cache::get_statistics();
+
+    CHECK_FALSE(cache.get("a"));
+    cache.put("a", response(10));
+    const auto result = cache.get("a");
+    REQUIRE(result);
+    CHECK(result->body == std::string(10, 'x'));
+    CHECK(result->written == 100);
+
+    // the memory part is shared with other caches using it
+    response_cache other(memory, "");
+    CHECK(other.get("a"));
+
+    const auto after = response_cache::get_statistics();
+    CHECK(after.memory_hits - before.memory_hits == 2);
+    CHECK(after.shared_hits - before.shared_hits == 0);
+    CHECK(after.misses - before.misses == 1);
+    CHECK(after.stores - before.stores == 1);
+  }
+}
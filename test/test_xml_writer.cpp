@@ -0,0 +1,156 @@
+/**
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * This file is part of openstreetmap-cgimap (https://github.com/zerebubuth/openstreetmap-cgimap/).
+ *
+ * Copyright (C) 2009-2025 by the openstreetmap-cgimap developer community.
+ * For a full list of authors see the git log.
+ */
+
+#include "cgimap/xml_writer.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct string_output_buffer : public output_buffer {
+  using output_buffer::write;
+  int write(const char *buffer, int len) noexcept override {
+    data.append(buffer, len);
+    return len;
+  }
+  int written() const override { return data.size(); }
+  int close() noexcept override { ++closed; return 0; }
+  int flush() noexcept override { return 0; }
+
+  std::string data;
+  int closed = 0;
+};
+
+constexpr const char *header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+
+} // anonymous namespace
+
+// the expected output below is what libxml2's xmlTextWriter produced, which
+// clients may have come to rely on.
+
+TEST_CASE("xml_writer_indented", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, true);
+    writer.start("osm");
+    writer.attribute("version", std::string("0.6"));
+    writer.start("node");
+    writer.attribute("id", int64_t(-1));
+    writer.attribute("uid", uint64_t(std::numeric_limits<uint64_t>::max()));
+    writer.attribute("visible", true);
+    writer.start("tag");
+    writer.attribute("k", std::string("name"));
+    writer.end();
+    writer.end();
+    writer.start("note");
+    writer.text("some text");
+    writer.end();
+    writer.start("empty");
+    writer.text("");
+    writer.end();
+    writer.end();
+  }
+  CHECK(out.data == std::string(header) +
+        "<osm version=\"0.6\">\n"
+        " <node id=\"-1\" uid=\"18446744073709551615\" visible=\"true\">\n"
+        "  <tag k=\"name\"/>\n"
+        " </node>\n"
+        " <note>some text</note>\n"
+        " <empty></empty>\n"
+        "</osm>\n");
+  CHECK(out.closed == 1);
+}
+
+TEST_CASE("xml_writer_not_indented", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, false);
+    writer.start("osm");
+    writer.start("node");
+    writer.end();
+    writer.start("way");
+    writer.text("text");
+    writer.end();
+    writer.end();
+  }
+  CHECK(out.data == std::string(header) + "<osm><node/><way>text</way></osm>\n");
+}
+
+TEST_CASE("xml_writer_escaping", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, true);
+    writer.start("osm");
+    writer.attribute("k", std::string("<a & \"b\" 'c'>\r\n\t"));
+    writer.attribute("utf8", std::string("\xc3\xa4\xe2\x82\xac"));
+    writer.attribute("null", static_cast<const char *>(nullptr));
+    writer.text("<a & \"b\" 'c'>\r\n\t");
+    writer.end();
+  }
+  CHECK(out.data == std::string(header) +
+        "<osm k=\"&lt;a &amp; &quot;b&quot; 'c'&gt;&#13;&#10;&#9;\""
+        " utf8=\"\xc3\xa4\xe2\x82\xac\" null=\"\">"
+        "&lt;a &amp; &quot;b&quot; 'c'&gt;&#13;\n\t</osm>\n");
+}
+
+TEST_CASE("xml_writer_doubles", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, false);
+    writer.start("node");
+    writer.attribute("lat", 51.5);
+    writer.attribute("lon", -0.1234567);
+    writer.attribute("small", -0.00000001);
+    writer.attribute("zero", -0.0);
+    writer.attribute("max", 180.0);
+    writer.attribute("big", 1e10);
+    writer.end();
+  }
+  CHECK(out.data == std::string(header) +
+        "<node lat=\"51.5000000\" lon=\"-0.1234567\" small=\"-0.0000000\""
+        " zero=\"-0.0000000\" max=\"180.0000000\" big=\"10000000000.0000000\"/>\n");
+}
+
+TEST_CASE("xml_writer_closes_open_elements", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, true);
+    writer.start("osm");
+    writer.start("node");
+    writer.start("tag");
+  }
+  CHECK(out.data == std::string(header) +
+        "<osm>\n"
+        " <node>\n"
+        "  <tag/>\n"
+        " </node>\n"
+        "</osm>\n");
+}
+
+TEST_CASE("xml_writer_fixed_point", "[xml]") {
+  string_output_buffer out;
+  {
+    xml_writer writer(out, false);
+    writer.start("node");
+    writer.attribute("lat", int64_t(515000000), 10'000'000);
+    writer.attribute("lon", int64_t(-1), 10'000'000);
+    writer.attribute("max", int64_t(-1800000000), 10'000'000);
+    writer.attribute("zero", int64_t(0), 10'000'000);
+    writer.attribute("coarse", int64_t(-123), 100);
+    writer.attribute("odd", int64_t(1), 3);
+    writer.end();
+  }
+  CHECK(out.data == std::string(header) +
+        "<node lat=\"51.5000000\" lon=\"-0.0000001\" max=\"-180.0000000\""
+        " zero=\"0.0000000\" coarse=\"-1.2300000\" odd=\"0.3333333\"/>\n");
+}